@@ -0,0 +1,154 @@
+//===-- MemoryTraceDump.cpp - Memory Trace Dump Utility -------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements a utility printing the records of the traces written
+/// by the memory trace tool, or summarizing their compression and measuring
+/// how fast the reader library decompresses them.
+//===----------------------------------------------------------------------===//
+#include "MemoryTraceReader.h"
+#include <bit>
+#include <chrono>
+#include <limits>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace luthier::memtrace;
+
+static llvm::cl::opt<std::string> InputFile(llvm::cl::Positional,
+                                            llvm::cl::desc("<trace file>"),
+                                            llvm::cl::Required);
+
+static llvm::cl::opt<bool>
+    PrintSummary("summary",
+               llvm::cl::desc("Summarize the compression of each launch and "
+                              "measure the decompression throughput instead "
+                              "of printing the records"),
+               llvm::cl::init(false));
+
+static llvm::cl::opt<uint64_t> MaxRecords(
+    "max-records",
+    llvm::cl::desc("Maximum number of records to print for each launch"),
+    llvm::cl::init(std::numeric_limits<uint64_t>::max()));
+
+static llvm::StringRef getEncodingName(AddressEncoding Encoding) {
+  switch (Encoding) {
+  case ENCODING_UNIFORM:
+    return "uniform";
+  case ENCODING_STRIDED:
+    return "strided";
+  case ENCODING_DELTA32:
+    return "delta32";
+  case ENCODING_RAW:
+    return "raw";
+  }
+  return "unknown";
+}
+
+/// Prints the first \c MaxRecords records of \p Launch
+static llvm::Error printRecords(const LaunchTrace &Launch) {
+  llvm::outs() << llvm::formatv("Launch {0} of kernel {1}: {2} records, {3} "
+                                "dropped\n",
+                                Launch.getLaunchIdx(), Launch.getKernelName(),
+                                Launch.getNumRecords(),
+                                Launch.getNumDroppedRecords());
+  uint64_t NumPrinted = 0;
+  return Launch.decode([&](const WaveAccess &Access) {
+    if (NumPrinted++ >= MaxRecords)
+      return;
+    llvm::outs() << llvm::formatv(
+        "  {0} pc={1:x} wg=({2},{3},{4}) hwid={5:x} exec={6:x} {7}:",
+        Access.Instr->Description, Access.Instr->PC, Access.WorkgroupId[0],
+        Access.WorkgroupId[1], Access.WorkgroupId[2], Access.HwId,
+        Access.Exec, getEncodingName(Access.Encoding));
+    for (uint64_t Mask = Access.Exec; Mask != 0; Mask &= Mask - 1) {
+      unsigned int Lane = std::countr_zero(Mask);
+      llvm::outs() << llvm::formatv(" {0}:{1:x}", Lane,
+                                    Access.Addresses[Lane]);
+    }
+    llvm::outs() << "\n";
+  });
+}
+
+/// Prints how the records of \p Launch were compressed, and the rate at
+/// which their addresses were decompressed
+static llvm::Error printSummary(const LaunchTrace &Launch) {
+  uint64_t NumRecordsPerEncoding[ENCODING_RAW + 1]{};
+  uint64_t NumUnitStrideRecords = 0;
+  uint64_t NumAddresses = 0;
+  // Keep the decoded addresses live so that the decoding is not optimized
+  // away
+  uint64_t Checksum = 0;
+  auto Start = std::chrono::steady_clock::now();
+  if (auto Err = Launch.decode([&](const WaveAccess &Access) {
+        NumRecordsPerEncoding[Access.Encoding]++;
+        NumUnitStrideRecords +=
+            Access.Encoding == ENCODING_STRIDED &&
+            Access.Stride == static_cast<int64_t>(Access.Instr->AccessSize);
+        NumAddresses += std::popcount(Access.Exec);
+        Checksum += Access.Addresses[std::countr_zero(Access.Exec)];
+      }))
+    return Err;
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+
+  uint64_t CompressedSize = Launch.getRecordStream().size();
+  uint64_t DecompressedSize = NumAddresses * sizeof(uint64_t);
+  llvm::outs() << llvm::formatv(
+      "Launch {0} of kernel {1}:\n"
+      "  Records: {2} ({3} dropped)\n"
+      "  Uniform: {4}, Strided: {5} ({6} unit-stride), Delta32: {7}, "
+      "Raw: {8}\n"
+      "  Compressed size: {9} bytes, {10:f2} bytes per address\n"
+      "  Decompressed {11} addresses in {12:f4} s ({13:f2} GB/s, checksum "
+      "{14:x})\n",
+      Launch.getLaunchIdx(), Launch.getKernelName(), Launch.getNumRecords(),
+      Launch.getNumDroppedRecords(), NumRecordsPerEncoding[ENCODING_UNIFORM],
+      NumRecordsPerEncoding[ENCODING_STRIDED], NumUnitStrideRecords,
+      NumRecordsPerEncoding[ENCODING_DELTA32],
+      NumRecordsPerEncoding[ENCODING_RAW], CompressedSize,
+      NumAddresses == 0 ? 0.0
+                        : static_cast<double>(CompressedSize) /
+                              static_cast<double>(NumAddresses),
+      NumAddresses, Elapsed.count(),
+      Elapsed.count() == 0.0
+          ? 0.0
+          : static_cast<double>(DecompressedSize) / Elapsed.count() / 1e9,
+      Checksum);
+  return llvm::Error::success();
+}
+
+int main(int argc, char **argv) {
+  llvm::InitLLVM X(argc, argv);
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "Luthier memory trace dump utility\n");
+
+  auto Reader = TraceReader::open(InputFile);
+  if (!Reader) {
+    llvm::WithColor::error() << llvm::toString(Reader.takeError()) << "\n";
+    return 1;
+  }
+  for (const LaunchTrace &Launch : (*Reader)->launches()) {
+    if (auto Err = PrintSummary ? printSummary(Launch) : printRecords(Launch)) {
+      llvm::WithColor::error() << llvm::toString(std::move(Err)) << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,160 @@
+//===-- MemoryTraceFormat.h - Memory Trace File Format ----------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file describes the layout of the traces written by the memory trace
+/// tool, shared between its device hooks, its host side, and the trace reader
+/// library.
+///
+/// A trace file starts with a \c TraceFileHeader, followed by the trace of
+/// each instrumented kernel launch. The trace of a launch starts with a
+/// \c LaunchHeader, followed by the name of the kernel, the
+/// \c TracedInstrEntry of each traced instruction, the descriptions of the
+/// traced instructions and the record stream of the launch. Each of them is
+/// padded to a multiple of 8 bytes.
+///
+/// The record stream is a sequence of records, each holding a
+/// \c RecordHeader followed by an optional payload. Each record describes
+/// the addresses accessed by the active lanes of a wave when executing a
+/// traced instruction, compressed on the device according to the
+/// \c AddressEncoding of the record.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_EXAMPLES_MEMORY_TRACE_FORMAT_H
+#define LUTHIER_EXAMPLES_MEMORY_TRACE_FORMAT_H
+#include <cstdint>
+
+#if defined(__HIPCC__)
+#define LUTHIER_MEMORY_TRACE_HOST_DEVICE __attribute__((host, device))
+#else
+#define LUTHIER_MEMORY_TRACE_HOST_DEVICE
+#endif
+
+namespace luthier::memtrace {
+
+/// Magic bytes at the beginning of every trace file
+static constexpr char TraceFileMagic[8] = {'L', 'M', 'E', 'M',
+                                           'T', 'R', 'C', '\0'};
+
+/// Version of the trace file format
+static constexpr uint32_t TraceFileVersion = 1;
+
+/// \brief Header of a trace file
+struct TraceFileHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t Reserved;
+};
+
+/// \brief Header of the trace of a single kernel launch
+struct LaunchHeader {
+  /// Index of the launch among all kernel launches of the application
+  uint64_t LaunchIdx;
+  /// Number of records in the record stream of the launch
+  uint64_t NumRecords;
+  /// Number of records dropped because the device trace buffer was full
+  uint64_t NumDroppedRecords;
+  /// Size of the record stream of the launch in bytes
+  uint64_t RecordStreamSize;
+  /// Number of traced instructions of the kernel
+  uint32_t NumInstructions;
+  /// Size of the name of the kernel in bytes, not including padding
+  uint32_t KernelNameSize;
+};
+
+/// Flags of a traced instruction
+enum TracedInstrFlags : uint16_t {
+  INSTR_MAY_LOAD = 1 << 0,
+  INSTR_MAY_STORE = 1 << 1
+};
+
+/// \brief Describes an instruction traced during a launch; Records refer to
+/// their instruction by its index in the traced instructions of the launch
+struct TracedInstrEntry {
+  /// Loaded address of the original instruction on the device, or zero if
+  /// it is not known
+  uint64_t PC;
+  /// Number of bytes accessed by each lane
+  uint32_t AccessSize;
+  /// \c TracedInstrFlags of the instruction
+  uint16_t Flags;
+  /// Size of the description of the instruction in bytes
+  uint16_t DescriptionSize;
+};
+
+/// \brief How the addresses of the active lanes of a record are encoded
+enum AddressEncoding : uint16_t {
+  /// All active lanes access the base address of the record; No payload
+  ENCODING_UNIFORM = 0,
+  /// Lane \c L accesses <tt>Base + Stride * (L - FirstActiveLane)</tt>;
+  /// No payload. Unit-stride accesses are strided records whose stride is
+  /// the access size of their instruction
+  ENCODING_STRIDED = 1,
+  /// Each active lane accesses the base address plus a signed 32-bit delta;
+  /// The payload holds the deltas of the active lanes, in lane order
+  ENCODING_DELTA32 = 2,
+  /// The payload holds the 64-bit addresses of the active lanes, in lane
+  /// order
+  ENCODING_RAW = 3
+};
+
+/// \brief Header of a record
+struct RecordHeader {
+  /// Exec mask of the wave when executing the instruction
+  uint64_t Exec;
+  /// Address accessed by the first active lane of the wave
+  uint64_t Base;
+  /// Index of the traced instruction
+  uint32_t InstrIdx;
+  /// Content of the hardware ID register of the wave
+  uint32_t HwId;
+  /// Workgroup ID of the wave in each dimension
+  uint32_t WorkgroupId[3];
+  /// Stride between the addresses of consecutive lanes of a strided record
+  int32_t Stride;
+  /// \c AddressEncoding of the record
+  uint16_t Encoding;
+  uint16_t Reserved0;
+  uint32_t Reserved1;
+};
+
+static_assert(sizeof(RecordHeader) % sizeof(uint64_t) == 0,
+              "Records must stay 8-byte aligned in the record stream");
+
+/// \return the size of the payload of a record with \p Encoding and
+/// \p NumActiveLanes active lanes, in 64-bit words
+LUTHIER_MEMORY_TRACE_HOST_DEVICE constexpr uint32_t
+getPayloadSizeInWords(uint16_t Encoding, uint32_t NumActiveLanes) {
+  if (Encoding == ENCODING_DELTA32)
+    return (NumActiveLanes + 1) / 2;
+  if (Encoding == ENCODING_RAW)
+    return NumActiveLanes;
+  return 0;
+}
+
+/// \return the size of a record with \p Encoding and \p NumActiveLanes
+/// active lanes, in 64-bit words
+LUTHIER_MEMORY_TRACE_HOST_DEVICE constexpr uint32_t
+getRecordSizeInWords(uint16_t Encoding, uint32_t NumActiveLanes) {
+  return sizeof(RecordHeader) / sizeof(uint64_t) +
+         getPayloadSizeInWords(Encoding, NumActiveLanes);
+}
+
+/// \return \p Size rounded up to a multiple of 8 bytes
+constexpr uint64_t alignToWord(uint64_t Size) { return (Size + 7) & ~7ULL; }
+
+} // namespace luthier::memtrace
+
+#endif
@@ -0,0 +1,241 @@
+//===-- MemoryTraceReader.cpp - Memory Trace Reader Library ---------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the reader library of the memory trace tool.
+//===----------------------------------------------------------------------===//
+#include "MemoryTraceReader.h"
+#include <bit>
+#include <cstring>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/MathExtras.h>
+
+namespace luthier::memtrace {
+
+/// \return an error describing a malformed trace
+static llvm::Error createMalformedTraceError(const llvm::Twine &Message) {
+  return llvm::make_error<llvm::StringError>("Malformed memory trace: " +
+                                                 Message,
+                                             llvm::inconvertibleErrorCode());
+}
+
+/// \return the value of type \p T at \p Ptr, which might not be aligned
+template <typename T> static T readUnaligned(const uint8_t *Ptr) {
+  T Out;
+  std::memcpy(&Out, Ptr, sizeof(T));
+  return Out;
+}
+
+/// Calls \p Fn on the index of each set bit of \p Mask, in increasing order,
+/// along with the number of set bits preceding it
+template <typename F> static inline void forEachLane(uint64_t Mask, F Fn) {
+  // Contiguous masks starting at lane zero (e.g. full waves) are handled
+  // with a plain loop the compiler can vectorize
+  if (llvm::isMask_64(Mask) || Mask == 0) {
+    unsigned int NumLanes = std::popcount(Mask);
+    for (unsigned int Lane = 0; Lane < NumLanes; Lane++)
+      Fn(Lane, Lane);
+    return;
+  }
+  for (unsigned int Idx = 0; Mask != 0; Idx++) {
+    Fn(static_cast<unsigned int>(std::countr_zero(Mask)), Idx);
+    Mask &= Mask - 1;
+  }
+}
+
+llvm::Error LaunchTrace::decode(
+    llvm::function_ref<void(const WaveAccess &)> Callback) const {
+  WaveAccess Access{};
+  const uint8_t *Ptr = RecordStream.data();
+  const uint8_t *End = Ptr + RecordStream.size();
+  for (uint64_t RecordIdx = 0; RecordIdx < NumRecords; RecordIdx++) {
+    if (static_cast<size_t>(End - Ptr) < sizeof(RecordHeader))
+      return createMalformedTraceError(
+          llvm::formatv("record {0} of launch {1} is truncated", RecordIdx,
+                        LaunchIdx));
+    auto Header = readUnaligned<RecordHeader>(Ptr);
+    Ptr += sizeof(RecordHeader);
+    if (Header.Exec == 0 || Header.InstrIdx >= Instructions.size() ||
+        Header.Encoding > ENCODING_RAW)
+      return createMalformedTraceError(llvm::formatv(
+          "record {0} of launch {1} has an invalid header", RecordIdx,
+          LaunchIdx));
+    uint64_t Exec = Header.Exec;
+    size_t PayloadSize =
+        getPayloadSizeInWords(Header.Encoding, std::popcount(Exec)) *
+        sizeof(uint64_t);
+    if (static_cast<size_t>(End - Ptr) < PayloadSize)
+      return createMalformedTraceError(
+          llvm::formatv("payload of record {0} of launch {1} is truncated",
+                        RecordIdx, LaunchIdx));
+
+    Access.Instr = &Instructions[Header.InstrIdx];
+    Access.InstrIdx = Header.InstrIdx;
+    Access.HwId = Header.HwId;
+    std::memcpy(Access.WorkgroupId, Header.WorkgroupId,
+                sizeof(Access.WorkgroupId));
+    Access.Exec = Exec;
+    Access.Encoding = static_cast<AddressEncoding>(Header.Encoding);
+    Access.Stride = 0;
+
+    uint64_t Base = Header.Base;
+    uint64_t *Addresses = Access.Addresses;
+    switch (Header.Encoding) {
+    case ENCODING_UNIFORM:
+      forEachLane(Exec, [&](unsigned int Lane, unsigned int) {
+        Addresses[Lane] = Base;
+      });
+      break;
+    case ENCODING_STRIDED: {
+      int64_t Stride = Access.Stride = Header.Stride;
+      auto FirstLane = static_cast<int64_t>(std::countr_zero(Exec));
+      forEachLane(Exec, [&](unsigned int Lane, unsigned int) {
+        Addresses[Lane] = Base + Stride * (int64_t{Lane} - FirstLane);
+      });
+      break;
+    }
+    case ENCODING_DELTA32:
+      forEachLane(Exec, [&](unsigned int Lane, unsigned int Idx) {
+        Addresses[Lane] =
+            Base + readUnaligned<int32_t>(Ptr + Idx * sizeof(int32_t));
+      });
+      break;
+    case ENCODING_RAW:
+      forEachLane(Exec, [&](unsigned int Lane, unsigned int Idx) {
+        Addresses[Lane] = readUnaligned<uint64_t>(Ptr + Idx * sizeof(uint64_t));
+      });
+      break;
+    }
+    Ptr += PayloadSize;
+    Callback(Access);
+  }
+  return llvm::Error::success();
+}
+
+/// \brief Bounds-checked sequential reads from a trace file
+class TraceCursor {
+  llvm::ArrayRef<uint8_t> Data;
+
+  size_t Offset{0};
+
+public:
+  explicit TraceCursor(llvm::ArrayRef<uint8_t> Data) : Data(Data) {}
+
+  [[nodiscard]] bool atEnd() const { return Offset == Data.size(); }
+
+  /// Reads the next \p Size bytes and skips their padding
+  llvm::Expected<llvm::ArrayRef<uint8_t>> readBytes(uint64_t Size,
+                                                    llvm::StringRef What) {
+    uint64_t PaddedSize = alignToWord(Size);
+    if (PaddedSize < Size || Data.size() - Offset < PaddedSize)
+      return createMalformedTraceError(
+          llvm::formatv("{0} at offset {1} is truncated", What, Offset));
+    auto Out = Data.slice(Offset, Size);
+    Offset += PaddedSize;
+    return Out;
+  }
+
+  /// Reads the next value of type \p T
+  template <typename T> llvm::Expected<T> read(llvm::StringRef What) {
+    auto Bytes = readBytes(sizeof(T), What);
+    if (!Bytes)
+      return Bytes.takeError();
+    return readUnaligned<T>(Bytes->data());
+  }
+};
+
+llvm::Error TraceReader::parse() {
+  TraceCursor Cursor(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(Buffer->getBufferStart()),
+      Buffer->getBufferSize()));
+  auto FileHeader = Cursor.read<TraceFileHeader>("file header");
+  if (!FileHeader)
+    return FileHeader.takeError();
+  if (std::memcmp(FileHeader->Magic, TraceFileMagic, sizeof(TraceFileMagic)))
+    return createMalformedTraceError("file magic does not match");
+  if (FileHeader->Version != TraceFileVersion)
+    return createMalformedTraceError(
+        llvm::formatv("unsupported version {0}, expected {1}",
+                      FileHeader->Version, TraceFileVersion));
+
+  while (!Cursor.atEnd()) {
+    auto Header = Cursor.read<LaunchHeader>("launch header");
+    if (!Header)
+      return Header.takeError();
+    LaunchTrace &Launch = Launches.emplace_back();
+    Launch.LaunchIdx = Header->LaunchIdx;
+    Launch.NumRecords = Header->NumRecords;
+    Launch.NumDroppedRecords = Header->NumDroppedRecords;
+
+    auto KernelName = Cursor.readBytes(Header->KernelNameSize, "kernel name");
+    if (!KernelName)
+      return KernelName.takeError();
+    Launch.KernelName = llvm::toStringRef(*KernelName);
+
+    llvm::SmallVector<uint16_t> DescriptionSizes;
+    uint64_t DescriptionsSize = 0;
+    Launch.Instructions.reserve(Header->NumInstructions);
+    for (uint32_t I = 0; I < Header->NumInstructions; I++) {
+      auto Entry = Cursor.read<TracedInstrEntry>("instruction entry");
+      if (!Entry)
+        return Entry.takeError();
+      Launch.Instructions.push_back(
+          {Entry->PC, Entry->AccessSize, Entry->Flags, llvm::StringRef()});
+      DescriptionSizes.push_back(Entry->DescriptionSize);
+      DescriptionsSize += Entry->DescriptionSize;
+    }
+    auto Descriptions =
+        Cursor.readBytes(DescriptionsSize, "instruction descriptions");
+    if (!Descriptions)
+      return Descriptions.takeError();
+    // Point the descriptions of the instructions inside the trace
+    llvm::StringRef RemainingDescriptions = llvm::toStringRef(*Descriptions);
+    for (auto [Instr, Size] :
+         llvm::zip(Launch.Instructions, DescriptionSizes)) {
+      Instr.Description = RemainingDescriptions.take_front(Size);
+      RemainingDescriptions = RemainingDescriptions.drop_front(Size);
+    }
+
+    auto RecordStream =
+        Cursor.readBytes(Header->RecordStreamSize, "record stream");
+    if (!RecordStream)
+      return RecordStream.takeError();
+    Launch.RecordStream = *RecordStream;
+  }
+  return llvm::Error::success();
+}
+
+llvm::Expected<std::unique_ptr<TraceReader>>
+TraceReader::open(llvm::StringRef Path) {
+  // Memory-map the trace instead of reading it, as traces can be very large
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return llvm::createFileError(Path, Buffer.getError());
+  return create(std::move(*Buffer));
+}
+
+llvm::Expected<std::unique_ptr<TraceReader>>
+TraceReader::create(std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  std::unique_ptr<TraceReader> Reader(new TraceReader(std::move(Buffer)));
+  if (auto Err = Reader->parse())
+    return std::move(Err);
+  return std::move(Reader);
+}
+
+} // namespace luthier::memtrace
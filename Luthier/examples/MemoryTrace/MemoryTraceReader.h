@@ -0,0 +1,154 @@
+//===-- MemoryTraceReader.h - Memory Trace Reader Library -------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file describes the reader library of the traces written by the
+/// memory trace tool. The reader memory-maps the trace file and decompresses
+/// its records on demand, without copying the record streams.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_EXAMPLES_MEMORY_TRACE_READER_H
+#define LUTHIER_EXAMPLES_MEMORY_TRACE_READER_H
+#include "MemoryTraceFormat.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
+#include <vector>
+
+namespace luthier::memtrace {
+
+/// \brief An instruction traced during a kernel launch
+struct TracedInstruction {
+  /// Loaded address of the original instruction on the device, or zero if
+  /// it is not known
+  uint64_t PC;
+  /// Number of bytes accessed by each lane
+  uint32_t AccessSize;
+  /// \c TracedInstrFlags of the instruction
+  uint16_t Flags;
+  /// Description of the instruction, in the form of
+  /// <tt>function+offset OPCODE</tt>
+  llvm::StringRef Description;
+};
+
+/// \brief A decompressed record, describing the addresses accessed by the
+/// active lanes of a wave when executing a traced instruction
+struct WaveAccess {
+  /// The instruction executed by the wave
+  const TracedInstruction *Instr;
+  /// Index of \c Instr in the traced instructions of the launch
+  uint32_t InstrIdx;
+  /// Content of the hardware ID register of the wave
+  uint32_t HwId;
+  /// Workgroup ID of the wave in each dimension
+  uint32_t WorkgroupId[3];
+  /// Exec mask of the wave when executing the instruction
+  uint64_t Exec;
+  /// How the addresses were encoded in the trace
+  AddressEncoding Encoding;
+  /// Stride between the addresses of consecutive lanes if \c Encoding is
+  /// \c ENCODING_STRIDED, zero otherwise
+  int64_t Stride;
+  /// Address accessed by each lane of the wave; Only the entries of the
+  /// lanes active in \c Exec are valid
+  uint64_t Addresses[64];
+};
+
+/// \brief The trace of a single kernel launch
+class LaunchTrace {
+  friend class TraceReader;
+
+  uint64_t LaunchIdx{0};
+
+  uint64_t NumRecords{0};
+
+  uint64_t NumDroppedRecords{0};
+
+  llvm::StringRef KernelName{};
+
+  std::vector<TracedInstruction> Instructions{};
+
+  /// Compressed records of the launch, pointing inside the trace file
+  llvm::ArrayRef<uint8_t> RecordStream{};
+
+public:
+  /// \return the index of the launch among all kernel launches of the
+  /// traced application
+  [[nodiscard]] uint64_t getLaunchIdx() const { return LaunchIdx; }
+
+  /// \return the name of the launched kernel
+  [[nodiscard]] llvm::StringRef getKernelName() const { return KernelName; }
+
+  /// \return the number of records in the trace of the launch
+  [[nodiscard]] uint64_t getNumRecords() const { return NumRecords; }
+
+  /// \return the number of records dropped by the tool because its device
+  /// trace buffer was full
+  [[nodiscard]] uint64_t getNumDroppedRecords() const {
+    return NumDroppedRecords;
+  }
+
+  /// \return the instructions traced during the launch
+  [[nodiscard]] llvm::ArrayRef<TracedInstruction> instructions() const {
+    return Instructions;
+  }
+
+  /// \return the compressed record stream of the launch
+  [[nodiscard]] llvm::ArrayRef<uint8_t> getRecordStream() const {
+    return RecordStream;
+  }
+
+  /// Decompresses the records of the launch in the order they were written
+  /// by the device, and invokes \p Callback on each of them
+  /// \details A single \c WaveAccess is reused for all records; Callbacks
+  /// must copy out what they need to keep
+  /// \return an \c llvm::Error if the record stream is malformed
+  llvm::Error
+  decode(llvm::function_ref<void(const WaveAccess &)> Callback) const;
+};
+
+/// \brief Reads the kernel launch traces of a trace file
+class TraceReader {
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+
+  std::vector<LaunchTrace> Launches{};
+
+  explicit TraceReader(std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  llvm::Error parse();
+
+public:
+  /// Opens the trace file at \p Path
+  static llvm::Expected<std::unique_ptr<TraceReader>>
+  open(llvm::StringRef Path);
+
+  /// Creates a reader over the trace held in \p Buffer
+  static llvm::Expected<std::unique_ptr<TraceReader>>
+  create(std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
+  /// \return the kernel launches of the trace, in the order they were
+  /// traced
+  [[nodiscard]] llvm::ArrayRef<LaunchTrace> launches() const {
+    return Launches;
+  }
+};
+
+} // namespace luthier::memtrace
+
+#endif
@@ -0,0 +1,73 @@
+//===-- MemoryAccessHooks.h - Shared Memory Access Hooks --------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the macros used by the example tools to define the
+/// hooks inserted by \c luthier::examples::insertMemoryAccessHook, which
+/// compute the address accessed by each lane of a global, flat or buffer
+/// memory instruction from its address operands, and to get their handles.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_EXAMPLES_MEMORY_ACCESS_HOOKS_H
+#define LUTHIER_EXAMPLES_MEMORY_ACCESS_HOOKS_H
+#include "common/ToolHelpers.h"
+#include <luthier/luthier.h>
+
+#define LUTHIER_EXAMPLES_UNPACK(...) __VA_ARGS__
+
+/// Defines and exports the hooks <tt>\p Name ## FlatAccess</tt>,
+/// <tt>\p Name ## GlobalSAddrAccess</tt> and <tt>\p Name ## BufferAccess</tt>,
+/// which take the address operands of their kind of instruction followed by
+/// the parenthesized parameter list \p Params, and call the device function
+/// \p Handler with the address accessed by the lane followed by the
+/// parenthesized argument list \p Args
+/// \details The base address of a buffer is held in the low 48 bits of the
+/// first two dwords of its resource; The rest of them hold its stride
+#define LUTHIER_EXAMPLES_DEFINE_MEMORY_ACCESS_HOOKS(Name, Handler, Params,     \
+                                                    Args)                      \
+  LUTHIER_HOOK_ANNOTATE Name##FlatAccess(uint64_t VAddr, int32_t Offset,       \
+                                         LUTHIER_EXAMPLES_UNPACK Params) {     \
+    Handler(VAddr + Offset, LUTHIER_EXAMPLES_UNPACK Args);                     \
+  }                                                                            \
+                                                                               \
+  LUTHIER_EXPORT_HOOK_HANDLE(Name##FlatAccess)                                 \
+                                                                               \
+  LUTHIER_HOOK_ANNOTATE Name##GlobalSAddrAccess(                               \
+      uint64_t SAddr, uint32_t VOffset, int32_t Offset,                        \
+      LUTHIER_EXAMPLES_UNPACK Params) {                                        \
+    Handler(SAddr + VOffset + Offset, LUTHIER_EXAMPLES_UNPACK Args);           \
+  }                                                                            \
+                                                                               \
+  LUTHIER_EXPORT_HOOK_HANDLE(Name##GlobalSAddrAccess)                          \
+                                                                               \
+  LUTHIER_HOOK_ANNOTATE Name##BufferAccess(                                    \
+      uint64_t ResourceBase, uint32_t SOffset, uint32_t VOffset,               \
+      int32_t Offset, LUTHIER_EXAMPLES_UNPACK Params) {                        \
+    uint64_t Base = ResourceBase & ((uint64_t{1} << 48) - 1);                  \
+    Handler(Base + SOffset + VOffset + Offset, LUTHIER_EXAMPLES_UNPACK Args);  \
+  }                                                                            \
+                                                                               \
+  LUTHIER_EXPORT_HOOK_HANDLE(Name##BufferAccess)
+
+/// \return the \c luthier::examples::MemoryAccessHooks defined by
+/// \c LUTHIER_EXAMPLES_DEFINE_MEMORY_ACCESS_HOOKS with \p Name
+#define LUTHIER_EXAMPLES_GET_MEMORY_ACCESS_HOOKS(Name)                         \
+  luthier::examples::MemoryAccessHooks {                                       \
+    LUTHIER_GET_HOOK_HANDLE(Name##FlatAccess),                                 \
+        LUTHIER_GET_HOOK_HANDLE(Name##GlobalSAddrAccess),                      \
+        LUTHIER_GET_HOOK_HANDLE(Name##BufferAccess)                            \
+  }
+
+#endif
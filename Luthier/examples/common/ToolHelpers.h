@@ -0,0 +1,592 @@
+//===-- ToolHelpers.h - Shared Example Tool Helpers -------------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains host-side helpers shared by the example tools, used to
+/// hand off the device buffers of a tool between its instrumented kernel
+/// launches, to decode the memory wait counters of its instructions and
+/// calibrate the overhead of timing hooks, to describe the instructions of a
+/// lifted kernel, and to find its global memory accesses and pass their
+/// address operands to hooks.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_EXAMPLES_TOOL_HELPERS_H
+#define LUTHIER_EXAMPLES_TOOL_HELPERS_H
+#include <GCNSubtarget.h>
+#include <SIInstrInfo.h>
+#include <SIMachineFunctionInfo.h>
+#include <Utils/AMDGPUBaseInfo.h>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <limits>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <luthier/common/ErrorCheck.h>
+#include <luthier/hip/HipError.h>
+#include <luthier/hsa/DisableInterceptionScope.h>
+#include <luthier/hsa/HsaError.h>
+#include <luthier/llvm/streams.h>
+#include <luthier/luthier.h>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <variant>
+
+namespace luthier::examples {
+
+/// Copies \p Size bytes from \p Src to \p Dest, either of which can be
+/// device memory, without the copy being intercepted by the tool
+inline llvm::Error copyDeviceMemory(void *Dest, const void *Src,
+                                    size_t Size) {
+  luthier::hsa::DisableUserInterceptionScope Scope;
+  return LUTHIER_HSA_SUCCESS_CHECK(
+      hsa::getHsaApiTable().core_->hsa_memory_copy_fn(Dest, Src, Size));
+}
+
+/// Copies \p Size bytes of the device variable \p Symbol, starting
+/// \p Offset bytes into it, from \p HostBuffer if \p ToDevice is \c true,
+/// or to it otherwise
+inline llvm::Error copyDeviceVariable(void *HostBuffer, const void *Symbol,
+                                      size_t Size, bool ToDevice,
+                                      size_t Offset = 0) {
+  void *DeviceVariable;
+  {
+    luthier::hsa::DisableUserInterceptionScope Scope;
+    LUTHIER_RETURN_ON_ERROR(LUTHIER_HIP_SUCCESS_CHECK(
+        hip::getSavedDispatchTable().hipGetSymbolAddress_fn(&DeviceVariable,
+                                                            Symbol)));
+  }
+  void *DeviceBuffer = static_cast<char *>(DeviceVariable) + Offset;
+  return ToDevice ? copyDeviceMemory(DeviceBuffer, HostBuffer, Size)
+                  : copyDeviceMemory(HostBuffer, DeviceBuffer, Size);
+}
+
+/// \brief Hands off the device buffers of a tool between the launches of
+/// its instrumented kernels
+/// \details The device buffers written by the hooks of a tool are shared
+/// between all of its instrumented kernels, hence only a single instrumented
+/// kernel can be running at any given time. A launch acquires the lease
+/// before it is submitted, and releases it once its results are read back
+/// inside its completion callback. Un-instrumented kernels are free to run
+/// concurrently
+class SharedDeviceBufferLease {
+  /// Protects \c InUse
+  std::mutex Mutex;
+  /// Notifies launches waiting for the buffers to become available
+  std::condition_variable CV;
+  /// Set while an instrumented kernel using the buffers is in flight
+  bool InUse{false};
+
+  void release() {
+    {
+      std::lock_guard Lock(Mutex);
+      InUse = false;
+    }
+    CV.notify_one();
+  }
+
+public:
+  /// Waits for the previous instrumented kernel to release the buffers, then
+  /// acquires them for the kernel launch \p KernelIdx named \p KernelName
+  /// \details A packet submission batch is not written to the hardware queue
+  /// until the submit callback returns; Waiting on the buffers for a second
+  /// packet of the same batch would therefore deadlock. Such packets are
+  /// reported and left to launch their original version instead
+  /// \param [in, out] IsUsedInBatch set if a packet of the current
+  /// submission batch already holds the lease; Set on success
+  /// \return \c true if the lease was acquired
+  bool acquire(bool &IsUsedInBatch, uint32_t KernelIdx,
+               llvm::StringRef KernelName) {
+    if (IsUsedInBatch) {
+      luthier::errs() << llvm::formatv(
+          "Kernel {0} - {1} shares its submission batch with another "
+          "instrumented kernel; Launching its original version instead.\n",
+          KernelIdx, KernelName);
+      return false;
+    }
+    std::unique_lock Lock(Mutex);
+    CV.wait(Lock, [this]() { return !InUse; });
+    InUse = true;
+    IsUsedInBatch = true;
+    return true;
+  }
+
+  /// Registers a completion callback for the instrumented kernel dispatched
+  /// by \p Packet, which holds the lease; The callback invokes \p ReadBack
+  /// to copy the results of the kernel out of the device buffers, releases
+  /// the lease, then passes the results to \p Report
+  /// \note As completion callbacks are invoked one at a time, \p Report can
+  /// update the host-side state of the tool without synchronization
+  template <typename ReadBackFn, typename ReportFn>
+  llvm::Error onDispatchComplete(hsa_kernel_dispatch_packet_t &Packet,
+                                 ReadBackFn ReadBack, ReportFn Report) {
+    return hsa::onDispatchComplete(
+        Packet, [this, ReadBack = std::move(ReadBack),
+                 Report = std::move(Report)](
+                    const hsa_kernel_dispatch_packet_t &) {
+          auto Results = ReadBack();
+          release();
+          Report(std::move(Results));
+        });
+  }
+};
+
+/// Hardware counters of outstanding memory operations waited on by the
+/// wait instructions
+enum WaitCounter {
+  /// Vector memory loads, and all vector memory operations on targets
+  /// without a separate store counter
+  VM_CNT = 0,
+  /// LDS, GDS, scalar memory and message operations; Only scalar memory and
+  /// message operations on GFX12+
+  LGKM_CNT = 1,
+  /// Vector memory operations without a return value on GFX10+
+  VS_CNT = 2,
+  /// LDS and GDS operations on GFX12+
+  DS_CNT = 3,
+  NUM_WAIT_COUNTERS = 4
+};
+
+/// Number of outstanding operations allowed by a wait for each counter
+using WaitCounts = std::array<unsigned int, NUM_WAIT_COUNTERS>;
+
+/// Count of a counter that is not waited on
+inline constexpr unsigned int NoWait =
+    std::numeric_limits<unsigned int>::max();
+
+/// \return the counts waited on by \p MI if it waits on any of the memory
+/// counters, or \c std::nullopt otherwise
+/// \note The sample and BVH counters of GFX12+ are not tracked
+inline std::optional<WaitCounts>
+getWaitCounts(const llvm::MachineInstr &MI,
+              const llvm::AMDGPU::IsaVersion &IV) {
+  WaitCounts Counts;
+  Counts.fill(NoWait);
+  // A count equal to the mask of its field means the counter is not
+  // waited on
+  auto SetCount = [&](WaitCounter Counter, unsigned int Count,
+                      unsigned int Mask) {
+    if (Count < Mask)
+      Counts[Counter] = Count;
+  };
+  switch (MI.getOpcode()) {
+  case llvm::AMDGPU::S_WAITCNT: {
+    unsigned int Vmcnt, Expcnt, Lgkmcnt;
+    llvm::AMDGPU::decodeWaitcnt(IV, MI.getOperand(0).getImm(), Vmcnt, Expcnt,
+                                Lgkmcnt);
+    SetCount(VM_CNT, Vmcnt, llvm::AMDGPU::getVmcntBitMask(IV));
+    SetCount(LGKM_CNT, Lgkmcnt, llvm::AMDGPU::getLgkmcntBitMask(IV));
+    break;
+  }
+  // The single counter waits of GFX10 and GFX11 also take an SGPR operand
+  // with an additional count, which is always null in compiler-generated
+  // code
+  case llvm::AMDGPU::S_WAITCNT_VMCNT:
+    SetCount(VM_CNT, MI.getOperand(1).getImm(),
+             llvm::AMDGPU::getVmcntBitMask(IV));
+    break;
+  case llvm::AMDGPU::S_WAITCNT_LGKMCNT:
+    SetCount(LGKM_CNT, MI.getOperand(1).getImm(),
+             llvm::AMDGPU::getLgkmcntBitMask(IV));
+    break;
+  case llvm::AMDGPU::S_WAITCNT_VSCNT:
+    // The count field of s_waitcnt_vscnt is 6 bits wide
+    SetCount(VS_CNT, MI.getOperand(1).getImm(), 0x3F);
+    break;
+  // GFX12+ waits on each counter with a separate instruction, except for
+  // the combined waits on the DS counter and the load or store counter
+  case llvm::AMDGPU::S_WAIT_LOADCNT:
+    SetCount(VM_CNT, MI.getOperand(0).getImm(),
+             llvm::AMDGPU::getLoadcntBitMask(IV));
+    break;
+  case llvm::AMDGPU::S_WAIT_STORECNT:
+    SetCount(VS_CNT, MI.getOperand(0).getImm(),
+             llvm::AMDGPU::getStorecntBitMask(IV));
+    break;
+  case llvm::AMDGPU::S_WAIT_KMCNT:
+    SetCount(LGKM_CNT, MI.getOperand(0).getImm(),
+             llvm::AMDGPU::getKmcntBitMask(IV));
+    break;
+  case llvm::AMDGPU::S_WAIT_DSCNT:
+    SetCount(DS_CNT, MI.getOperand(0).getImm(),
+             llvm::AMDGPU::getDscntBitMask(IV));
+    break;
+  case llvm::AMDGPU::S_WAIT_LOADCNT_DSCNT: {
+    llvm::AMDGPU::Waitcnt Wait =
+        llvm::AMDGPU::decodeLoadcntDscnt(IV, MI.getOperand(0).getImm());
+    SetCount(VM_CNT, Wait.LoadCnt, llvm::AMDGPU::getLoadcntBitMask(IV));
+    SetCount(DS_CNT, Wait.DsCnt, llvm::AMDGPU::getDscntBitMask(IV));
+    break;
+  }
+  case llvm::AMDGPU::S_WAIT_STORECNT_DSCNT: {
+    llvm::AMDGPU::Waitcnt Wait =
+        llvm::AMDGPU::decodeStorecntDscnt(IV, MI.getOperand(0).getImm());
+    SetCount(VS_CNT, Wait.StoreCnt, llvm::AMDGPU::getStorecntBitMask(IV));
+    SetCount(DS_CNT, Wait.DsCnt, llvm::AMDGPU::getDscntBitMask(IV));
+    break;
+  }
+  default:
+    return std::nullopt;
+  }
+  if (llvm::all_of(Counts, [](unsigned int C) { return C == NoWait; }))
+    return std::nullopt;
+  return Counts;
+}
+
+/// \return the memory counters incremented by \p MI when it is issued
+inline llvm::SmallVector<WaitCounter, 2>
+getCountersOf(const llvm::MachineInstr &MI, const llvm::GCNSubtarget &ST) {
+  llvm::SmallVector<WaitCounter, 2> Out;
+  if (llvm::SIInstrInfo::usesVM_CNT(MI)) {
+    bool HasReturnValue = MI.getDesc().getNumDefs() != 0;
+    Out.push_back(ST.hasVscnt() && MI.mayStore() && !HasReturnValue
+                      ? VS_CNT
+                      : VM_CNT);
+  }
+  if (llvm::SIInstrInfo::usesLGKM_CNT(MI)) {
+    // LDS accesses, including the ones made by flat instructions, have their
+    // own counter on GFX12+
+    bool IsDS = llvm::SIInstrInfo::isDS(MI) || llvm::SIInstrInfo::isFLAT(MI);
+    Out.push_back(IsDS && llvm::AMDGPU::isGFX12Plus(ST) ? DS_CNT : LGKM_CNT);
+  }
+  return Out;
+}
+
+/// \return an instruction of the entry block of \p MF before which a pair
+/// of timing hooks can be inserted to measure their own overhead, or
+/// \c nullptr if there is none
+/// \details The hooks reading the clock drain the outstanding memory
+/// operations of the wave along the way; An empty bracket only measures the
+/// cost of the hooks themselves if no operation can be outstanding when it
+/// is entered. The returned instruction neither waits on nor increments any
+/// memory counter, and every operation issued before it has been waited on.
+/// The bracket is formed by inserting the entry hook before the returned
+/// instruction and the exit hook before the one right after it, and
+/// therefore includes the issue of the returned instruction
+/// \note Hooks inserted before the same instruction run in the order they
+/// were inserted; The entry hook of the bracket must be inserted after the
+/// other hooks of its instruction, and its exit hook before them, for the
+/// bracket not to include them
+inline llvm::MachineInstr *findHookCalibrationPoint(llvm::MachineFunction &MF) {
+  const auto &ST = MF.getSubtarget<llvm::GCNSubtarget>();
+  llvm::AMDGPU::IsaVersion IV = llvm::AMDGPU::getIsaVersion(ST.getCPU());
+  std::array<bool, NUM_WAIT_COUNTERS> IsOutstanding{};
+  llvm::MachineBasicBlock &MBB = MF.front();
+  for (auto It = MBB.begin(); It != MBB.end(); ++It) {
+    if (auto Counts = getWaitCounts(*It, IV)) {
+      for (unsigned int C = 0; C < NUM_WAIT_COUNTERS; C++) {
+        if ((*Counts)[C] == 0)
+          IsOutstanding[C] = false;
+      }
+      continue;
+    }
+    auto Counters = getCountersOf(*It, ST);
+    for (WaitCounter C : Counters)
+      IsOutstanding[C] = true;
+    if (Counters.empty() && !It->isTerminator() &&
+        std::next(It) != MBB.end() && !llvm::is_contained(IsOutstanding, true))
+      return &*It;
+  }
+  return nullptr;
+}
+
+/// \return the overhead of a pair of timing hooks per execution, measured by
+/// an empty bracket which took \p Time over \p Executions, or zero if the
+/// bracket was not executed
+inline double getHookOverhead(uint64_t Time, uint64_t Executions) {
+  return Executions == 0
+             ? 0.0
+             : static_cast<double>(Time) / static_cast<double>(Executions);
+}
+
+/// \return \p Time measured over \p Executions of a bracket of timing
+/// hooks, minus the \p Overhead of the hooks per execution
+inline uint64_t subtractHookOverhead(uint64_t Time, uint64_t Executions,
+                                     double Overhead) {
+  auto Total = static_cast<uint64_t>(
+      std::llround(Overhead * static_cast<double>(Executions)));
+  return Time > Total ? Time - Total : 0;
+}
+
+/// \return a description of \p MI in the form of
+/// <tt>function+offset OPCODE</tt>
+/// \param [out] LoadedAddress if not \c nullptr, set to the loaded address
+/// of \p MI on the device if known, or zero otherwise
+inline llvm::Expected<std::string>
+describeInstruction(const LiftedRepresentation &LR,
+                    const llvm::MachineInstr &MI,
+                    uint64_t *LoadedAddress = nullptr) {
+  const llvm::MachineFunction &MF = *MI.getMF();
+  llvm::StringRef OpcodeName =
+      MF.getSubtarget().getInstrInfo()->getName(MI.getOpcode());
+  if (LoadedAddress)
+    *LoadedAddress = 0;
+  const hsa::Instr *Inst = LR.getLiftedEquivalent(MI);
+  if (!Inst)
+    return llvm::formatv("{0} {1}", MF.getName(), OpcodeName).str();
+  auto SymbolAddress =
+      Inst->getLoadedCodeObjectSymbol().getLoadedSymbolAddress();
+  LUTHIER_RETURN_ON_ERROR(SymbolAddress.takeError());
+  uint64_t PC = Inst->getLoadedDeviceAddress();
+  if (LoadedAddress)
+    *LoadedAddress = PC;
+  return llvm::formatv("{0}+{1:x} {2}", MF.getName(), PC - *SymbolAddress,
+                       OpcodeName)
+      .str();
+}
+
+/// An argument passed to a hook; Either a constant, or the value of a
+/// physical register at the instrumentation point
+typedef std::variant<llvm::Constant *, llvm::MCRegister> HookArgument;
+
+/// Appends the 32-bit registers making up the SGPR \p Reg to \p Dwords;
+/// Appends nothing if \p Reg is not an SGPR
+inline void getSGPRDwords(llvm::MCRegister Reg, const llvm::SIRegisterInfo &TRI,
+                          llvm::SmallVectorImpl<llvm::MCRegister> &Dwords) {
+  const llvm::TargetRegisterClass *RC = TRI.getPhysRegBaseClass(Reg);
+  if (!RC || !llvm::SIRegisterInfo::isSGPRClass(RC))
+    return;
+  unsigned int NumDwords = TRI.getRegSizeInBits(*RC) / 32;
+  if (NumDwords <= 1) {
+    Dwords.push_back(Reg);
+    return;
+  }
+  for (unsigned int I = 0; I < NumDwords; I++)
+    Dwords.push_back(TRI.getSubReg(
+        Reg, llvm::SIRegisterInfo::getSubRegFromChannel(I)));
+}
+
+/// \return the SGPRs of \p MF which may hold a dword of the scratch buffer
+/// resource
+/// \details Callable functions receive the resource in <tt>s[0:3]</tt>, and
+/// kernels in their private segment buffer user SGPRs if enabled; The
+/// resource is then followed through the scalar moves and copies of \p MF,
+/// regardless of where they are in its control flow
+inline llvm::SmallDenseSet<llvm::MCRegister, 16>
+getScratchResourceDwords(const llvm::MachineFunction &MF) {
+  const auto &TRI = *MF.getSubtarget<llvm::GCNSubtarget>().getRegisterInfo();
+  const auto &MFI = *MF.getInfo<llvm::SIMachineFunctionInfo>();
+  llvm::SmallVector<llvm::MCRegister, 16> Seeds;
+  if (!MFI.isEntryFunction())
+    getSGPRDwords(llvm::AMDGPU::SGPR0_SGPR1_SGPR2_SGPR3, TRI, Seeds);
+  if (llvm::MCRegister PrivateSegmentBuffer = MFI.getPreloadedReg(
+          llvm::AMDGPUFunctionArgInfo::PRIVATE_SEGMENT_BUFFER))
+    getSGPRDwords(PrivateSegmentBuffer, TRI, Seeds);
+  if (llvm::MCRegister RSrc = MFI.getScratchRSrcReg();
+      RSrc != llvm::AMDGPU::PRIVATE_RSRC_REG)
+    getSGPRDwords(RSrc, TRI, Seeds);
+  llvm::SmallDenseSet<llvm::MCRegister, 16> Dwords(Seeds.begin(),
+                                                   Seeds.end());
+  if (Dwords.empty())
+    return Dwords;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (const auto &MBB : MF) {
+      for (const auto &MI : MBB) {
+        unsigned int Opcode = MI.getOpcode();
+        if ((Opcode != llvm::AMDGPU::S_MOV_B32 &&
+             Opcode != llvm::AMDGPU::S_MOV_B64 &&
+             Opcode != llvm::AMDGPU::COPY) ||
+            !MI.getOperand(1).isReg())
+          continue;
+        llvm::SmallVector<llvm::MCRegister, 2> Src, Dst;
+        getSGPRDwords(MI.getOperand(1).getReg().asMCReg(), TRI, Src);
+        if (Src.empty() || !llvm::all_of(Src, [&](llvm::MCRegister Reg) {
+              return Dwords.contains(Reg);
+            }))
+          continue;
+        getSGPRDwords(MI.getOperand(0).getReg().asMCReg(), TRI, Dst);
+        for (llvm::MCRegister Reg : Dst)
+          Changed |= Dwords.insert(Reg).second;
+      }
+    }
+  }
+  return Dwords;
+}
+
+/// \return \c true if \p MI accesses global memory: A global or flat memory
+/// instruction other than a scratch one, or a buffer memory instruction not
+/// addressing the scratch buffer resource
+/// \details Scratch accesses are swizzled per lane by the hardware, and are
+/// not part of the memory allocated by the application. Flat instructions
+/// addressing the private aperture cannot be told apart before they execute,
+/// and are still considered global
+inline bool isGlobalMemoryAccess(const llvm::MachineInstr &MI) {
+  if (!MI.mayLoad() && !MI.mayStore())
+    return false;
+  if (llvm::SIInstrInfo::isFLAT(MI))
+    return !llvm::SIInstrInfo::isFLATScratch(MI);
+  if (!llvm::SIInstrInfo::isMUBUF(MI) && !llvm::SIInstrInfo::isMTBUF(MI))
+    return false;
+  const auto &ST = MI.getMF()->getSubtarget<llvm::GCNSubtarget>();
+  const auto *SRsrc =
+      ST.getInstrInfo()->getNamedOperand(MI, llvm::AMDGPU::OpName::srsrc);
+  if (!SRsrc || !SRsrc->isReg())
+    return false;
+  return !getScratchResourceDwords(*MI.getMF())
+              .contains(ST.getRegisterInfo()->getSubReg(SRsrc->getReg(),
+                                                        llvm::AMDGPU::sub0));
+}
+
+/// \return the number of bytes accessed by each lane when executing the
+/// memory instruction \p MI
+inline uint32_t getAccessSizeInBytes(const llvm::MachineInstr &MI,
+                                     const llvm::SIInstrInfo &TII,
+                                     const llvm::SIRegisterInfo &TRI) {
+  unsigned int Opcode = MI.getOpcode();
+  llvm::StringRef Name = TII.getName(Opcode);
+  // Sub-dword accesses still use a full VGPR for their data
+  if (Name.contains("BYTE"))
+    return 1;
+  if (Name.contains("SHORT"))
+    return 2;
+  const llvm::MachineOperand *Data =
+      TII.getNamedOperand(MI, llvm::AMDGPU::OpName::vdata);
+  if (!Data)
+    Data = TII.getNamedOperand(MI, llvm::AMDGPU::OpName::vdst);
+  // LDS DMA loads don't have a data operand, and move a dword per lane
+  if (!Data || !Data->isReg())
+    return 4;
+  uint32_t Size =
+      TRI.getRegSizeInBits(*TRI.getPhysRegBaseClass(Data->getReg())) / 8;
+  // D16 format accesses move a 16-bit value per component; Components are
+  // packed two per VGPR, or take a full VGPR each on targets with unpacked
+  // D16 memory instructions. Packed accesses with three components leave
+  // the last half of their data operand unused
+  if (Name.contains("FORMAT_D16")) {
+    int NumComponents = llvm::SIInstrInfo::isMTBUF(MI)
+                            ? llvm::AMDGPU::getMTBUFElements(Opcode)
+                            : llvm::AMDGPU::getMUBUFElements(Opcode);
+    if (NumComponents > 0)
+      return NumComponents * 2;
+    return MI.getMF()->getSubtarget<llvm::GCNSubtarget>().hasUnpackedD16VMem()
+               ? Size / 2
+               : Size;
+  }
+  // The data of compare-and-swap atomics also holds the compared value
+  return Name.contains("CMPSWAP") ? Size / 2 : Size;
+}
+
+/// Appends the arguments describing the address accessed by the global or
+/// flat memory instruction \p MI to \p Args: Its 64-bit vector address, or
+/// its 64-bit scalar base address and 32-bit vector offset if it has a scalar
+/// base address, followed by its signed 32-bit immediate offset
+/// \return \c true if \p MI has a scalar base address
+inline bool getFlatAddressArgs(const llvm::MachineInstr &MI,
+                               const llvm::SIInstrInfo &TII,
+                               llvm::SmallVectorImpl<HookArgument> &Args) {
+  auto &Ctx = MI.getMF()->getFunction().getContext();
+  // Global instructions with a scalar base address only use a 32-bit
+  // offset in their vector address operand
+  const auto *SAddr = TII.getNamedOperand(MI, llvm::AMDGPU::OpName::saddr);
+  if (SAddr)
+    Args.push_back(SAddr->getReg().asMCReg());
+  Args.push_back(
+      TII.getNamedOperand(MI, llvm::AMDGPU::OpName::vaddr)->getReg().asMCReg());
+  Args.push_back(llvm::ConstantInt::getSigned(
+      llvm::Type::getInt32Ty(Ctx),
+      TII.getNamedOperand(MI, llvm::AMDGPU::OpName::offset)->getImm()));
+  return SAddr != nullptr;
+}
+
+/// Appends the arguments describing the address accessed by the buffer
+/// memory instruction \p MI to \p Args: The first two dwords of its buffer
+/// resource as a 64-bit value, its 32-bit scalar offset, its 32-bit vector
+/// offset and its signed 32-bit immediate offset
+/// \details The base address of the buffer is held in the low 48 bits of the
+/// first two dwords of the resource; The rest hold the stride of the buffer
+/// \return \c false without appending any arguments if \p MI is not
+/// addressed with a byte offset (i.e. is indexed), as the stride and
+/// swizzling of indexed accesses are not read from the buffer resource
+inline bool getBufferAddressArgs(const llvm::MachineInstr &MI,
+                                 const llvm::SIInstrInfo &TII,
+                                 const llvm::SIRegisterInfo &TRI,
+                                 llvm::SmallVectorImpl<HookArgument> &Args) {
+  llvm::StringRef Name = TII.getName(MI.getOpcode());
+  bool IsOffEn = Name.contains("_OFFEN");
+  if (!IsOffEn && !Name.contains("_OFFSET"))
+    return false;
+  auto *Int32Ty =
+      llvm::Type::getInt32Ty(MI.getMF()->getFunction().getContext());
+
+  Args.push_back(TRI.getSubReg(
+      TII.getNamedOperand(MI, llvm::AMDGPU::OpName::srsrc)->getReg(),
+      llvm::AMDGPU::sub0_sub1));
+  HookArgument SOffset = llvm::ConstantInt::get(Int32Ty, 0);
+  if (const auto *SOffsetOp =
+          TII.getNamedOperand(MI, llvm::AMDGPU::OpName::soffset)) {
+    if (SOffsetOp->isImm())
+      SOffset = llvm::ConstantInt::get(Int32Ty, SOffsetOp->getImm());
+    else if (SOffsetOp->getReg() != llvm::AMDGPU::SGPR_NULL)
+      SOffset = SOffsetOp->getReg().asMCReg();
+  }
+  Args.push_back(SOffset);
+  if (IsOffEn)
+    Args.push_back(TII.getNamedOperand(MI, llvm::AMDGPU::OpName::vaddr)
+                       ->getReg()
+                       .asMCReg());
+  else
+    Args.push_back(llvm::ConstantInt::get(Int32Ty, 0));
+  Args.push_back(llvm::ConstantInt::getSigned(
+      Int32Ty,
+      TII.getNamedOperand(MI, llvm::AMDGPU::OpName::offset)->getImm()));
+  return true;
+}
+
+/// \brief Hooks inserted before the global, flat and buffer memory
+/// instructions of a kernel by \c insertMemoryAccessHook
+/// \details Each hook takes the address arguments of its kind of instruction
+/// first, followed by the arguments of the tool
+struct MemoryAccessHooks {
+  /// Takes <tt>(uint64_t VAddr, int32_t Offset, ...)</tt>
+  const void *Flat;
+  /// Takes <tt>(uint64_t SAddr, uint32_t VOffset, int32_t Offset, ...)</tt>
+  const void *GlobalSAddr;
+  /// Takes <tt>(uint64_t ResourceBase, uint32_t SOffset, uint32_t VOffset,
+  /// int32_t Offset, ...)</tt>
+  const void *Buffer;
+};
+
+/// Inserts the hook of \p Hooks matching the global, flat or buffer memory
+/// instruction \p MI before it, passing it the address arguments of \p MI
+/// followed by \p ToolArgs
+/// \return \c true if \p MI was instrumented; Indexed buffer instructions
+/// are not supported
+inline llvm::Expected<bool>
+insertMemoryAccessHook(InstrumentationTask &IT, llvm::MachineInstr &MI,
+                       const MemoryAccessHooks &Hooks,
+                       llvm::ArrayRef<HookArgument> ToolArgs) {
+  const auto &ST = MI.getMF()->getSubtarget<llvm::GCNSubtarget>();
+  const llvm::SIInstrInfo &TII = *ST.getInstrInfo();
+  llvm::SmallVector<HookArgument, 8> Args;
+  const void *Hook;
+  if (llvm::SIInstrInfo::isFLAT(MI)) {
+    Hook = getFlatAddressArgs(MI, TII, Args) ? Hooks.GlobalSAddr : Hooks.Flat;
+  } else {
+    if (!getBufferAddressArgs(MI, TII, *ST.getRegisterInfo(), Args))
+      return false;
+    Hook = Hooks.Buffer;
+  }
+  Args.append(ToolArgs.begin(), ToolArgs.end());
+  LUTHIER_RETURN_ON_ERROR(IT.insertHookBefore(MI, Hook, Args));
+  return true;
+}
+
+} // namespace luthier::examples
+
+#endif
@@ -0,0 +1,224 @@
+//===-- HashMap.h - Device-side Concurrent Hash Map -------------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file describes a lock-free, open-addressing hash map of 64-bit keys to
+/// 64-bit counters, which can be updated from hooks. It is meant for tools
+/// counting per memory page, per PC or per unique address, where the key space
+/// is too large or too sparse for a fixed \c __device__ array.
+///
+/// The map lives in device memory allocated by a \c luthier::DeviceHashMap on
+/// the host, which copies its \c DeviceHashMapDescriptor into a
+/// \c __device__ variable of the tool before the instrumented kernel is
+/// launched. Hooks pass that variable to \c hashMapIncrement or
+/// \c hashMapAdd.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_DEVICE_HASH_MAP_H
+#define LUTHIER_DEVICE_HASH_MAP_H
+#include <cstdint>
+#include <luthier/device/Wave.h>
+
+namespace luthier {
+
+/// Key of the empty slots of a hash map; It cannot be inserted in the map
+static constexpr uint64_t HashMapEmptyKey = ~uint64_t{0};
+
+/// Slot index returned when a key could not be found or inserted
+static constexpr uint64_t HashMapNoSlot = ~uint64_t{0};
+
+/// \brief What happens to an update whose key can not be inserted, because
+/// all the slots within the maximum probe distance of its hash are taken by
+/// other keys
+enum HashMapOverflowPolicy : uint32_t {
+  /// The update is dropped; Only the number of dropped updates is kept
+  HASH_MAP_OVERFLOW_DROP = 0,
+  /// The update is added to the overflow value of the map instead, which
+  /// keeps the sum of all the values of the map exact
+  HASH_MAP_OVERFLOW_ACCUMULATE = 1
+};
+
+/// \brief Statistics of a hash map, updated by the device
+struct HashMapDeviceStatistics {
+  /// Number of key lookups performed; Updates of the same key by the lanes
+  /// of a wave only perform a single lookup
+  uint64_t NumLookups;
+  /// Number of slots probed by all lookups
+  uint64_t NumProbes;
+  /// Number of lane updates which could not find a slot
+  uint64_t NumOverflowedUpdates;
+  /// Sum of the values of the overflowed updates, if the map uses the
+  /// \c HASH_MAP_OVERFLOW_ACCUMULATE policy
+  uint64_t OverflowValue;
+};
+
+/// \brief Describes the device memory of a hash map to the hooks updating it
+/// \details Keys and values are kept in separate arrays, so that looking up a
+/// key only touches the key array. The number of slots is a power of two
+struct DeviceHashMapDescriptor {
+  /// Keys of the slots; Empty slots hold \c HashMapEmptyKey
+  uint64_t *Keys;
+  /// Values of the slots
+  uint64_t *Values;
+  /// Number of slots minus one
+  uint64_t CapacityMask;
+  /// Maximum number of slots probed when looking up a key
+  uint32_t MaxProbes;
+  /// \c HashMapOverflowPolicy of the map
+  uint32_t OverflowPolicy;
+  /// Statistics of the map
+  HashMapDeviceStatistics *Stats;
+};
+
+/// \return the hash of \p Key, used as the first slot probed for it
+/// \details Uses the finalizer of SplitMix64, which mixes all the bits of the
+/// key; Addresses and PCs otherwise only differ in a few of their bits
+constexpr uint64_t hashMapHash(uint64_t Key) {
+  Key = (Key ^ (Key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  Key = (Key ^ (Key >> 27)) * 0x94d049bb133111ebULL;
+  return Key ^ (Key >> 31);
+}
+
+#if defined(__HIPCC__)
+
+namespace detail {
+
+__attribute__((device, always_inline)) inline void
+hashMapAtomicAdd(uint64_t *Address, uint64_t Value) {
+  (void)__hip_atomic_fetch_add(Address, Value, __ATOMIC_RELAXED,
+                               __HIP_MEMORY_SCOPE_AGENT);
+}
+
+} // namespace detail
+
+/// Finds the slot of \p Key in \p Map, or inserts \p Key in the first empty
+/// slot probed if it is not present
+/// \details Slots are probed linearly, starting from the hash of \p Key. An
+/// empty slot is claimed with a compare-and-swap; If another lane claims it
+/// first with a different key, probing continues with the next slot. As keys
+/// are never removed, a key is never inserted in two slots. This function is
+/// executed independently by each of the calling lanes; Use
+/// \c hashMapIncrement and \c hashMapAdd to aggregate the lookups of a wave
+/// \param [out] NumProbes the number of slots probed
+/// \return the index of the slot of \p Key, or \c HashMapNoSlot if none
+/// was found within the maximum probe distance of the map, or if \p Key is
+/// \c HashMapEmptyKey
+__attribute__((device, always_inline)) inline uint64_t
+hashMapFindOrInsert(const DeviceHashMapDescriptor &Map, uint64_t Key,
+                    uint32_t &NumProbes) {
+  NumProbes = 0;
+  if (Key == HashMapEmptyKey)
+    return HashMapNoSlot;
+  uint64_t Slot = hashMapHash(Key) & Map.CapacityMask;
+  for (NumProbes = 1; NumProbes <= Map.MaxProbes; NumProbes++) {
+    uint64_t Current = __hip_atomic_load(&Map.Keys[Slot], __ATOMIC_RELAXED,
+                                         __HIP_MEMORY_SCOPE_AGENT);
+    if (Current == HashMapEmptyKey) {
+      // On failure, Current is set to the key that claimed the slot first
+      __hip_atomic_compare_exchange_strong(
+          &Map.Keys[Slot], &Current, Key, __ATOMIC_RELAXED, __ATOMIC_RELAXED,
+          __HIP_MEMORY_SCOPE_AGENT);
+      if (Current == HashMapEmptyKey)
+        return Slot;
+    }
+    if (Current == Key)
+      return Slot;
+    Slot = (Slot + 1) & Map.CapacityMask;
+  }
+  NumProbes = Map.MaxProbes;
+  return HashMapNoSlot;
+}
+
+/// Adds \p Value to the value of \p Key in \p Map for each active lane, or
+/// the number of lanes updating \p Key if \p CountLanes is \c true
+/// \details Lanes are grouped by key: In each iteration, the first lane not
+/// yet served looks up its key on behalf of all the lanes with the same key,
+/// and broadcasts the slot to them. This way, a wave performs a single lookup
+/// per distinct key, and the number of iterations only depends on the number
+/// of distinct keys of the wave. Statistics are accumulated in uniform
+/// registers and added once per call
+__attribute__((device, always_inline)) inline void
+hashMapUpdate(const DeviceHashMapDescriptor &Map, uint64_t Key,
+              uint64_t Value, bool CountLanes) {
+  uint32_t Lane = __lane_id();
+  uint32_t FirstLane = __ffsll(__builtin_amdgcn_read_exec()) - 1;
+  bool IsPending = true;
+  uint64_t NumLookups = 0;
+  uint64_t NumProbes = 0;
+  uint64_t NumOverflowedUpdates = 0;
+  while (true) {
+    uint64_t PendingMask = __ballot(IsPending);
+    if (PendingMask == 0)
+      break;
+    uint32_t Leader = __ffsll(PendingMask) - 1;
+    bool IsMatching = IsPending && Key == readLane64(Key, Leader);
+    uint32_t NumMatching = __popcll(__ballot(IsMatching));
+
+    uint64_t Slot = HashMapNoSlot;
+    uint32_t LeaderProbes = 0;
+    if (Lane == Leader)
+      Slot = hashMapFindOrInsert(Map, Key, LeaderProbes);
+    Slot = readLane64(Slot, Leader);
+    NumProbes += __builtin_amdgcn_readlane(LeaderProbes, Leader);
+    NumLookups++;
+
+    uint64_t *Target = nullptr;
+    if (Slot != HashMapNoSlot) {
+      Target = &Map.Values[Slot];
+    } else {
+      NumOverflowedUpdates += NumMatching;
+      if (Map.OverflowPolicy == HASH_MAP_OVERFLOW_ACCUMULATE)
+        Target = &Map.Stats->OverflowValue;
+    }
+    if (Target != nullptr) {
+      if (CountLanes) {
+        if (Lane == Leader)
+          detail::hashMapAtomicAdd(Target, NumMatching);
+      } else if (IsMatching) {
+        detail::hashMapAtomicAdd(Target, Value);
+      }
+    }
+    IsPending &= !IsMatching;
+  }
+  if (Lane == FirstLane) {
+    detail::hashMapAtomicAdd(&Map.Stats->NumLookups, NumLookups);
+    detail::hashMapAtomicAdd(&Map.Stats->NumProbes, NumProbes);
+    if (NumOverflowedUpdates != 0)
+      detail::hashMapAtomicAdd(&Map.Stats->NumOverflowedUpdates,
+                               NumOverflowedUpdates);
+  }
+}
+
+/// Increments the value of \p Key in \p Map once for each active lane
+/// \details Only a single atomic is performed per distinct key of the wave
+__attribute__((device, always_inline)) inline void
+hashMapIncrement(const DeviceHashMapDescriptor &Map, uint64_t Key) {
+  hashMapUpdate(Map, Key, 1, true);
+}
+
+/// Adds the \p Value of each active lane to the value of its \p Key in
+/// \p Map
+/// \details Lookups are aggregated per distinct key of the wave, but each
+/// lane adds its own \p Value to the slot with an atomic
+__attribute__((device, always_inline)) inline void
+hashMapAdd(const DeviceHashMapDescriptor &Map, uint64_t Key, uint64_t Value) {
+  hashMapUpdate(Map, Key, Value, false);
+}
+
+#endif
+
+} // namespace luthier
+
+#endif
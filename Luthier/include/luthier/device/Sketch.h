@@ -0,0 +1,201 @@
+//===-- Sketch.h - Device-side Probabilistic Sketches -----------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file describes fixed-size, mergeable sketches which can be updated
+/// from hooks, for tools that only need estimates over key spaces too large
+/// to count exactly:
+/// - HyperLogLog, which estimates the number of distinct keys (e.g. cache
+/// lines or pages) added to it.
+/// - Count-min, which estimates how many times each key (e.g. a PC or a page)
+/// was added to it, and never under-estimates.
+///
+/// The memory of the sketches is managed on the host by
+/// \c luthier::DeviceHyperLogLog and \c luthier::DeviceCountMinSketch, which
+/// copy their descriptors into \c __device__ variables of the tool. The
+/// functions mapping keys to registers and counters are shared with the host,
+/// so that sketches read back from the device can be queried and merged.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_DEVICE_SKETCH_H
+#define LUTHIER_DEVICE_SKETCH_H
+#include "luthier/device/HashMap.h"
+#include <cstdint>
+
+namespace luthier {
+
+/// Smallest log2 of the number of registers of a HyperLogLog sketch
+static constexpr uint32_t HyperLogLogMinPrecision = 4;
+
+/// Largest log2 of the number of registers of a HyperLogLog sketch
+static constexpr uint32_t HyperLogLogMaxPrecision = 18;
+
+/// \brief Describes the device memory of a HyperLogLog sketch to the hooks
+/// updating it
+struct DeviceHyperLogLogDescriptor {
+  /// Registers of the sketch, each holding the largest rank of the hashes
+  /// mapped to it; Registers are 32 bits wide to be updated with an atomic
+  /// max instruction
+  uint32_t *Registers;
+  /// Log2 of the number of registers
+  uint32_t Precision;
+};
+
+/// \brief Describes the device memory of a count-min sketch to the hooks
+/// updating it
+struct DeviceCountMinDescriptor {
+  /// Counters of the sketch, laid out as \c Depth rows of <tt>2^WidthLog2</tt>
+  /// counters
+  uint64_t *Counters;
+  /// Log2 of the number of counters of each row
+  uint32_t WidthLog2;
+  /// Number of rows of the sketch, each using an independent hash
+  uint32_t Depth;
+};
+
+/// \return the register of a HyperLogLog sketch with <tt>2^Precision</tt>
+/// registers that \p Hash is mapped to, i.e. its top \p Precision bits
+constexpr uint32_t hyperLogLogRegister(uint64_t Hash, uint32_t Precision) {
+  return static_cast<uint32_t>(Hash >> (64 - Precision));
+}
+
+/// \return the rank of \p Hash in a HyperLogLog sketch with
+/// <tt>2^Precision</tt> registers, i.e. one plus the number of leading zeros
+/// of the bits of \p Hash not used to select its register
+constexpr uint32_t hyperLogLogRank(uint64_t Hash, uint32_t Precision) {
+  uint64_t Rest = Hash << Precision;
+  return Rest == 0 ? 64 - Precision + 1
+                   : static_cast<uint32_t>(__builtin_clzll(Rest)) + 1;
+}
+
+/// \return the column of the counter of \p Key in the row \p Row of a
+/// count-min sketch with <tt>2^WidthLog2</tt> counters per row
+/// \details The hash of each row is derived from two hashes of \p Key, which
+/// is as accurate as using independent hash functions. The second hash is
+/// odd so that the rows of a key never collide on the same column sequence
+constexpr uint64_t countMinColumn(uint64_t Key, uint32_t Row,
+                                  uint32_t WidthLog2) {
+  uint64_t Hash = hashMapHash(Key);
+  uint64_t Step = hashMapHash(Hash) | 1;
+  return (Hash + Row * Step) & ((uint64_t{1} << WidthLog2) - 1);
+}
+
+/// \brief Estimated count of a key in a count-min sketch before and after
+/// it was updated
+struct CountMinUpdate {
+  uint64_t Before;
+  uint64_t After;
+};
+
+#if defined(__HIPCC__)
+
+namespace detail {
+
+/// \return \c true if the calling lane is the first active lane of a run of
+/// consecutive active lanes holding the same \p Key
+/// \details Each lane compares its key to the one of the previous active
+/// lane. Coalesced accesses place lanes touching the same cache line or page
+/// next to each other, so this removes most duplicate updates of a wave with
+/// a single permute instead of a loop over its distinct keys
+__attribute__((device, always_inline)) inline bool
+sketchIsRunHead(uint64_t Key) {
+  uint32_t Lane = __lane_id();
+  uint64_t Below =
+      __builtin_amdgcn_read_exec() & ((uint64_t{1} << Lane) - 1);
+  // Lanes without a previous active lane read their own key
+  uint32_t Previous = Below == 0 ? Lane : 63 - __clzll(Below);
+  auto Lo = static_cast<uint32_t>(__builtin_amdgcn_ds_bpermute(
+      Previous << 2, static_cast<int>(static_cast<uint32_t>(Key))));
+  auto Hi = static_cast<uint32_t>(__builtin_amdgcn_ds_bpermute(
+      Previous << 2, static_cast<int>(static_cast<uint32_t>(Key >> 32))));
+  return Below == 0 || Key != ((static_cast<uint64_t>(Hi) << 32) | Lo);
+}
+
+} // namespace detail
+
+/// Adds the \p Key of each active lane to the HyperLogLog sketch \p Sketch
+/// \details Only the first lane of each run of lanes with the same key
+/// updates the sketch. As registers only ever grow, the update is skipped
+/// without an atomic if the register already holds a rank at least as large;
+/// Once the sketch warms up, most updates only cost a load
+__attribute__((device, always_inline)) inline void
+hyperLogLogAdd(const DeviceHyperLogLogDescriptor &Sketch, uint64_t Key) {
+  if (!detail::sketchIsRunHead(Key))
+    return;
+  uint64_t Hash = hashMapHash(Key);
+  uint32_t *Register =
+      &Sketch.Registers[hyperLogLogRegister(Hash, Sketch.Precision)];
+  uint32_t Rank = hyperLogLogRank(Hash, Sketch.Precision);
+  if (__hip_atomic_load(Register, __ATOMIC_RELAXED,
+                        __HIP_MEMORY_SCOPE_AGENT) < Rank)
+    (void)__hip_atomic_fetch_max(Register, Rank, __ATOMIC_RELAXED,
+                                 __HIP_MEMORY_SCOPE_AGENT);
+}
+
+/// Increments the count of the \p Key of each active lane in the count-min
+/// sketch \p Sketch
+/// \details The first lane of each run of lanes with the same key adds the
+/// length of the run to the counters of the key, so that a wave accessing a
+/// single page or executing a single PC issues one atomic per row
+/// \return for the first lane of each run, the estimated count of its key
+/// before and after the update; Zero for the other lanes
+__attribute__((device, always_inline)) inline CountMinUpdate
+countMinIncrement(const DeviceCountMinDescriptor &Sketch, uint64_t Key) {
+  uint32_t Lane = __lane_id();
+  uint64_t Exec = __builtin_amdgcn_read_exec();
+  bool IsRunHead = detail::sketchIsRunHead(Key);
+  uint64_t HeadMask = __ballot(IsRunHead);
+  if (!IsRunHead)
+    return {0, 0};
+  // The run spans the active lanes from this lane up to the next run head
+  uint64_t NextHeads =
+      Lane == 63 ? 0 : HeadMask & (~uint64_t{0} << (Lane + 1));
+  uint64_t RunMask = Exec & (~uint64_t{0} << Lane);
+  if (NextHeads != 0)
+    RunMask &= (NextHeads & -NextHeads) - 1;
+  uint64_t RunLength = __popcll(RunMask);
+
+  uint64_t Estimate = ~uint64_t{0};
+  for (uint32_t Row = 0; Row < Sketch.Depth; Row++) {
+    uint64_t *Counter =
+        &Sketch.Counters[(uint64_t{Row} << Sketch.WidthLog2) +
+                         countMinColumn(Key, Row, Sketch.WidthLog2)];
+    uint64_t Old = __hip_atomic_fetch_add(Counter, RunLength,
+                                          __ATOMIC_RELAXED,
+                                          __HIP_MEMORY_SCOPE_AGENT);
+    Estimate = Old < Estimate ? Old : Estimate;
+  }
+  return {Estimate, Estimate + RunLength};
+}
+
+/// Adds the \p Value of each active lane to the count of its \p Key in the
+/// count-min sketch \p Sketch
+/// \details Unlike \c countMinIncrement, updates are not aggregated, and
+/// each lane adds its own value to each row with an atomic
+__attribute__((device, always_inline)) inline void
+countMinAdd(const DeviceCountMinDescriptor &Sketch, uint64_t Key,
+            uint64_t Value) {
+  for (uint32_t Row = 0; Row < Sketch.Depth; Row++)
+    (void)__hip_atomic_fetch_add(
+        &Sketch.Counters[(uint64_t{Row} << Sketch.WidthLog2) +
+                         countMinColumn(Key, Row, Sketch.WidthLog2)],
+        Value, __ATOMIC_RELAXED, __HIP_MEMORY_SCOPE_AGENT);
+}
+
+#endif
+
+} // namespace luthier
+
+#endif
@@ -0,0 +1,46 @@
+//===-- Wave.h - Device-side Wavefront Helpers ------------------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains helpers for exchanging values between the lanes of a
+/// wavefront, which can be used inside hooks and the device-side data
+/// structures updated by them.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_DEVICE_WAVE_H
+#define LUTHIER_DEVICE_WAVE_H
+#include <cstdint>
+
+namespace luthier {
+
+#if defined(__HIPCC__)
+
+/// \return the 64-bit \p Value of the wave's lane \p Lane
+/// \details \c __builtin_amdgcn_readlane only reads 32-bit values; The two
+/// halves of \p Value are read separately
+__attribute__((device, always_inline)) inline uint64_t
+readLane64(uint64_t Value, uint32_t Lane) {
+  auto Lo = static_cast<uint32_t>(
+      __builtin_amdgcn_readlane(static_cast<uint32_t>(Value), Lane));
+  auto Hi = static_cast<uint32_t>(
+      __builtin_amdgcn_readlane(static_cast<uint32_t>(Value >> 32), Lane));
+  return (static_cast<uint64_t>(Hi) << 32) | Lo;
+}
+
+#endif
+
+} // namespace luthier
+
+#endif
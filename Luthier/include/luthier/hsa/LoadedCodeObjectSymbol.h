@@ -140,6 +140,12 @@ public:
   /// \return the binding of the symbol
   [[nodiscard]] uint8_t getBinding() const;
 
+  /// \return the ELF symbol backing this symbol, obtained from parsing the
+  /// storage ELF of its loaded code object; The storage ELF can be accessed
+  /// through the returned symbol's object file (e.g. to read the DWARF
+  /// debug information of the code object)
+  [[nodiscard]] llvm::object::ELFSymbolRef getELFSymbol() const;
+
   /// \return an \c llvm::ArrayRef<uint8_t> encapsulating the contents of
   /// this symbol on the \c GpuAgent it was loaded onto
   [[nodiscard]] llvm::Expected<llvm::ArrayRef<uint8_t>>
@@ -136,7 +136,16 @@ enum KernelArgumentType {
   HIDDEN_END = SHARED_BASE,
   WORK_ITEM_X = 32,
   WORK_ITEM_Y = 33,
-  WORK_ITEM_Z = 34
+  WORK_ITEM_Z = 34,
+  /// 32-bit workgroup ID of the wavefront in the x dimension, preloaded in a
+  /// system SGPR
+  WORKGROUP_ID_X = 35,
+  /// 32-bit workgroup ID of the wavefront in the y dimension, preloaded in a
+  /// system SGPR
+  WORKGROUP_ID_Y = 36,
+  /// 32-bit workgroup ID of the wavefront in the z dimension, preloaded in a
+  /// system SGPR
+  WORKGROUP_ID_Z = 37
 };
 
 /// \brief Contains information about the values used/defined by
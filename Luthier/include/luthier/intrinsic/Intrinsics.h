@@ -98,24 +98,83 @@ LUTHIER_INTRINSIC_ANNOTATE uint32_t *implicitArgPtr() {
   return Out;
 }
 
+/// \return the ID of the workgroup of the calling wavefront in the x
+/// dimension
+/// \details The workgroup IDs are read from the system SGPRs preloaded by the
+/// hardware, which are preserved by the preamble of the instrumented kernel;
+/// If the instrumented kernel was not compiled with the workgroup ID of a
+/// dimension enabled, zero is returned for that dimension. This is cheaper
+/// than reading the workgroup IDs from the dispatch packet or the
+/// implicit arguments, and can be used to shard counters per workgroup
 LUTHIER_INTRINSIC_ANNOTATE uint32_t workgroupIdX() {
   uint32_t Out;
   doNotOptimize(Out);
   return Out;
 }
 
+/// \return the ID of the workgroup of the calling wavefront in the y
+/// dimension
 LUTHIER_INTRINSIC_ANNOTATE uint32_t workgroupIdY() {
   uint32_t Out;
   doNotOptimize(Out);
   return Out;
 }
 
+/// \return the ID of the workgroup of the calling wavefront in the z
+/// dimension
 LUTHIER_INTRINSIC_ANNOTATE uint32_t workgroupIdZ() {
   uint32_t Out;
   doNotOptimize(Out);
   return Out;
 }
 
+/// \return the index of the calling wavefront inside its workgroup
+/// \note Only supported on targets with architected SGPRs (e.g. gfx940 and
+/// later), where the hardware keeps the index in a trap temporary SGPR
+LUTHIER_INTRINSIC_ANNOTATE uint32_t waveIdInGroup() {
+  uint32_t Out;
+  doNotOptimize(Out);
+  return Out;
+}
+
+/// \return the content of the hardware ID register (\c HW_REG_HW_ID before
+/// gfx10, \c HW_REG_HW_ID1 on gfx10 and later) of the calling wavefront
+/// \details The hardware ID identifies the shader engine, compute unit
+/// (or WGP), SIMD and wave slot the wavefront is running on; Its layout is
+/// target-dependent and is documented in the ISA manual of each target.
+/// It can be used to shard counters per shader engine or compute unit
+LUTHIER_INTRINSIC_ANNOTATE uint32_t hwId() {
+  uint32_t Out;
+  doNotOptimize(Out);
+  return Out;
+}
+
+/// \return the value of the shader cycle counter of the calling wavefront
+/// \details Uses \c s_memtime on targets that have it. Otherwise, reads the
+/// \c SHADER_CYCLES hardware register, which only holds the low 20 bits of
+/// the counter and wraps around frequently; Differences between two reads
+/// must then be taken modulo <tt>2^20</tt>. The counter runs at the shader
+/// clock, which can change during execution
+/// \note When read with \c s_memtime, the read waits for all outstanding
+/// scalar memory and LDS operations of the wavefront to finish
+LUTHIER_INTRINSIC_ANNOTATE uint64_t readCycleCounter() {
+  uint64_t Out;
+  doNotOptimize(Out);
+  return Out;
+}
+
+/// \return the value of the 64-bit real time counter, which runs at a
+/// constant rate independent of the shader clock (e.g. 100MHz)
+/// \details Uses \c s_memrealtime, or the \c MSG_RTN_GET_REALTIME message
+/// on gfx11 and later
+/// \note The read waits for all outstanding scalar memory and LDS operations
+/// of the wavefront to finish
+LUTHIER_INTRINSIC_ANNOTATE uint64_t readRealtime() {
+  uint64_t Out;
+  doNotOptimize(Out);
+  return Out;
+}
+
 template <typename T,
           typename = std::enable_if_t<
               std::is_same_v<T, uint32_t> || std::is_same_v<T, uint64_t> ||
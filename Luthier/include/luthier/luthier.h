@@ -137,6 +137,10 @@ void setAtApiTableCaptureEvtCallback(
 /// additional events, as no additional modifications are possible to the
 /// ROCr runtime's API table. It is safe, however, to enable and disable
 /// callbacks for <tt>hsa::ApiEvtID</tt> already requested by the tool.
+/// \note HSA queues created by the application while
+/// \c HSA_API_EVT_ID_hsa_queue_packet_submit callbacks are disabled are
+/// created as regular hardware queues, and packets submitted to them will
+/// never be intercepted, even if the callback is enabled afterwards
 /// \note Use \c hsa::setAtHsaApiEvtCallback to set the callback invoked at
 /// each HSA event.
 /// \param ApiID the API/EVT ID to be captured via a callback
@@ -161,6 +165,19 @@ void setAtHsaApiEvtCallback(
 /// \sa setAtHsaApiEvtCallback, enableHsaApiEvtIDCallback
 llvm::Error disableHsaApiEvtIDCallback(hsa::ApiEvtID ApiID);
 
+/// Enables or disables the pass-through state of packet submission\n
+/// While enabled, packets submitted by the application are written to their
+/// hardware queues as-is, without invoking the
+/// \c HSA_API_EVT_ID_hsa_queue_packet_submit callbacks. This allows
+/// tools only interested in a subset of kernel launches (e.g. a window
+/// of kernel launches) to not pay the interception overhead when they are idle
+/// \note Unlike <tt>disableHsaApiEvtIDCallback</tt>, switching the
+/// pass-through state only requires a relaxed atomic store, and is safe
+/// to be done from inside the packet submit callbacks
+/// \param Enable if \c true, enables the pass-through state; Otherwise,
+/// disables it
+void setPacketSubmitPassThrough(bool Enable);
+
 } // namespace hsa
 
 namespace hip {
@@ -183,6 +200,32 @@ void setAtHipCompilerTableCaptureEvtCallback(
 void setAtHipDispatchTableCaptureEvtCallback(
     const std::function<void(ApiEvtPhase)> &Callback);
 
+/// If called, invokes \p Callback before and after each HIP runtime API
+/// inside the target application whose callback is enabled
+/// \param Callback the function to be called before/after each HIP runtime
+/// API being actively captured by Luthier
+/// \sa enableHipRuntimeApiEvtIDCallback, disableHipRuntimeApiEvtIDCallback
+void setAtHipRuntimeApiEvtCallback(
+    const std::function<void(ApiEvtArgs *, ApiEvtPhase, ApiEvtID)> &Callback);
+
+/// Enables callbacks to be invoked when the HIP runtime API \p ApiID is
+/// called inside the target application
+/// \note This function must be called after the HIP dispatch API table has
+/// been captured by the tooling library i.e. inside the callback function
+/// provided to <tt>hip::setAtHipDispatchTableCaptureEvtCallback</tt>; Like
+/// HSA APIs, the tool must request all the APIs it intends to monitor before
+/// the table is frozen by the first HIP runtime call of the application
+/// \param ApiID the ID of the HIP runtime API to be captured via a callback
+/// \returns an \c llvm::Error if any issue was encountered during the process
+/// \sa setAtHipRuntimeApiEvtCallback, disableHipRuntimeApiEvtIDCallback
+llvm::Error enableHipRuntimeApiEvtIDCallback(ApiEvtID ApiID);
+
+/// Disables capturing of the HIP runtime API \p ApiID and its callback
+/// \param ApiID the ID of the HIP runtime API to stop capturing
+/// \returns an \c llvm::Error if any issue was encountered during the process
+/// \sa setAtHipRuntimeApiEvtCallback, enableHipRuntimeApiEvtIDCallback
+llvm::Error disableHipRuntimeApiEvtIDCallback(ApiEvtID ApiID);
+
 } // namespace hip
 
 namespace hsa {
@@ -202,6 +245,35 @@ const HsaApiTable &getHsaApiTable();
 /// \sa hsa_ven_amd_loader_1_03_pfn_s
 const hsa_ven_amd_loader_1_03_pfn_s &getHsaVenAmdLoaderTable();
 
+/// Registers a \p Callback to be invoked once the kernel dispatched by
+/// \p Packet has finished executing on the device\n
+/// Unlike waiting on the packet's completion signal inside the
+/// \c API_EVT_PHASE_AFTER of the \c HSA_API_EVT_ID_hsa_queue_packet_submit
+/// event, this function does not block the thread submitting the packet; The
+/// \p Callback is instead invoked on a separate thread managed by Luthier
+/// once the kernel has finished\n
+/// Internally, the completion signal of the \p Packet is replaced with a
+/// signal from a pool managed by Luthier. The application's original
+/// completion signal (if present) is signaled right after the kernel
+/// finishes, before the \p Callback is invoked; The profiling timestamps of
+/// the dispatch are copied to it beforehand, so that
+/// \c hsa_amd_profiling_get_dispatch_time keeps working on it
+/// \note This function must be called during the \c API_EVT_PHASE_BEFORE
+/// of the \c HSA_API_EVT_ID_hsa_queue_packet_submit event, before the
+/// \p Packet is written to the hardware queue
+/// \note Callbacks are invoked one at a time, in order of kernel completion;
+/// All pending callbacks are guaranteed to have run before \c atToolFini is
+/// called
+/// \param Packet the dispatch packet about to be submitted to the device;
+/// Its completion signal will be modified by this function
+/// \param Callback the function invoked once the kernel has finished, with a
+/// copy of \p Packet, as it was passed to this function
+/// \return an \c llvm::Error if any issue was encountered during the process
+llvm::Error onDispatchComplete(
+    hsa_kernel_dispatch_packet_t &Packet,
+    const std::function<void(const hsa_kernel_dispatch_packet_t &)>
+        &Callback);
+
 } // namespace hsa
 
 namespace hip {
@@ -278,6 +350,25 @@ instrument(const LiftedRepresentation &LR,
                                           LiftedRepresentation &)>
                Mutator);
 
+/// Instruments the \p LR by applying each of the \p Mutators to the same
+/// clone of it, in order \n
+/// Each mutator is given its own \c InstrumentationTask; The tasks are merged
+/// before code generation, so that the hooks of all mutators inserted before
+/// the same instruction are generated as a single injected payload, sharing
+/// the same register save and restore. This allows metrics of several tools
+/// to be collected in a single run of the application
+/// \param LR the \c LiftedRepresentation about to be instrumented
+/// \param Mutators functions that instrument and modify the \p LR
+/// \return returns a new \c LiftedRepresentation containing the instrumented
+/// code, or an \c llvm::Error if an issue was encountered during
+/// instrumentation
+/// \sa InstrumentationTask::append
+llvm::Expected<std::unique_ptr<LiftedRepresentation>>
+instrument(const LiftedRepresentation &LR,
+           llvm::ArrayRef<llvm::function_ref<
+               llvm::Error(InstrumentationTask &, LiftedRepresentation &)>>
+               Mutators);
+
 /// Applies the assembly printer pass on the \p LR to generate object files or
 /// assembly files for each of its <tt>llvm::Module</tt>s and
 /// <tt>llvm::MachineModuleInfo</tt>s
@@ -318,6 +409,26 @@ instrumentAndLoad(const hsa::LoadedCodeObjectKernel &Kernel,
                       Mutator,
                   llvm::StringRef Preset);
 
+/// Instruments the <tt>Kernel</tt>'s lifted representation \p LR by
+/// applying all the \p Mutators to a single clone of it, and loads the
+/// result under \p Preset \n
+/// The instrumentation of all mutators is combined into one instrumented
+/// kernel, as described by the multi-mutator variant of \c instrument
+/// \param Kernel the kernel that's about to be instrumented
+/// \param LR the lifted representation of the \p Kernel
+/// \param Mutators the mutators describing the instrumentation to be
+/// performed on the <tt>kernel</tt>'s <tt>LR</t>
+/// \param Preset the preset name the instrumented kernel is loaded under
+/// \return an \c llvm::Error describing if the operation succeeded or
+/// failed
+llvm::Error
+instrumentAndLoad(const hsa::LoadedCodeObjectKernel &Kernel,
+                  const LiftedRepresentation &LR,
+                  llvm::ArrayRef<llvm::function_ref<llvm::Error(
+                      InstrumentationTask &, LiftedRepresentation &)>>
+                      Mutators,
+                  llvm::StringRef Preset);
+
 /// Checks if the \p Kernel is instrumented under the given \p Preset or not
 /// \param [in] Kernel the \c hsa::LoadedCodeObjectKernel of the app
 /// \param [in] Preset the preset name the kernel was instrumented under
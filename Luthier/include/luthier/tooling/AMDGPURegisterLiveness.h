@@ -22,7 +22,9 @@
 #define LUTHIER_AMDGPU_REGISTER_LIVENESS_H
 #include "LRCallgraph.h"
 #include "VectorCFG.h"
+#include <llvm/ADT/BitVector.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/CodeGen/LivePhysRegs.h>
 #include <llvm/CodeGen/MachineInstr.h>
 #include <llvm/CodeGen/MachineModuleInfo.h>
@@ -36,32 +38,87 @@ private:
   /// TODO: Use call graph to calculate liveness at a global level
   const LRCallGraph &CG;
 
-  /// A mapping between an \c llvm::MachineInstr of the MMI and the set of
-  /// physical registers that are live right before it is executed.
-  /// The live registers here only includes ones obtained using data-flow
-  /// at the \c llvm::MachineFunction level. It does not consider
-  /// the registers that are live at the call sites of the function
-  /// the \c llvm::MachineInstr belongs to
-  llvm::DenseMap<const llvm::MachineInstr *,
-                 std::unique_ptr<llvm::LivePhysRegs>>
-      MachineInstrLivenessMap{};
+  /// Number of instructions between two consecutive liveness checkpoints
+  /// inside a \c VectorMBB
+  static constexpr unsigned int CheckpointInterval = 32;
+
+  /// Number of per-instruction live register sets kept in \c QueryCache
+  static constexpr unsigned int QueryCacheSize = 8;
+
+  /// The vector CFG of each \c llvm::MachineFunction of the MMI; Kept alive
+  /// to answer per-instruction liveness queries on demand
+  llvm::DenseMap<const llvm::MachineFunction *, std::unique_ptr<VectorCFG>>
+      VectorCFGs{};
+
+  /// A mapping between an \c llvm::MachineInstr of the MMI and the
+  /// \c VectorMBB it belongs to
+  llvm::DenseMap<const llvm::MachineInstr *, const VectorMBB *>
+      MachineInstrVectorMBBMap{};
+
+  /// Physical registers live right after the last instruction of each
+  /// \c VectorMBB, indexed by register number
+  llvm::DenseMap<const VectorMBB *, llvm::BitVector> VectorMBBLiveOuts{};
+
+  /// Physical registers live right before every \c CheckpointInterval 'th
+  /// instruction of each \c VectorMBB, counting backwards from its end;
+  /// Bounds the number of instructions stepped over to answer a query
+  llvm::DenseMap<const llvm::MachineInstr *, llvm::BitVector>
+      LivenessCheckpoints{};
+
+  typedef std::pair<const llvm::MachineInstr *,
+                    std::unique_ptr<llvm::LivePhysRegs>>
+      QueryCacheEntry;
+
+  /// Most-recently-used first cache of the live-in sets returned by
+  /// \c getMFLevelInstrLiveIns
+  mutable llvm::SmallVector<QueryCacheEntry, QueryCacheSize> QueryCache{};
+
+  /// If set, this analysis belongs to a clone of a \c LiftedRepresentation,
+  /// and its queries are answered by the liveness analysis of the clone's
+  /// source instead
+  const AMDGPURegisterLiveness *SrcLiveness{nullptr};
+
+  /// Maps the machine instructions of the clone to their counterparts in
+  /// the source; Only set alongside \c SrcLiveness
+  const llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+      *DstToSrcMIMap{nullptr};
+
+  /// Records the live-outs and checkpoints of \p MBB, using its successors'
+  /// live-ins; \p LPR is used as scratch space
+  void recordVectorMBBLiveness(const VectorMBB &MBB, llvm::LivePhysRegs &LPR);
 
 public:
   AMDGPURegisterLiveness(const llvm::Module &M,
                          const llvm::MachineModuleInfo &MMI,
                          const LRCallGraph &CG);
 
+  /// Constructs the liveness analysis of a clone of a
+  /// \c LiftedRepresentation out of the analysis of its source
+  /// \p SrcLiveness; As register liveness is not affected by cloning, no
+  /// data-flow is re-computed
+  /// \param DstToSrcMIMap maps the machine instructions of the clone to their
+  /// counterpart in the source; Must remain alive alongside the analysis
+  /// \param CG the call graph of the clone
+  AMDGPURegisterLiveness(
+      const AMDGPURegisterLiveness &SrcLiveness,
+      const llvm::DenseMap<const llvm::MachineInstr *,
+                           const llvm::MachineInstr *> &DstToSrcMIMap,
+      const LRCallGraph &CG)
+      : CG(CG), SrcLiveness(&SrcLiveness), DstToSrcMIMap(&DstToSrcMIMap) {}
+
   /// \returns the set of physical registers that are live before executing
   /// the instruction \p MI at the function level, or nullptr if the
   /// live register set of \p MI was not found
+  /// \details The live registers here only includes ones obtained using
+  /// data-flow at the \c llvm::MachineFunction level. It does not consider
+  /// the registers that are live at the call sites of the function
+  /// the \c llvm::MachineInstr belongs to. The set is computed on demand by
+  /// stepping backwards from the closest liveness checkpoint after \p MI
+  /// \note The returned set is owned by a small cache inside the analysis,
+  /// and is only guaranteed to remain valid until the live-ins of another
+  /// instruction are queried; Callers that need it for longer must make a copy
   [[nodiscard]] const llvm::LivePhysRegs *
-  getMFLevelInstrLiveIns(const llvm::MachineInstr &MI) const {
-    auto It = MachineInstrLivenessMap.find(&MI);
-    if (It == MachineInstrLivenessMap.end())
-      return nullptr;
-    else
-      return It->second.get();
-  }
+  getMFLevelInstrLiveIns(const llvm::MachineInstr &MI) const;
 
   /// Never invalidate the results
   bool invalidate(llvm::Module &, const llvm::PreservedAnalyses &,
@@ -78,11 +135,26 @@ private:
 
   static llvm::AnalysisKey Key;
 
+  /// If set, the result is constructed from the liveness analysis of the
+  /// clone's source instead of being computed from scratch
+  const AMDGPURegisterLiveness *SrcLiveness{nullptr};
+
+  const llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+      *DstToSrcMIMap{nullptr};
+
 public:
   using Result = AMDGPURegisterLiveness;
 
   AMDGPURegLivenessAnalysis() = default;
 
+  /// Constructs an analysis pass which re-uses the \p SrcLiveness of a
+  /// \c LiftedRepresentation for its clone
+  AMDGPURegLivenessAnalysis(
+      const AMDGPURegisterLiveness &SrcLiveness,
+      const llvm::DenseMap<const llvm::MachineInstr *,
+                           const llvm::MachineInstr *> &DstToSrcMIMap)
+      : SrcLiveness(&SrcLiveness), DstToSrcMIMap(&DstToSrcMIMap) {}
+
   Result run(llvm::Module &M, llvm::ModuleAnalysisManager &MAM);
 };
 
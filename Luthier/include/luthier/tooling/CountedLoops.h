@@ -0,0 +1,105 @@
+//===-- CountedLoops.h ------------------------------------------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file describes the \c CountedLoop struct and the
+/// \c findCountedLoops function, which recognizes loops of a lifted machine
+/// function whose trip count can be calculated before the loop is entered.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_TOOLING_COUNTED_LOOPS_H
+#define LUTHIER_TOOLING_COUNTED_LOOPS_H
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/MC/MCRegister.h>
+#include <optional>
+#include <variant>
+
+namespace llvm {
+
+class MachineBasicBlock;
+
+class MachineInstr;
+
+class MachineFunction;
+
+} // namespace llvm
+
+namespace luthier {
+
+/// \brief Describes how the trip count of a \c CountedLoop is calculated
+/// \details The loop is controlled by a 32-bit scalar induction register,
+/// incremented by a constant \c Step once per iteration. At the end of each
+/// iteration, the incremented induction register is compared against the
+/// \c Bound, and the loop continues as long as
+/// <tt>InductionReg ContinuePredicate Bound</tt> holds. Both the initial value
+/// of the induction register and the bound are either immediates or the
+/// value of a scalar register at the \c CountedLoop::PreheaderInsertionPoint
+struct LoopTripCount {
+  /// The scalar induction register of the loop
+  llvm::MCRegister InductionReg{};
+  /// Initial value of the induction register, either as an immediate or as a
+  /// register holding it at the preheader insertion point
+  std::variant<int64_t, llvm::MCRegister> Init{int64_t{0}};
+  /// Bound the induction register is compared against, either as an
+  /// immediate or as a register holding it throughout the loop
+  std::variant<int64_t, llvm::MCRegister> Bound{int64_t{0}};
+  /// The amount added to the induction register each iteration; Never zero
+  int64_t Step{1};
+  /// The integer predicate which must hold between the incremented
+  /// induction register and the \c Bound for the loop to continue; One of
+  /// \c ICMP_NE or the signed/unsigned less/greater than (or equal)
+  /// predicates
+  llvm::CmpInst::Predicate ContinuePredicate{llvm::CmpInst::ICMP_NE};
+
+  /// \return the trip count of the loop if both \c Init and \c Bound are
+  /// immediates, \c std::nullopt otherwise
+  [[nodiscard]] std::optional<uint64_t> getConstantTripCount() const;
+
+  bool operator==(const LoopTripCount &) const = default;
+};
+
+/// \brief A loop of a lifted machine function with a single latch which is
+/// also its only exiting block, and whose trip count is described by a
+/// \c LoopTripCount
+/// \details The latch of the loop ends with a scalar compare followed by a
+/// \c S_CBRANCH_SCC0 or \c S_CBRANCH_SCC1, and the loop does not contain
+/// any calls or writes to the exec mask; Hence, every block in
+/// \c BlocksExecutedOncePerIteration runs under the exec mask active at the
+/// \c PreheaderInsertionPoint
+struct CountedLoop {
+  /// Header of the loop
+  llvm::MachineBasicBlock *Header{nullptr};
+  /// An instruction in the preheader of the loop; Code inserted before it
+  /// runs exactly once each time the loop is entered, and sees the
+  /// registers used by the \c TripCount with their values on loop entry
+  llvm::MachineInstr *PreheaderInsertionPoint{nullptr};
+  /// Blocks of the loop (and not any of its sub-loops) executed exactly
+  /// once per iteration of the loop
+  llvm::SmallVector<llvm::MachineBasicBlock *, 4>
+      BlocksExecutedOncePerIteration{};
+  /// Describes the trip count of the loop
+  LoopTripCount TripCount{};
+};
+
+/// Finds the <tt>CountedLoop</tt>s of \p MF
+/// \param [in] MF a machine function of a \c LiftedRepresentation
+/// \param [out] Loops the counted loops of \p MF; Inner loops appear before
+/// the loops containing them
+void findCountedLoops(llvm::MachineFunction &MF,
+                      llvm::SmallVectorImpl<CountedLoop> &Loops);
+
+} // namespace luthier
+
+#endif
@@ -0,0 +1,130 @@
+//===-- DeviceHashMap.h - Host-side Device Hash Map Management --*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file describes the \c DeviceHashMap class, which allocates,
+/// clears and reads back the device-side hash maps described in
+/// \c luthier/device/HashMap.h on behalf of tools.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_TOOLING_DEVICE_HASH_MAP_H
+#define LUTHIER_TOOLING_DEVICE_HASH_MAP_H
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/Support/Error.h>
+#include <luthier/device/HashMap.h>
+#include <memory>
+
+namespace luthier {
+
+/// \brief Statistics of a \c DeviceHashMap, computed when it is read back
+struct HashMapStatistics {
+  /// Number of slots of the map
+  uint64_t Capacity{0};
+  /// Number of keys inserted in the map
+  uint64_t NumKeys{0};
+  /// Ratio of occupied slots
+  double LoadFactor{0.0};
+  /// Number of key lookups performed by the device
+  uint64_t NumLookups{0};
+  /// Average number of slots probed per lookup
+  double AverageProbesPerLookup{0.0};
+  /// Largest distance between the slot of a key and the slot of its hash,
+  /// i.e. the length of the longest probe sequence that found a key
+  uint64_t MaxProbeDistance{0};
+  /// Number of lane updates which could not find a slot
+  uint64_t NumOverflowedUpdates{0};
+  /// Sum of the values of the overflowed updates, if the map uses the
+  /// \c HASH_MAP_OVERFLOW_ACCUMULATE policy
+  uint64_t OverflowValue{0};
+};
+
+/// \brief Owns the device memory of a hash map of 64-bit keys to 64-bit
+/// counters updated by hooks
+/// \details Usage:
+/// 1. Declare a <tt>__attribute__((device)) DeviceHashMapDescriptor</tt>
+/// variable in the tool, and update it from hooks using
+/// \c luthier::hashMapIncrement or \c luthier::hashMapAdd.
+/// 2. Create the map with \c DeviceHashMap::create once the HIP runtime is
+/// initialized, and \c bind it to the descriptor variable.
+/// 3. \c clear the map before each launch it should count separately, and
+/// \c readBack its content once the launch is complete.
+/// \note Device memory is allocated and copied using the HIP and HSA
+/// functions saved by Luthier, with user interception disabled
+class DeviceHashMap {
+  DeviceHashMapDescriptor Descriptor{};
+
+  DeviceHashMap() = default;
+
+public:
+  /// Allocates a map with enough slots to hold \p NumExpectedKeys keys
+  /// without exceeding a load factor of \p MaxLoadFactor, and clears it
+  /// \param NumExpectedKeys the number of distinct keys expected to be
+  /// inserted; The number of slots is rounded up to a power of two
+  /// \param MaxLoadFactor the highest ratio of occupied slots the map is
+  /// sized for; Linear probing degrades quickly above 0.7
+  /// \param OverflowPolicy what happens to the updates that can't find a
+  /// slot
+  /// \param MaxProbes the maximum number of slots probed per lookup, which
+  /// bounds the latency of the hooks
+  /// \return the created map, or an \c llvm::Error if the arguments are
+  /// invalid or the allocation failed
+  static llvm::Expected<std::unique_ptr<DeviceHashMap>>
+  create(uint64_t NumExpectedKeys, double MaxLoadFactor = 0.5,
+         HashMapOverflowPolicy OverflowPolicy = HASH_MAP_OVERFLOW_DROP,
+         uint32_t MaxProbes = 64);
+
+  DeviceHashMap(const DeviceHashMap &) = delete;
+
+  DeviceHashMap &operator=(const DeviceHashMap &) = delete;
+
+  /// Frees the device memory of the map
+  /// \warning Must be destroyed before the HIP runtime is shut down (e.g.
+  /// inside \c atToolFini)
+  ~DeviceHashMap();
+
+  /// \return the descriptor of the map's device memory
+  [[nodiscard]] const DeviceHashMapDescriptor &getDescriptor() const {
+    return Descriptor;
+  }
+
+  /// \return the number of slots of the map
+  [[nodiscard]] uint64_t getCapacity() const {
+    return Descriptor.CapacityMask + 1;
+  }
+
+  /// Copies the descriptor of the map to the \c DeviceHashMapDescriptor
+  /// device variable of the tool, so that the hooks using it update this map
+  /// \param DescriptorVariable the host shadow of the device variable, i.e.
+  /// its address in the tool's host code
+  /// \return an \c llvm::Error if the copy failed
+  llvm::Error bind(const void *DescriptorVariable) const;
+
+  /// Removes all keys from the map and resets its statistics
+  /// \return an \c llvm::Error if the device memory could not be written
+  llvm::Error clear();
+
+  /// Copies the content of the map back to the host in bulk, and invokes
+  /// \p Callback on each of its keys and their values, in slot order
+  /// \note Must only be called once the kernels updating the map are
+  /// complete
+  /// \return the statistics of the map, or an \c llvm::Error if the device
+  /// memory could not be read
+  llvm::Expected<HashMapStatistics> readBack(
+      llvm::function_ref<void(uint64_t Key, uint64_t Value)> Callback) const;
+};
+
+} // namespace luthier
+
+#endif
@@ -0,0 +1,239 @@
+//===-- DeviceSketch.h - Host-side Device Sketch Management -----*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file describes the host side of the sketches described in
+/// \c luthier/device/Sketch.h:
+/// - \c HyperLogLogSketch and \c CountMinSketch, host copies of sketches
+/// which can be queried and merged with each other, e.g. to combine the
+/// sketches of multiple launches of a kernel.
+/// - \c DeviceHyperLogLog and \c DeviceCountMinSketch, which allocate, clear
+/// and read back the device memory of the sketches updated by hooks.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_TOOLING_DEVICE_SKETCH_H
+#define LUTHIER_TOOLING_DEVICE_SKETCH_H
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/Error.h>
+#include <luthier/device/Sketch.h>
+#include <memory>
+#include <vector>
+
+namespace luthier {
+
+/// \brief Host copy of a HyperLogLog sketch, estimating the number of
+/// distinct keys added to it
+class HyperLogLogSketch {
+  uint32_t Precision;
+
+  std::vector<uint8_t> Registers;
+
+public:
+  /// Creates an empty sketch with <tt>2^Precision</tt> registers
+  /// \note \p Precision must be within \c HyperLogLogMinPrecision and
+  /// \c HyperLogLogMaxPrecision
+  explicit HyperLogLogSketch(uint32_t Precision);
+
+  /// \return the log2 of the number of registers of the sketch
+  [[nodiscard]] uint32_t getPrecision() const { return Precision; }
+
+  /// \return the registers of the sketch
+  [[nodiscard]] llvm::ArrayRef<uint8_t> registers() const {
+    return Registers;
+  }
+
+  /// Sets the registers of the sketch to \p DeviceRegisters, read back from
+  /// a \c DeviceHyperLogLog with the same precision
+  void setRegisters(llvm::ArrayRef<uint32_t> DeviceRegisters);
+
+  /// Adds \p Key to the sketch
+  void add(uint64_t Key);
+
+  /// Merges \p Other into this sketch, so that it estimates the number of
+  /// distinct keys added to either of them
+  /// \return an \c llvm::Error if the precisions of the sketches differ
+  llvm::Error merge(const HyperLogLogSketch &Other);
+
+  /// \return the estimated number of distinct keys added to the sketch
+  [[nodiscard]] double estimate() const;
+
+  /// \return the relative standard error of the estimates of the sketch
+  [[nodiscard]] double getStandardError() const;
+};
+
+/// \brief Host copy of a count-min sketch, estimating the number of times
+/// each key was added to it
+/// \details Estimates never under-count. With a width of \c W counters, they
+/// over-count by at most <tt>e / W</tt> of the total count with a probability
+/// of <tt>1 - exp(-Depth)</tt>
+class CountMinSketch {
+  uint32_t WidthLog2;
+
+  uint32_t Depth;
+
+  std::vector<uint64_t> Counters;
+
+public:
+  /// Creates an empty sketch of \p Depth rows of <tt>2^WidthLog2</tt>
+  /// counters
+  CountMinSketch(uint32_t WidthLog2, uint32_t Depth);
+
+  /// \return the log2 of the number of counters of each row
+  [[nodiscard]] uint32_t getWidthLog2() const { return WidthLog2; }
+
+  /// \return the number of rows of the sketch
+  [[nodiscard]] uint32_t getDepth() const { return Depth; }
+
+  /// \return the counters of the sketch, row by row
+  [[nodiscard]] llvm::ArrayRef<uint64_t> counters() const {
+    return Counters;
+  }
+
+  /// \return a mutable reference to the counters of the sketch, to be
+  /// filled from a \c DeviceCountMinSketch with the same dimensions
+  [[nodiscard]] llvm::MutableArrayRef<uint64_t> counters() {
+    return Counters;
+  }
+
+  /// Adds \p Value to the count of \p Key
+  void add(uint64_t Key, uint64_t Value = 1);
+
+  /// Merges \p Other into this sketch, so that it estimates the sum of the
+  /// counts of both sketches
+  /// \return an \c llvm::Error if the dimensions of the sketches differ
+  llvm::Error merge(const CountMinSketch &Other);
+
+  /// \return the estimated count of \p Key
+  [[nodiscard]] uint64_t estimate(uint64_t Key) const;
+
+  /// \return the sum of the counts of all keys, which is exact
+  [[nodiscard]] uint64_t getTotalCount() const;
+
+  /// \return the largest over-count of the estimates of the sketch, with a
+  /// probability of <tt>1 - exp(-Depth)</tt>
+  [[nodiscard]] double getErrorBound() const;
+};
+
+/// \brief Owns the device memory of a HyperLogLog sketch updated by hooks
+/// \details Usage:
+/// 1. Declare a <tt>__attribute__((device)) DeviceHyperLogLogDescriptor</tt>
+/// variable in the tool, and add keys to it from hooks using
+/// \c luthier::hyperLogLogAdd.
+/// 2. Create the sketch with \c DeviceHyperLogLog::create once the HIP
+/// runtime is initialized, and \c bind it to the descriptor variable.
+/// 3. \c clear the sketch before each launch it should estimate separately,
+/// and \c readBack its content once the launch is complete.
+class DeviceHyperLogLog {
+  DeviceHyperLogLogDescriptor Descriptor{};
+
+  DeviceHyperLogLog() = default;
+
+public:
+  /// Allocates a sketch with <tt>2^Precision</tt> registers and clears it
+  /// \param Precision the log2 of the number of registers; The relative
+  /// standard error of the sketch is <tt>1.04 / sqrt(2^Precision)</tt>,
+  /// i.e. about 0.8% with the default of 14, which uses 64 KiB of memory
+  /// \return the created sketch, or an \c llvm::Error if \p Precision is
+  /// out of range or the allocation failed
+  static llvm::Expected<std::unique_ptr<DeviceHyperLogLog>>
+  create(uint32_t Precision = 14);
+
+  DeviceHyperLogLog(const DeviceHyperLogLog &) = delete;
+
+  DeviceHyperLogLog &operator=(const DeviceHyperLogLog &) = delete;
+
+  /// Frees the device memory of the sketch
+  /// \warning Must be destroyed before the HIP runtime is shut down (e.g.
+  /// inside \c atToolFini)
+  ~DeviceHyperLogLog();
+
+  /// \return the descriptor of the sketch's device memory
+  [[nodiscard]] const DeviceHyperLogLogDescriptor &getDescriptor() const {
+    return Descriptor;
+  }
+
+  /// Copies the descriptor of the sketch to the
+  /// \c DeviceHyperLogLogDescriptor device variable of the tool
+  /// \param DescriptorVariable the host shadow of the device variable
+  /// \return an \c llvm::Error if the copy failed
+  llvm::Error bind(const void *DescriptorVariable) const;
+
+  /// Resets all registers of the sketch
+  /// \return an \c llvm::Error if the device memory could not be written
+  llvm::Error clear();
+
+  /// Copies the registers of the sketch back to the host
+  /// \note Must only be called once the kernels updating the sketch are
+  /// complete
+  /// \return the host copy of the sketch, or an \c llvm::Error if the device
+  /// memory could not be read
+  [[nodiscard]] llvm::Expected<HyperLogLogSketch> readBack() const;
+};
+
+/// \brief Owns the device memory of a count-min sketch updated by hooks
+/// \details Used the same way as \c DeviceHyperLogLog, with
+/// \c luthier::countMinIncrement or \c luthier::countMinAdd in the hooks
+class DeviceCountMinSketch {
+  DeviceCountMinDescriptor Descriptor{};
+
+  DeviceCountMinSketch() = default;
+
+public:
+  /// Allocates a sketch of \p Depth rows of <tt>2^WidthLog2</tt> counters
+  /// and clears it
+  /// \param WidthLog2 the log2 of the number of counters of each row, which
+  /// sets the error of the estimates; See \c CountMinSketch
+  /// \param Depth the number of rows, which sets the confidence of the
+  /// estimates, and the number of atomics performed by each update
+  /// \return the created sketch, or an \c llvm::Error if the dimensions are
+  /// invalid or the allocation failed
+  static llvm::Expected<std::unique_ptr<DeviceCountMinSketch>>
+  create(uint32_t WidthLog2 = 16, uint32_t Depth = 4);
+
+  DeviceCountMinSketch(const DeviceCountMinSketch &) = delete;
+
+  DeviceCountMinSketch &operator=(const DeviceCountMinSketch &) = delete;
+
+  /// Frees the device memory of the sketch
+  /// \warning Must be destroyed before the HIP runtime is shut down (e.g.
+  /// inside \c atToolFini)
+  ~DeviceCountMinSketch();
+
+  /// \return the descriptor of the sketch's device memory
+  [[nodiscard]] const DeviceCountMinDescriptor &getDescriptor() const {
+    return Descriptor;
+  }
+
+  /// Copies the descriptor of the sketch to the \c DeviceCountMinDescriptor
+  /// device variable of the tool
+  /// \param DescriptorVariable the host shadow of the device variable
+  /// \return an \c llvm::Error if the copy failed
+  llvm::Error bind(const void *DescriptorVariable) const;
+
+  /// Resets all counters of the sketch
+  /// \return an \c llvm::Error if the device memory could not be written
+  llvm::Error clear();
+
+  /// Copies the counters of the sketch back to the host
+  /// \note Must only be called once the kernels updating the sketch are
+  /// complete
+  /// \return the host copy of the sketch, or an \c llvm::Error if the device
+  /// memory could not be read
+  [[nodiscard]] llvm::Expected<CountMinSketch> readBack() const;
+};
+
+} // namespace luthier
+
+#endif
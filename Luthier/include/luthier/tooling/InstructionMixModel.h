@@ -0,0 +1,142 @@
+//===-- InstructionMixModel.h -----------------------------------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file describes the \c InstructionMixModel class, which
+/// extrapolates the dynamic instruction mix of a \c LiftedRepresentation from
+/// the execution counts of its blocks on the host.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_TOOLING_INSTRUCTION_MIX_MODEL_H
+#define LUTHIER_TOOLING_INSTRUCTION_MIX_MODEL_H
+#include <array>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Error.h>
+
+namespace llvm {
+
+class MachineInstr;
+
+} // namespace llvm
+
+namespace luthier {
+
+class LiftedRepresentation;
+
+/// \brief Coarse categories of instructions reported by the
+/// \c InstructionMixModel
+enum class InstructionCategory : uint8_t {
+  ScalarALU = 0,
+  ScalarMemory,
+  VectorALU,
+  VectorMemory,
+  LDS,
+  ProgramControl,
+  Export,
+  Other,
+  NumCategories
+};
+
+/// \return a human-readable name for \p Category
+llvm::StringRef getInstructionCategoryName(InstructionCategory Category);
+
+/// \brief Static instruction composition of the blocks of a
+/// \c LiftedRepresentation, used to derive its dynamic opcode and
+/// category histograms on the host from the number of times each block was
+/// executed
+/// \details The blocks of the model are the <tt>UniformExecRegion</tt>s of all
+/// defined functions of the \c LiftedRepresentation, numbered in the order
+/// the functions are visited by
+/// \c LiftedRepresentation::iterateAllDefinedFunctionTypes. As all
+/// instructions of a block execute under the same exec mask, a tool only needs
+/// to record two numbers per block to reproduce the results of
+/// per-instruction counting:
+/// 1. The scalar weight of the block, i.e. the number of times a wave executed
+/// it. Scalar and lane access instructions are counted once per execution.
+/// 2. The vector weight of the block, i.e. the number of active lanes summed
+/// over all executions, or the number of executions with at least one active
+/// lane when counting at the wavefront level. Vector instructions are counted
+/// with this weight.
+/// The composition is kept as a sparse opcode-by-block matrix stored by
+/// opcode, so that extrapolation is a sequence of dot products over blocks.
+/// The model does not hold on to the \c LiftedRepresentation it was built
+/// from, and can outlive it
+class InstructionMixModel {
+private:
+  /// Number of blocks in the model
+  size_t NumBlocks{0};
+  /// Distinct opcodes in the model
+  llvm::SmallVector<unsigned int> Opcodes{};
+  /// Whether each opcode in \c Opcodes is counted with the vector weight
+  llvm::SmallVector<bool> IsVectorOpcode{};
+  /// Category of each opcode in \c Opcodes
+  llvm::SmallVector<InstructionCategory> OpcodeCategories{};
+  /// Start of each opcode's entries in \c BlockIndices and
+  /// \c NumOccurrences; Has one more element than \c Opcodes
+  llvm::SmallVector<size_t> OpcodeEntriesBegin{};
+  /// Index of the block of each non-zero entry of the composition matrix
+  llvm::SmallVector<uint32_t> BlockIndices{};
+  /// Number of occurrences of the opcode in the block of each entry
+  llvm::SmallVector<uint32_t> NumOccurrences{};
+
+  InstructionMixModel() = default;
+
+public:
+  /// Builds the instruction mix model of \p LR
+  /// \param LR the lifted representation being modeled
+  /// \param [out] BlockEntries if not \c nullptr, the first instruction of
+  /// each block is appended to it, in block order; Tools instrument these
+  /// instructions to record the weights of each block
+  /// \return the model on success, or an \c llvm::Error on failure
+  static llvm::Expected<InstructionMixModel>
+  create(LiftedRepresentation &LR,
+         llvm::SmallVectorImpl<llvm::MachineInstr *> *BlockEntries = nullptr);
+
+  /// \return the number of blocks in the model
+  [[nodiscard]] size_t getNumBlocks() const { return NumBlocks; }
+
+  /// \return the distinct opcodes of the modeled instructions
+  [[nodiscard]] llvm::ArrayRef<unsigned int> getOpcodes() const {
+    return Opcodes;
+  }
+
+  /// Adds the extrapolated number of executions of each opcode to
+  /// \p Histogram
+  /// \param ScalarWeights the scalar weight of each block
+  /// \param VectorWeights the vector weight of each block
+  /// \param [in, out] Histogram histogram indexed by opcode, large enough to
+  /// hold all opcodes of the target
+  /// \return an \c llvm::Error if the weights or the histogram do not match
+  /// the model
+  llvm::Error extrapolateOpcodeHistogram(
+      llvm::ArrayRef<uint64_t> ScalarWeights,
+      llvm::ArrayRef<uint64_t> VectorWeights,
+      llvm::MutableArrayRef<uint64_t> Histogram) const;
+
+  /// Adds the extrapolated number of executions of each
+  /// \c InstructionCategory to \p Histogram
+  /// \sa extrapolateOpcodeHistogram
+  llvm::Error extrapolateCategoryHistogram(
+      llvm::ArrayRef<uint64_t> ScalarWeights,
+      llvm::ArrayRef<uint64_t> VectorWeights,
+      std::array<uint64_t,
+                 static_cast<size_t>(InstructionCategory::NumCategories)>
+          &Histogram) const;
+};
+
+} // namespace luthier
+
+#endif
@@ -19,6 +19,7 @@
 //===----------------------------------------------------------------------===//
 #ifndef LUTHIER_INSTRUMENTATION_TASK_H
 #define LUTHIER_INSTRUMENTATION_TASK_H
+#include "luthier/tooling/CountedLoops.h"
 #include "luthier/types.h"
 #include <functional>
 #include <llvm/ADT/DenseMap.h>
@@ -57,6 +58,12 @@ public:
     llvm::StringRef HookName;
     /// List of arguments passed to the hook
     llvm::SmallVector<std::variant<llvm::Constant *, llvm::MCRegister>, 1> Args;
+    /// Indices of the integer constant arguments holding the amounts counted
+    /// by the hook if it is a counting hook; Empty otherwise
+    llvm::SmallVector<unsigned int, 1> CountArgIndices{};
+    /// If set, the hook was hoisted out of a counted loop, and its count
+    /// arguments are multiplied by the loop's trip count at run time
+    std::optional<LoopTripCount> CountMultiplier{std::nullopt};
   } hook_invocation_descriptor;
 
   /// A mapping of a \c llvm::MachineInstr to the hooks + their arguments
@@ -74,6 +81,25 @@ private:
   /// A list of hooks to be inserted at each \c llvm::MachineInstr of the
   /// <tt>LiftedRepresentation</tt>
   hook_insertion_tasks HookInsertionTasks{};
+  /// Minimum number of waves per SIMD the instrumented kernel must be able
+  /// to run with; Zero if no such requirement is set
+  unsigned int MinWavesPerEU{0};
+  /// If \c true, the instrumented kernel must not run with fewer waves per
+  /// SIMD than the original kernel
+  bool PreserveOccupancy{false};
+  /// If \c true, counting hooks inside counted loops are hoisted to the
+  /// preheader of the loop
+  bool HoistCountingHooks{false};
+
+  friend class CodeGenerator;
+
+  /// Moves the counting hooks executed once per iteration of each
+  /// \c CountedLoop of the \c LiftedRepresentation to the loop's preheader,
+  /// scaling their count arguments by the loop's trip count \n
+  /// Hooks with register arguments other than their counts, or which were
+  /// already hoisted out of an inner loop, are left in place. Hoisted hooks
+  /// which only differ in their counts are merged into a single invocation
+  void hoistCountingHooksOutOfLoops();
 
 public:
   /// InstrumentationTask constructor
@@ -95,6 +121,41 @@ public:
       llvm::ArrayRef<std::variant<llvm::Constant *, llvm::MCRegister>> Args =
           {});
 
+  /// Queues the insertion of a counting hook before the \p MI \n
+  /// A counting hook only adds the values of its count arguments to
+  /// counters, possibly scaled by a value which remains the same throughout a
+  /// \c CountedLoop (e.g. the number of active lanes); In other words, running
+  /// it \c N times in a row must be equivalent to running it once with all of
+  /// its count arguments multiplied by \c N. If requested via
+  /// \c hoistCountingHooks, counting hooks inside counted loops are
+  /// invoked once before the loop is entered instead of once per iteration
+  /// \param MI the \c llvm::MachineInstr the hook will be inserted before
+  /// \param Hook handle of the hook obtained from \c LUTHIER_GET_HOOK_HANDLE
+  /// \param CountArgIndices indices of the arguments in \p Args holding the
+  /// amounts counted by the hook; Each must be an integer constant
+  /// \param Args A list of arguments to be passed to the hook
+  /// \returns an \c llvm::Error indicating the success of the operation or
+  /// its failure
+  llvm::Error insertCountingHookBefore(
+      llvm::MachineInstr &MI, const void *Hook,
+      llvm::ArrayRef<unsigned int> CountArgIndices,
+      llvm::ArrayRef<std::variant<llvm::Constant *, llvm::MCRegister>> Args);
+
+  /// Appends the hook insertion tasks of \p Other to this task, so that
+  /// both tasks are applied to the \c LiftedRepresentation at once \n
+  /// Hooks of \p Other inserted before an instruction run after the hooks of
+  /// this task inserted before the same instruction, inside the same injected
+  /// payload. The occupancy budget of the merged task is the stricter of the
+  /// two budgets
+  /// \note Counting hooks of \p Other are not hoisted after merging; If
+  /// \p Other requested hoisting, it must hoist its hooks before being
+  /// appended
+  /// \param Other another task instrumenting the same
+  /// \c LiftedRepresentation using the same instrumentation module
+  /// \returns an \c llvm::Error indicating the success of the operation or
+  /// its failure
+  llvm::Error append(const InstrumentationTask &Other);
+
   /// \return a const reference to the hook insertion tasks
   [[nodiscard]] const hook_insertion_tasks &getHookInsertionTasks() const {
     return HookInsertionTasks;
@@ -102,6 +163,43 @@ public:
 
   /// \return a const reference to the instrumentation module of this task
   [[nodiscard]] const InstrumentationModule &getModule() const { return IM; }
+
+  /// Sets the occupancy budget of the instrumented code so that it does not
+  /// lower the number of waves per SIMD of the kernel below \p WavesPerEU \n
+  /// The budget restricts the registers that can be used for storing the
+  /// state value array and by the injected payloads; If not enough registers
+  /// are within the budget, the state value array is spilled and the
+  /// injected payloads spill their registers instead
+  /// \note Instrumentation can still lower occupancy if the original kernel
+  /// already uses more registers than the budget allows
+  void setMinWavesPerEU(unsigned int WavesPerEU) { MinWavesPerEU = WavesPerEU; }
+
+  /// Sets the occupancy budget of the instrumented code so that it does not
+  /// lower the number of waves per SIMD of the original kernel
+  /// \sa setMinWavesPerEU
+  void preserveOccupancy(bool Preserve = true) { PreserveOccupancy = Preserve; }
+
+  /// \return the minimum number of waves per SIMD set by
+  /// \c setMinWavesPerEU, or zero if not set
+  [[nodiscard]] unsigned int getMinWavesPerEU() const { return MinWavesPerEU; }
+
+  /// \return \c true if the instrumented code must preserve the occupancy
+  /// of the original kernel, \c false otherwise
+  [[nodiscard]] bool shouldPreserveOccupancy() const {
+    return PreserveOccupancy;
+  }
+
+  /// Requests counting hooks inserted via \c insertCountingHookBefore to be
+  /// hoisted out of counted loops, so that they run once per loop entry
+  /// with their counts multiplied by the loop's trip count
+  /// \sa findCountedLoops
+  void hoistCountingHooks(bool Hoist = true) { HoistCountingHooks = Hoist; }
+
+  /// \return \c true if counting hooks are to be hoisted out of counted
+  /// loops, \c false otherwise
+  [[nodiscard]] bool shouldHoistCountingHooks() const {
+    return HoistCountingHooks;
+  }
 };
 
 } // namespace luthier
@@ -65,6 +65,21 @@ private:
 public:
   LRCallGraph() = default;
 
+  /// Constructs the call graph of a clone of a \c LiftedRepresentation by
+  /// mapping the already analyzed call graph of its source onto it, instead
+  /// of re-discovering the targets of the clone's call instructions
+  /// \param SrcCG the call graph of the source representation
+  /// \param SrcToDstMFMap maps the machine functions of the source to their
+  /// clones
+  /// \param SrcToDstMIMap maps the machine instructions of the source to
+  /// their clones
+  LRCallGraph(
+      const LRCallGraph &SrcCG,
+      const llvm::DenseMap<const llvm::MachineFunction *,
+                           const llvm::MachineFunction *> &SrcToDstMFMap,
+      const llvm::DenseMap<const llvm::MachineInstr *,
+                           const llvm::MachineInstr *> &SrcToDstMIMap);
+
   /// Performs the callgraph analysis
   llvm::Error analyse(const llvm::Module &M,
                       const llvm::MachineModuleInfo &MMI);
@@ -95,11 +110,33 @@ private:
 
   static llvm::AnalysisKey Key;
 
+  /// If set, the analysis result is mapped from the call graph of the
+  /// clone's source instead of being computed from scratch
+  const LRCallGraph *SrcCG{nullptr};
+
+  const llvm::DenseMap<const llvm::MachineFunction *,
+                       const llvm::MachineFunction *> *SrcToDstMFMap{nullptr};
+
+  const llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+      *SrcToDstMIMap{nullptr};
+
 public:
   using Result = LRCallGraph;
 
   LRCallGraphAnalysis() = default;
 
+  /// Constructs an analysis pass which maps the \p SrcCG of a
+  /// \c LiftedRepresentation onto its clone
+  /// \sa LRCallGraph::LRCallGraph
+  LRCallGraphAnalysis(
+      const LRCallGraph &SrcCG,
+      const llvm::DenseMap<const llvm::MachineFunction *,
+                           const llvm::MachineFunction *> &SrcToDstMFMap,
+      const llvm::DenseMap<const llvm::MachineInstr *,
+                           const llvm::MachineInstr *> &SrcToDstMIMap)
+      : SrcCG(&SrcCG), SrcToDstMFMap(&SrcToDstMFMap),
+        SrcToDstMIMap(&SrcToDstMIMap) {}
+
   /// Run the analysis pass that would
   Result run(llvm::Module &M, llvm::ModuleAnalysisManager &MAM);
 };
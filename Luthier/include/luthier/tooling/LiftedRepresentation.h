@@ -35,6 +35,10 @@ namespace luthier {
 
 class CodeLifter;
 
+class LRCallGraph;
+
+class AMDGPURegisterLiveness;
+
 namespace hsa {
 
 class LoadedCodeObjectVariable;
@@ -115,6 +119,16 @@ private:
   /// underlying allocator, and this map becomes invalid
   llvm::DenseMap<llvm::MachineInstr *, hsa::Instr *> MachineInstrToMCMap{};
 
+  /// Call graph of the lifted code; Only computed for representations cached
+  /// by the \c CodeLifter, which never get modified after lifting. This
+  /// allows the analysis to be done once and then mapped onto every clone
+  /// of the representation that gets instrumented
+  mutable std::unique_ptr<LRCallGraph> CallGraph{};
+
+  /// Register liveness of the lifted code; Cached the same way as
+  /// \c CallGraph
+  mutable std::unique_ptr<AMDGPURegisterLiveness> RegLiveness{};
+
   LiftedRepresentation();
 
 public:
@@ -0,0 +1,72 @@
+//===-- UniformExecRegions.h ------------------------------------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file describes the \c UniformExecRegion struct and the
+/// \c findUniformExecRegions function, which partitions a lifted machine
+/// function into regions of instructions that always execute together under
+/// the same exec mask.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_TOOLING_UNIFORM_EXEC_REGIONS_H
+#define LUTHIER_TOOLING_UNIFORM_EXEC_REGIONS_H
+#include <llvm/ADT/SmallVector.h>
+
+namespace llvm {
+
+class MachineInstr;
+
+class MachineFunction;
+
+} // namespace llvm
+
+namespace luthier {
+
+/// \brief A straight-line sequence of machine instructions, possibly spanning
+/// multiple basic blocks, in which every instruction executes exactly as many
+/// times as the first instruction of the region, each time under the exec mask
+/// the first instruction was executed with
+/// \details A region never contains an instruction that writes to the exec
+/// mask, a call, or a conditional or indirect branch, except as its last
+/// instruction. A region can continue from the end of a basic block to the
+/// beginning of another one if the first block is the only predecessor of
+/// the second block, and the second block is the only successor of the first
+/// one. \n
+/// Tools can use uniform exec regions to replace per-instruction vector hooks
+/// with a single hook at the beginning of each region, which only needs to
+/// inspect the exec mask once and can be lowered to purely scalar code
+struct UniformExecRegion {
+  /// Instructions of the region, in execution order
+  llvm::SmallVector<llvm::MachineInstr *, 16> Instructions{};
+
+  /// \return the first instruction of the region
+  [[nodiscard]] llvm::MachineInstr &front() const {
+    return *Instructions.front();
+  }
+
+  /// \return the number of instructions in the region
+  [[nodiscard]] size_t size() const { return Instructions.size(); }
+};
+
+/// Partitions the instructions of \p MF into <tt>UniformExecRegion</tt>s
+/// \param [in] MF a machine function of a \c LiftedRepresentation
+/// \param [out] Regions the uniform exec regions of \p MF; Each instruction
+/// of \p MF is placed in exactly one of the regions
+void findUniformExecRegions(
+    llvm::MachineFunction &MF,
+    llvm::SmallVectorImpl<UniformExecRegion> &Regions);
+
+} // namespace luthier
+
+#endif
@@ -113,8 +113,8 @@ f"""static {return_type} {function_name}_wrapper({", ".join(formatted_params)})
                 wrapper_defs.append(f"""    {return_type} Out{{}};\n""")
             wrapper_defs.append(
                 # @formatter:off
-"""    auto [HipUserCallback, UserCallbackLock] = HipInterceptor.getUserCallback();
-    auto [HipInternalCallback, InternalCallbackLock] = HipInterceptor.getInternalCallback();
+"""    const auto *HipUserCallback = HipInterceptor.getUserCallback();
+    const auto *HipInternalCallback = HipInterceptor.getInternalCallback();
     luthier::hip::ApiEvtArgs Args;
 """
                 # @formatter:on
@@ -397,7 +397,7 @@ llvm::Error luthier::hip::{interceptor_name}::disableInternalCallback(ApiEvtID O
      LUTHIER_ERROR_CHECK(
         static_cast<unsigned int>(HIP_{api_name.upper()}_API_EVT_ID_LAST) >= static_cast<unsigned int>(Op), "Requested op to be disabled is out of range."));
   EnabledInternalOps.erase(Op);
-  if (Status != FROZEN && !EnabledInternalOps.contains(Op)) {{
+  if (Status != FROZEN && !EnabledUserOps.contains(Op)) {{
     unsigned int OpIdx = static_cast<unsigned int>(Op) - 
                    static_cast<unsigned int>(HIP_{api_name.upper()}_API_EVT_ID_FIRST);
     Hip{api_name}WrapperSwitchFunctionsMap[OpIdx](RuntimeApiTable, SavedRuntimeApiTable, false);
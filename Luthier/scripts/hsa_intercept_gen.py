@@ -101,7 +101,7 @@ def main():
 #include <hsa/hsa_api_trace.h>
 #include <hsa/amd_hsa_queue.h>
 #include <llvm/ADT/DenseMapInfo.h>
-#include <vector>
+#include <llvm/ADT/SmallVector.h>
 #include "luthier/hsa/AqlPacket.h"
 #include "luthier/types.h"
 #include "luthier/common/ErrorCheck.h"
@@ -168,7 +168,7 @@ enum ApiEvtID: unsigned int {{
     # Handle the kernel launch event separately
     callback_arguments_struct.append("  struct {\n"
                                      "    amd_queue_t* queue;\n"
-                                     "    std::vector<luthier::hsa::AqlPacket>* packets;\n"
+                                     "    llvm::SmallVectorImpl<luthier::hsa::AqlPacket>* packets;\n"
                                      "    uint64_t user_pkt_index;\n"
                                      "  } hsa_queue_packet_submit;\n")
     callback_arguments_struct.append("""} ApiEvtArgs;
@@ -220,9 +220,9 @@ void luthier::hsa::HsaRuntimeInterceptor::toggleDisableUserCallbackInterceptionS
     DisableUserCallbackInterceptionScope = Disable;
 }}
 
-void queueSubmitWriteInterceptor(const void *Packets, uint64_t PktCount,
-                                 uint64_t UserPktIndex, void *Data, 
-                                 hsa_amd_queue_intercept_packet_writer Writer) {{
+void luthier::hsa::queueSubmitWriteInterceptor(const void *Packets, uint64_t PktCount,
+                                               uint64_t UserPktIndex, void *Data, 
+                                               hsa_amd_queue_intercept_packet_writer Writer) {{
   // This part handles the case where Luthier has been finalized, but there are 
   // still intercept queues in HIP trying to dispatch packets. Basically tells the
   // queue callbacks not to bother using the HSA Runtime interceptor, 
@@ -231,46 +231,59 @@ void queueSubmitWriteInterceptor(const void *Packets, uint64_t PktCount,
   //  Writer(Packets, PktCount);
   //  return;
   // }}
-  static luthier::EagerManagedStatic<std::mutex> Mutex;
-  Mutex->lock();
-  if (luthier::hip::HipRuntimeApiInterceptor::instance().getInterceptorStatus() == luthier::hip::HipRuntimeApiInterceptor::WAITING_FOR_API_TABLE) {{
-    // Trigger the initialization of the HIP runtime API table
-    hipApiName(0);
-  }}
-  Mutex->unlock(); 
-  
-  auto *Queue = reinterpret_cast<amd_queue_t*>(Data);
   auto &HsaInterceptor = luthier::hsa::HsaRuntimeInterceptor::instance();
+  // Pass-through: the tool has requested packets to not be inspected for now
+  if (HsaInterceptor.isPacketSubmitPassThroughEnabled()) {{
+    Writer(Packets, PktCount);
+    return;
+  }}
   HsaInterceptor.freezeRuntimeApiTable();
-  auto [HsaUserCallback, UserCallbackLock] = HsaInterceptor.getUserCallback();
-  auto [HsaInternalCallback, InternalCallbackLock] = HsaInterceptor.getInternalCallback();
   auto ApiId = luthier::hsa::HSA_API_EVT_ID_hsa_queue_packet_submit;
-  luthier::hsa::ApiEvtArgs Args;
-  bool IsUserCallbackEnabled = HsaInterceptor.isUserCallbackEnabled(ApiId);
+  bool IsUserCallbackEnabled = HsaInterceptor.isUserCallbackEnabled(ApiId) && 
+                               !DisableUserCallbackInterceptionScope;
   bool IsInternalCallbackEnabled = HsaInterceptor.isInternalCallbackEnabled(ApiId);
-  if (IsUserCallbackEnabled || IsInternalCallbackEnabled) {{
-    // Copy the packets to a non-const buffer
-    std::vector<luthier::hsa::AqlPacket> ModifiedPackets(
-      reinterpret_cast<const luthier::hsa::AqlPacket*>(Packets),
-      reinterpret_cast<const luthier::hsa::AqlPacket*>(Packets) + PktCount);
-    Args.hsa_queue_packet_submit.queue = Queue;
-    Args.hsa_queue_packet_submit.packets = &ModifiedPackets;
-    Args.hsa_queue_packet_submit.user_pkt_index = UserPktIndex;
-    if (IsUserCallbackEnabled && !DisableUserCallbackInterceptionScope)
-      (*HsaUserCallback)(&Args, luthier::API_EVT_PHASE_BEFORE, ApiId);
-    if (IsInternalCallbackEnabled)
-      (*HsaInternalCallback)(&Args, luthier::API_EVT_PHASE_BEFORE, ApiId);
-    // Write the packets to hardware queue
-    // Even if the packets are not modified, this call has to be made to ensure
-    // the packets are copied to the hardware queue
-    Writer(ModifiedPackets.data(), ModifiedPackets.size());
-    if (IsUserCallbackEnabled && !DisableUserCallbackInterceptionScope)
-      (*HsaUserCallback)(&Args, luthier::API_EVT_PHASE_AFTER, ApiId);
-    if (IsInternalCallbackEnabled)
-      (*HsaInternalCallback)(&Args, luthier::API_EVT_PHASE_AFTER, ApiId);
-  }} else {{
+  // Fast path: no one needs to inspect the packets, so forward them to the
+  // hardware queue untouched
+  if (!IsUserCallbackEnabled && !IsInternalCallbackEnabled) {{
     Writer(Packets, PktCount);
+    return;
   }}
+  static luthier::EagerManagedStatic<std::mutex> Mutex;
+  if (luthier::hip::HipRuntimeApiInterceptor::instance().getInterceptorStatus() == 
+      luthier::hip::HipRuntimeApiInterceptor::WAITING_FOR_API_TABLE) {{
+    std::lock_guard Lock(*Mutex);
+    if (luthier::hip::HipRuntimeApiInterceptor::instance().getInterceptorStatus() == 
+        luthier::hip::HipRuntimeApiInterceptor::WAITING_FOR_API_TABLE) {{
+      // Trigger the initialization of the HIP runtime API table, so that 
+      // callbacks can safely make HIP calls 
+      hipApiName(0);
+    }}
+  }}
+  
+  auto *Queue = reinterpret_cast<amd_queue_t*>(Data);
+  const auto *HsaUserCallback = HsaInterceptor.getUserCallback();
+  const auto *HsaInternalCallback = HsaInterceptor.getInternalCallback();
+  luthier::hsa::ApiEvtArgs Args;
+  // Copy the packets to a mutable buffer the callbacks can modify in place;
+  // The common case of a single packet per batch does not allocate on the heap
+  llvm::SmallVector<luthier::hsa::AqlPacket, 1> ModifiedPackets(
+    reinterpret_cast<const luthier::hsa::AqlPacket*>(Packets),
+    reinterpret_cast<const luthier::hsa::AqlPacket*>(Packets) + PktCount);
+  Args.hsa_queue_packet_submit.queue = Queue;
+  Args.hsa_queue_packet_submit.packets = &ModifiedPackets;
+  Args.hsa_queue_packet_submit.user_pkt_index = UserPktIndex;
+  if (IsUserCallbackEnabled)
+    (*HsaUserCallback)(&Args, luthier::API_EVT_PHASE_BEFORE, ApiId);
+  if (IsInternalCallbackEnabled)
+    (*HsaInternalCallback)(&Args, luthier::API_EVT_PHASE_BEFORE, ApiId);
+  // Write the packets to hardware queue
+  // Even if the packets are not modified, this call has to be made to ensure
+  // the packets are copied to the hardware queue
+  Writer(ModifiedPackets.data(), ModifiedPackets.size());
+  if (IsUserCallbackEnabled)
+    (*HsaUserCallback)(&Args, luthier::API_EVT_PHASE_AFTER, ApiId);
+  if (IsInternalCallbackEnabled)
+    (*HsaInternalCallback)(&Args, luthier::API_EVT_PHASE_AFTER, ApiId);
 }}
 
 static hsa_status_t createInterceptQueue(hsa_agent_t agent, uint32_t size, 
@@ -278,7 +291,18 @@ static hsa_status_t createInterceptQueue(hsa_agent_t agent, uint32_t size,
                                          void (* callback)(hsa_status_t status, hsa_queue_t* source, void* data), 
                                          void* data, uint32_t private_segment_size, 
                                          uint32_t group_segment_size, hsa_queue_t** queue) {{
-    const auto& AmdExtTable = luthier::hsa::HsaRuntimeInterceptor::instance().getSavedApiTableContainer().amd_ext;
+    auto &HsaInterceptor = luthier::hsa::HsaRuntimeInterceptor::instance();
+    const auto& SavedApiTable = HsaInterceptor.getSavedApiTableContainer();
+    auto ApiId = luthier::hsa::HSA_API_EVT_ID_hsa_queue_packet_submit;
+    // If no one is interested in the packets submitted to this queue, create a 
+    // regular hardware queue instead to avoid the intercept queue indirection
+    // on every dispatch
+    if (!HsaInterceptor.isUserCallbackEnabled(ApiId) && 
+        !HsaInterceptor.isInternalCallbackEnabled(ApiId))
+      return SavedApiTable.core.hsa_queue_create_fn(agent, size, type, callback, 
+                                                    data, private_segment_size, 
+                                                    group_segment_size, queue);
+    const auto& AmdExtTable = SavedApiTable.amd_ext;
     hsa_status_t Out = AmdExtTable.hsa_amd_queue_intercept_create_fn(agent, 
                                                                      size,
                                                                      type, 
@@ -289,7 +313,7 @@ static hsa_status_t createInterceptQueue(hsa_agent_t agent, uint32_t size,
                                                                      queue);
     if (Out != HSA_STATUS_SUCCESS)
       return Out;
-    Out = AmdExtTable.hsa_amd_queue_intercept_register_fn(*queue, queueSubmitWriteInterceptor, *queue);
+    Out = AmdExtTable.hsa_amd_queue_intercept_register_fn(*queue, luthier::hsa::queueSubmitWriteInterceptor, *queue);
     return Out;
 }}
 """]
@@ -326,8 +350,8 @@ static hsa_status_t createInterceptQueue(hsa_agent_t agent, uint32_t size,
                 if return_type != "void":
                     wrapper_defs.append(f"""    {return_type} Out{{}};
 """)
-                wrapper_defs.append("""    auto [HsaUserCallback, UserCallbackLock] = HsaInterceptor.getUserCallback();
-    auto [HsaInternalCallback, InternalCallbackLock] = HsaInterceptor.getInternalCallback();
+                wrapper_defs.append("""    const auto *HsaUserCallback = HsaInterceptor.getUserCallback();
+    const auto *HsaInternalCallback = HsaInterceptor.getInternalCallback();
     luthier::hsa::ApiEvtArgs Args;
 """)
                 for p in hsa_function_cxx.parameters:
@@ -516,7 +540,8 @@ llvm::Error luthier::hsa::HsaRuntimeInterceptor::disableUserCallback(ApiEvtID Op
      LUTHIER_ERROR_CHECK(
         static_cast<unsigned int>(HSA_API_EVT_ID_LAST) >= static_cast<unsigned int>(Op), "Requested op to be disabled is out of range."));
   EnabledUserOps.erase(Op);
-  if (Op != hsa::HSA_API_EVT_ID_hsa_queue_packet_submit && !EnabledUserOps.contains(Op))
+  if (Status != FROZEN && Op != hsa::HSA_API_EVT_ID_hsa_queue_packet_submit && 
+      !EnabledInternalOps.contains(Op))
     HsaWrapperSwitchFunctionsMap[Op](RuntimeApiTable, SavedRuntimeApiTable, false);
   return llvm::Error::success();
 }}
@@ -553,7 +578,8 @@ llvm::Error luthier::hsa::HsaRuntimeInterceptor::disableInternalCallback(ApiEvtI
      LUTHIER_ERROR_CHECK(
         static_cast<unsigned int>(HSA_API_EVT_ID_LAST) >= static_cast<unsigned int>(Op), "Requested op to be disabled is out of range."));
   EnabledInternalOps.erase(Op);
-  if (Op != hsa::HSA_API_EVT_ID_hsa_queue_packet_submit && !EnabledUserOps.contains(Op))
+  if (Status != FROZEN && Op != hsa::HSA_API_EVT_ID_hsa_queue_packet_submit && 
+      !EnabledUserOps.contains(Op))
     HsaWrapperSwitchFunctionsMap[Op](RuntimeApiTable, SavedRuntimeApiTable, false);
   return llvm::Error::success();
 }}"""
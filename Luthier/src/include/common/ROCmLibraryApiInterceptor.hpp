@@ -22,16 +22,58 @@
 #ifndef LUTHIER_COMMON_ROCM_LIBRARY_API_INTERCEPT_HPP
 #define LUTHIER_COMMON_ROCM_LIBRARY_API_INTERCEPT_HPP
 #include "luthier/common/LuthierError.h"
+#include <array>
+#include <atomic>
 #include <functional>
-#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
 #include <luthier/types.h>
+#include <memory>
 #include <mutex>
-#include <shared_mutex>
 
 namespace luthier {
 
+/// \brief A fixed-size set of API IDs backed by an array of atomic words
+/// \details Queried on every intercepted API call, hence a lookup is a single
+/// relaxed atomic load with no locks involved. Insertions and removals are
+/// atomic read-modify-write operations on the word holding the ID's bit
+/// \tparam ApiIDEnumType the enum type of the API IDs
+/// \tparam NumApiIDs the number of API IDs in the enum; All stored IDs must be
+/// less than \p NumApiIDs
+template <typename ApiIDEnumType, unsigned int NumApiIDs> class AtomicApiIDSet {
+  static constexpr unsigned int NumBitsPerWord = 64;
+
+  std::array<std::atomic<uint64_t>, (NumApiIDs + NumBitsPerWord - 1) /
+                                        NumBitsPerWord>
+      Words{};
+
+  static constexpr unsigned int getWordIdx(ApiIDEnumType Op) {
+    return static_cast<unsigned int>(Op) / NumBitsPerWord;
+  }
+
+  static constexpr uint64_t getBitMask(ApiIDEnumType Op) {
+    return uint64_t{1} << (static_cast<unsigned int>(Op) % NumBitsPerWord);
+  }
+
+public:
+  void insert(ApiIDEnumType Op) {
+    Words[getWordIdx(Op)].fetch_or(getBitMask(Op), std::memory_order_relaxed);
+  }
+
+  void erase(ApiIDEnumType Op) {
+    Words[getWordIdx(Op)].fetch_and(~getBitMask(Op),
+                                    std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool contains(ApiIDEnumType Op) const {
+    return Words[getWordIdx(Op)].load(std::memory_order_relaxed) &
+           getBitMask(Op);
+  }
+};
+
+/// \tparam NumApiIDs number of IDs in \p ApiIDEnumType, used to size the
+/// enabled op sets of the interceptor
 template <typename ApiIDEnumType, typename ApiArgsType, typename ApiTableType,
-          typename ApiTableContainerType>
+          typename ApiTableContainerType, unsigned int NumApiIDs>
 class ROCmLibraryApiInterceptor {
 public:
   /// typedef for the callback functions used by the interceptor
@@ -61,28 +103,40 @@ public:
   /// functions; Depending on the runtime, its type can be the same as the
   /// \c ApiTableType
   ApiTableContainerType SavedRuntimeApiTable{};
-  /// Mutex to protect \c EnabledUserOps, \c EnabledInternalOps, and enabling
-  /// disabling capturing of each Op
-  mutable std::shared_mutex EnabledOpsMutex;
   /// Set of API functions set to be intercepted by the user of the tool
-  llvm::DenseSet<ApiIDEnumType> EnabledUserOps{};
+  AtomicApiIDSet<ApiIDEnumType, NumApiIDs> EnabledUserOps{};
   /// Set of API functions set to be intercepted by Luthier internally
-  llvm::DenseSet<ApiIDEnumType> EnabledInternalOps{};
-  /// Mutex to protect Callback functions
-  mutable std::shared_mutex CallbackMutex;
+  AtomicApiIDSet<ApiIDEnumType, NumApiIDs> EnabledInternalOps{};
+  /// Mutex serializing writers of the callback functions; Readers do not
+  /// acquire it
+  std::mutex CallbackMutex;
+  /// Owns every callback published by the interceptor, including the ones
+  /// that have been replaced since; Replaced callbacks are kept alive until
+  /// the interceptor is destroyed, as API calls in flight on other threads
+  /// might still be invoking them
+  llvm::SmallVector<std::unique_ptr<const callback_t>, 2> PublishedCallbacks{};
   /// Callback requested by the user to be performed on interception of each
   /// enabled API
-  callback_t UserCallback{
-      [](ApiArgsType *, const luthier::ApiEvtPhase, const ApiIDEnumType) {}};
+  std::atomic<const callback_t *> UserCallback{publishCallback(
+      [](ApiArgsType *, const luthier::ApiEvtPhase, const ApiIDEnumType) {})};
   /// Callback requested by Luthier internally to be performed on interception
   /// of each enabled API
-  callback_t InternalCallback{
-      [](ApiArgsType *, const luthier::ApiEvtPhase, const ApiIDEnumType) {}};
+  std::atomic<const callback_t *> InternalCallback{publishCallback(
+      [](ApiArgsType *, const luthier::ApiEvtPhase, const ApiIDEnumType) {})};
   /// Ensures the \c freezeRuntimeApiTable will be performed only once
   std::once_flag FreezeRuntimeApiTableFlag{};
   /// Keeps track of the status of the interceptor
   InterceptorStatus Status{WAITING_FOR_API_TABLE};
 
+  /// Takes ownership of a copy of \p CB for the lifetime of the interceptor
+  /// \note \c CallbackMutex must be held by the caller after construction
+  /// \return a pointer to the copy of \p CB, which can be published to
+  /// the readers of the callbacks
+  const callback_t *publishCallback(const callback_t &CB) {
+    return PublishedCallbacks.emplace_back(std::make_unique<callback_t>(CB))
+        .get();
+  }
+
 public:
   ROCmLibraryApiInterceptor() = default;
   virtual ~ROCmLibraryApiInterceptor() = default;
@@ -102,38 +156,33 @@ public:
   /// Sets the callback function \p CB to be performed on each captured API
   /// for the user of the Luthier tool
   /// \param CB callback to be performed
-  /// \note this function acquires a unique lock over the callback
-  /// mutex; Hence any read locks over the callbacks must be released first
+  /// \note API calls already in flight on other threads might still invoke the
+  /// previous callback after this function returns
   void setUserCallback(const callback_t &CB) {
-    std::unique_lock Lock(CallbackMutex);
-    UserCallback = CB;
+    std::lock_guard Lock(CallbackMutex);
+    UserCallback.store(publishCallback(CB), std::memory_order_release);
   }
 
   /// Sets the callback function \p CB to be performed on each captured API
   /// internally by Luthier
   /// \param CB callback to be performed
-  /// \note this function acquires a unique lock over the callback
-  /// mutex; Hence any read locks over the callbacks must be released first
+  /// \note API calls already in flight on other threads might still invoke the
+  /// previous callback after this function returns
   void setInternalCallback(const callback_t &CB) {
-    std::unique_lock Lock(CallbackMutex);
-    InternalCallback = CB;
+    std::lock_guard Lock(CallbackMutex);
+    InternalCallback.store(publishCallback(CB), std::memory_order_release);
   }
 
-  /// \return a reference to the user callback
-  /// \note this function is not thread-safe; Call
-  [[nodiscard]] inline std::pair<const callback_t *,
-                                 std::shared_lock<std::shared_mutex>>
-  getUserCallback() const {
-    std::shared_lock Lock(CallbackMutex);
-    return std::make_pair(&UserCallback, std::move(Lock));
+  /// \return a pointer to the user callback, which remains valid for the
+  /// lifetime of the interceptor
+  [[nodiscard]] inline const callback_t *getUserCallback() const {
+    return UserCallback.load(std::memory_order_acquire);
   }
 
-  /// \return a reference to the internal Luthier callback
-  [[nodiscard]] inline std::pair<const callback_t *,
-                                 std::shared_lock<std::shared_mutex>>
-  getInternalCallback() const {
-    std::shared_lock Lock(CallbackMutex);
-    return std::make_pair(&InternalCallback, std::move(Lock));
+  /// \return a pointer to the internal Luthier callback, which remains valid
+  /// for the lifetime of the interceptor
+  [[nodiscard]] inline const callback_t *getInternalCallback() const {
+    return InternalCallback.load(std::memory_order_acquire);
   }
 
   /// Checks if the Luthier tool user will get a callback every time a function
@@ -141,7 +190,6 @@ public:
   /// \param Op the API enum queried
   /// \return true if the Luthier tool user will get a callback, false otherwise
   [[nodiscard]] bool isUserCallbackEnabled(ApiIDEnumType Op) const {
-    std::shared_lock Lock(EnabledOpsMutex);
     return EnabledUserOps.contains(Op);
   }
 
@@ -150,7 +198,6 @@ public:
   /// \param Op the API enum queried
   /// \return true if the Luthier tool will get a callback, false otherwise
   [[nodiscard]] bool isInternalCallbackEnabled(ApiIDEnumType Op) const {
-    std::shared_lock Lock(EnabledOpsMutex);
     return EnabledInternalOps.contains(Op);
   }
 
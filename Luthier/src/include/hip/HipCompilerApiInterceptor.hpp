@@ -35,7 +35,8 @@ namespace luthier::hip {
 class HipCompilerApiInterceptor final
     : public ROCmLibraryApiInterceptor<ApiEvtID, ApiEvtArgs,
                                        HipCompilerDispatchTable,
-                                       HipCompilerDispatchTable>,
+                                       HipCompilerDispatchTable,
+                                       HIP_COMPILER_API_EVT_ID_LAST + 1>,
       public Singleton<HipCompilerApiInterceptor> {
 
 public:
@@ -35,7 +35,8 @@ namespace luthier::hip {
 class HipRuntimeApiInterceptor
     : public ROCmLibraryApiInterceptor<luthier::hip::ApiEvtID,
                                        luthier::hip::ApiEvtArgs,
-                                       HipDispatchTable, HipDispatchTable>,
+                                       HipDispatchTable, HipDispatchTable,
+                                       HIP_RUNTIME_API_EVT_ID_LAST + 1>,
       public Singleton<HipRuntimeApiInterceptor> {
 
 public:
@@ -0,0 +1,138 @@
+//===-- DispatchCompletionHandler.hpp - Async Dispatch Completion ---------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the \c hsa::DispatchCompletionHandler Singleton, in
+/// charge of notifying tools asynchronously when a dispatched kernel finishes
+/// execution.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_HSA_DISPATCH_COMPLETION_HANDLER_HPP
+#define LUTHIER_HSA_DISPATCH_COMPLETION_HANDLER_HPP
+#include "common/Singleton.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <hsa/hsa.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Error.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace luthier::hsa {
+
+/// \brief Singleton in charge of invoking tool callbacks once a kernel
+/// dispatch packet has finished executing on the device, without blocking
+/// the thread that submitted the packet
+/// \details The completion signal of each registered dispatch packet is
+/// swapped with a signal from an internal pool, which is monitored with
+/// \c hsa_amd_signal_async_handler. Once the packet processor decrements the
+/// pooled signal, the dispatch timestamps written to it by the packet
+/// processor are copied to the application's original completion signal (if
+/// any), which is then decremented on its behalf, so that the application
+/// and other profilers can still query the timestamps of the dispatch with
+/// \c hsa_amd_profiling_get_dispatch_time. The tool callback is then handed
+/// to a dedicated worker thread. This way tool callbacks are allowed to make
+/// blocking HSA/HIP calls (e.g. copying back device results) without
+/// stalling the HSA runtime's async event thread. Pooled signals are reset
+/// and re-used once their callback has finished
+class DispatchCompletionHandler final
+    : public Singleton<DispatchCompletionHandler> {
+public:
+  /// Type of the callback invoked once a dispatch has completed
+  typedef std::function<void(const hsa_kernel_dispatch_packet_t &)> callback_t;
+
+private:
+  /// Bookkeeping for a single dispatch awaiting completion
+  struct PendingDispatch {
+    /// Copy of the dispatch packet at the time of registration, with its
+    /// original completion signal
+    hsa_kernel_dispatch_packet_t Packet;
+    /// The pooled signal that replaced the packet's completion signal
+    hsa_signal_t PooledSignal;
+    /// The tool callback to be invoked after completion
+    callback_t Callback;
+  };
+
+  /// Mutex protecting \c FreeSignals
+  std::mutex PoolMutex;
+
+  /// Signals created by the handler that are not currently attached to
+  /// any in-flight dispatch packet
+  llvm::SmallVector<hsa_signal_t, 0> FreeSignals{};
+
+  /// Mutex protecting the worker state below
+  std::mutex WorkMutex;
+
+  /// Notifies the worker thread of new completed dispatches or shutdown
+  std::condition_variable WorkCV;
+
+  /// Notifies threads waiting inside \c drain of finished callbacks
+  std::condition_variable DrainCV;
+
+  /// Dispatches that have completed on the device, but their callbacks
+  /// have not been invoked yet
+  std::deque<std::unique_ptr<PendingDispatch>> CompletedDispatches{};
+
+  /// Number of registered dispatches whose callbacks have not finished yet
+  size_t NumPendingDispatches{0};
+
+  /// Set when the worker thread must exit
+  bool IsShuttingDown{false};
+
+  /// Worker thread invoking the tool callbacks; Launched lazily on the first
+  /// callback registration
+  std::thread Worker{};
+
+  /// \return a signal with its value set to one, either from the pool or
+  /// newly created
+  llvm::Expected<hsa_signal_t> acquireSignal();
+
+  /// Resets the value of \p Signal to one and returns it to the pool
+  void releaseSignal(hsa_signal_t Signal);
+
+  /// Handler passed to \c hsa_amd_signal_async_handler for each pooled signal
+  /// \param Value the current value of the pooled signal
+  /// \param Arg a pointer to the \c PendingDispatch of the signal
+  /// \return always \c false, so that the handler is not re-armed
+  static bool asyncSignalHandler(hsa_signal_value_t Value, void *Arg);
+
+  /// Main loop of the \c Worker thread
+  void processCompletedDispatches();
+
+public:
+  DispatchCompletionHandler() = default;
+
+  ~DispatchCompletionHandler() override;
+
+  /// Arranges \p Callback to be invoked on a Luthier-managed thread once the
+  /// kernel dispatched by \p Packet finishes execution
+  /// \note Must be called before \p Packet is written to the hardware queue,
+  /// as it replaces the packet's completion signal
+  /// \param Packet the dispatch packet about to be submitted
+  /// \param Callback the function invoked after completion with a copy of
+  /// \p Packet, as it was at the time of this call
+  /// \return an \c llvm::Error indicating any HSA issues encountered
+  llvm::Error registerCallback(hsa_kernel_dispatch_packet_t &Packet,
+                               const callback_t &Callback);
+
+  /// Blocks until all callbacks registered so far have finished running
+  void drain();
+};
+
+} // namespace luthier::hsa
+
+#endif
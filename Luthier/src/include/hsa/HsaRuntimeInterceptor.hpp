@@ -26,6 +26,7 @@
 #include "luthier/common/ErrorCheck.h"
 #include "luthier/common/LuthierError.h"
 #include "luthier/hsa/HsaError.h"
+#include <atomic>
 #include <hsa/hsa_ven_amd_loader.h>
 #include <llvm/ADT/DenseSet.h>
 #include <luthier/hsa/TraceApi.h>
@@ -36,12 +37,17 @@ namespace luthier::hsa {
 class HsaRuntimeInterceptor final
     : public Singleton<HsaRuntimeInterceptor>,
       public ROCmLibraryApiInterceptor<ApiEvtID, ApiEvtArgs, HsaApiTable,
-                                       HsaApiTableContainer> {
+                                       HsaApiTableContainer,
+                                       HSA_API_EVT_ID_LAST + 1> {
 private:
   /// Holds function pointers to the AMD's loader API \n
   /// The loader API does not get intercepted in this class
   hsa_ven_amd_loader_1_03_pfn_s AmdTable{};
 
+  /// When set, packets submitted to intercept queues are written to the
+  /// hardware queue without invoking any packet submit callbacks
+  std::atomic<bool> IsPacketSubmitPassThroughEnabled{false};
+
   void uninstallApiTables() {
     if (RuntimeApiTable) {
       if (RuntimeApiTable->core_)
@@ -97,7 +103,36 @@ public:
   }
 
   void toggleDisableUserCallbackInterceptionScope(bool Disable);
+
+  /// Enables or disables the packet submit pass-through state
+  /// \param Enable if \c true, packets submitted to intercept queues will be
+  /// forwarded to the hardware queue without invoking any callbacks
+  void setPacketSubmitPassThrough(bool Enable) {
+    IsPacketSubmitPassThroughEnabled.store(Enable, std::memory_order_relaxed);
+  }
+
+  /// \return \c true if packet submit pass-through is enabled, \c false
+  /// otherwise
+  [[nodiscard]] bool isPacketSubmitPassThroughEnabled() const {
+    return IsPacketSubmitPassThroughEnabled.load(std::memory_order_relaxed);
+  }
 };
+
+/// Packet writer callback registered with all intercept queues created by
+/// the \c HsaRuntimeInterceptor; Invokes the
+/// \c HSA_API_EVT_ID_hsa_queue_packet_submit callbacks (if enabled) before and
+/// after writing the \p Packets to the hardware queue via \p Writer
+/// \note If no callbacks are enabled for packet submission, the \p Packets are
+/// forwarded to the \p Writer untouched
+/// \param Packets the packets submitted by the application
+/// \param PktCount number of packets in \p Packets
+/// \param UserPktIndex index of the first packet in the application's queue
+/// \param Data the \c hsa_queue_t of the intercept queue
+/// \param Writer writes the packets to the underlying hardware queue
+void queueSubmitWriteInterceptor(const void *Packets, uint64_t PktCount,
+                                 uint64_t UserPktIndex, void *Data,
+                                 hsa_amd_queue_intercept_packet_writer Writer);
+
 } // namespace luthier::hsa
 
 #endif
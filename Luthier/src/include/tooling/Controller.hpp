@@ -46,6 +46,8 @@ namespace hsa {
 class HsaRuntimeInterceptor;
 
 class ExecutableBackedObjectsCache;
+
+class DispatchCompletionHandler;
 } // namespace hsa
 
 /// \brief a \c Singleton in charge of managing all other singletons in Luthier,
@@ -76,6 +78,9 @@ private:
   /// \c hsa::ExecutableBackedObjectsCache \c Singleton instance
   hsa::ExecutableBackedObjectsCache *HsaPlatform{nullptr};
 
+  /// \c hsa::DispatchCompletionHandler \c Singleton instance
+  hsa::DispatchCompletionHandler *DCH{nullptr};
+
   /// A callback invoked before/after when rocprofiler has provided the
   /// HSA API table to the Luthier tool
   std::function<void(ApiEvtPhase)> AtHSAApiTableCaptureEvtCallback{
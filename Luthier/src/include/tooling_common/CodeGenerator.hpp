@@ -23,9 +23,14 @@
 #define LUTHIER_TOOLING_COMMON_CODE_GENERATOR_HPP
 #include "common/Singleton.hpp"
 #include "luthier/intrinsic/IntrinsicProcessor.h"
+#include <llvm/ADT/DenseMap.h>
 
 namespace llvm {
 
+class MachineFunction;
+
+class MachineInstr;
+
 class MachineModuleInfoWrapperPass;
 
 } // namespace llvm
@@ -36,6 +41,10 @@ class InstrumentationTask;
 
 class LiftedRepresentation;
 
+class LRCallGraph;
+
+class AMDGPURegisterLiveness;
+
 namespace hsa {
 
 class ISA;
@@ -89,6 +98,22 @@ public:
                                             LiftedRepresentation &)>
                  Mutator);
 
+  /// Instruments the passed \p LR by first cloning it and then applying
+  /// each of the \p Mutators onto the same clone, in order \n
+  /// Each mutator populates its own \c InstrumentationTask, with its own
+  /// options; The tasks are then merged via \c InstrumentationTask::append
+  /// and generated as one, so that hooks of different mutators inserted
+  /// before the same instruction end up in the same injected payload
+  /// \param LR the \c LiftedRepresentation about to be instrumented
+  /// \param Mutators the functions that can modify the lifted representation
+  /// \return a new \c LiftedRepresentation containing the instrumented code,
+  /// or an \c llvm::Error in case an issue was encountered during the process
+  llvm::Expected<std::unique_ptr<LiftedRepresentation>>
+  instrument(const LiftedRepresentation &LR,
+             llvm::ArrayRef<llvm::function_ref<llvm::Error(
+                 InstrumentationTask &, LiftedRepresentation &)>>
+                 Mutators);
+
   /// Runs the \c llvm::AsmPrinter pass on the \p Module and the
   /// \c llvm::MachineModuleInfo of the \p MMIWP to generate a relocatable file
   /// \note This function does not access the Module's \c llvm::LLVMContext in a
@@ -123,6 +148,20 @@ public:
                               llvm::SmallVectorImpl<uint8_t> &Out);
 
 private:
+  /// \brief Analyses of the \c LiftedRepresentation an instrumented clone was
+  /// created from, along with the mappings needed to re-use them for the
+  /// clone
+  struct SourceLRAnalyses {
+    const LRCallGraph &CG;
+    const AMDGPURegisterLiveness &RegLiveness;
+    const llvm::DenseMap<const llvm::MachineFunction *,
+                         const llvm::MachineFunction *> &SrcToDstMFMap;
+    const llvm::DenseMap<const llvm::MachineInstr *,
+                         const llvm::MachineInstr *> &SrcToDstMIMap;
+    const llvm::DenseMap<const llvm::MachineInstr *,
+                         const llvm::MachineInstr *> &DstToSrcMIMap;
+  };
+
   /// Applies the instrumentation task \p Task to the lifted representation
   /// of \p LR \n
   /// The \p Task is created and populated by the mutator function
@@ -131,10 +170,14 @@ private:
   /// contains a set of hook calls that will be injected before a set of
   /// <tt>llvm::MachineInstr</tt>s of the target application
   /// \param [in, out] LR the \c LiftedRepresentation being instrumented
+  /// \param [in] SrcAnalyses if \p LR is an unmodified clone, the analyses of
+  /// its source, which are re-used instead of being computed from scratch
   /// \return an \c llvm::Error indicating if any issues where encountered
   /// during the process
-  llvm::Error applyInstrumentationTask(const InstrumentationTask &Task,
-                                       LiftedRepresentation &LR);
+  llvm::Error
+  applyInstrumentationTask(const InstrumentationTask &Task,
+                           LiftedRepresentation &LR,
+                           const SourceLRAnalyses *SrcAnalyses = nullptr);
 };
 
 } // namespace luthier
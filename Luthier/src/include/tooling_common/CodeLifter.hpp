@@ -57,6 +57,10 @@
 
 namespace luthier {
 
+class LRCallGraph;
+
+class AMDGPURegisterLiveness;
+
 /// \brief A singleton class in charge of: \n
 /// 1. disassembling an \c hsa::ExecutableSymbol of type \c KERNEL or
 /// \c DEVICE_FUNCTION using LLVM MC and returning them as a vector of \c
@@ -396,8 +400,31 @@ public:
   llvm::Expected<const LiftedRepresentation &>
   lift(const hsa::LoadedCodeObjectKernel &KernelSymbol);
 
-  llvm::Expected<std::unique_ptr<LiftedRepresentation>>
-  cloneRepresentation(const LiftedRepresentation &SrcLR);
+  /// Clones the \p SrcLR
+  /// \param [out] SrcToDstMFMap if not \c nullptr, will be populated with a
+  /// mapping between the machine functions of \p SrcLR and their clones
+  /// \param [out] SrcToDstMIMap if not \c nullptr, will be populated with a
+  /// mapping between the machine instructions of \p SrcLR and their clones
+  /// \return on success, the cloned representation; an \c llvm::Error on
+  /// failure
+  llvm::Expected<std::unique_ptr<LiftedRepresentation>> cloneRepresentation(
+      const LiftedRepresentation &SrcLR,
+      llvm::DenseMap<const llvm::MachineFunction *,
+                     const llvm::MachineFunction *> *SrcToDstMFMap = nullptr,
+      llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+          *SrcToDstMIMap = nullptr);
+
+  /// Returns the call graph and register liveness analyses of \p LR, a
+  /// representation cached by the \c CodeLifter; The analyses are computed
+  /// on first use and cached alongside \p LR until it gets invalidated
+  /// \param [out] CG set to the call graph of \p LR, or \c nullptr if \p LR
+  /// is not cached by the \c CodeLifter
+  /// \param [out] RegLiveness set to the register liveness of \p LR, or
+  /// \c nullptr if \p LR is not cached by the \c CodeLifter
+  /// \return an \c llvm::Error if the analyses failed to be computed
+  llvm::Error getCachedAnalyses(const LiftedRepresentation &LR,
+                                const LRCallGraph *&CG,
+                                const AMDGPURegisterLiveness *&RegLiveness);
 };
 
 } // namespace luthier
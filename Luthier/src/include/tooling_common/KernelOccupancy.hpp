@@ -0,0 +1,148 @@
+//===-- KernelOccupancy.hpp - Kernel Occupancy and Budget -------*- C++ -*-===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file describes functions for calculating the occupancy of a kernel
+/// from its kernel descriptor, as well as the \c OccupancyBudgetAnalysis,
+/// which calculates the registers the instrumented code is allowed to use
+/// without lowering the occupancy of the kernel below what the
+/// \c InstrumentationTask requires.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_TOOLING_COMMON_KERNEL_OCCUPANCY_HPP
+#define LUTHIER_TOOLING_COMMON_KERNEL_OCCUPANCY_HPP
+#include <limits>
+#include <llvm/CodeGen/LivePhysRegs.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/Error.h>
+
+namespace llvm {
+class MCSubtargetInfo;
+} // namespace llvm
+
+namespace luthier {
+
+namespace hsa {
+struct KernelDescriptor;
+
+class LoadedCodeObjectKernel;
+} // namespace hsa
+
+class InstrumentationTask;
+
+class LiftedRepresentation;
+
+/// \brief Resources used by a kernel which limit its occupancy, and the
+/// resulting occupancy
+struct KernelOccupancy {
+  /// Number of VGPRs allocated to each wave, including AGPRs on targets
+  /// with a unified register file
+  unsigned int NumVGPRs{0};
+  /// Number of SGPRs allocated to each wave; Zero for targets where the
+  /// SGPRs do not limit occupancy
+  unsigned int NumSGPRs{0};
+  /// Size of the LDS allocated to each workgroup in bytes
+  unsigned int GroupSegmentSize{0};
+  /// Size of the scratch memory allocated to each work-item in bytes
+  unsigned int PrivateSegmentSize{0};
+  /// Maximum number of waves of the kernel that can reside on each SIMD
+  unsigned int WavesPerEU{0};
+};
+
+/// Calculates the occupancy of a kernel using its kernel descriptor
+/// \param KD the kernel descriptor of the kernel, on the host
+/// \param STI the sub-target the kernel was compiled for
+/// \param MaxFlatWorkgroupSize the maximum workgroup size the kernel can be
+/// launched with, used to estimate the number of waves limited by the LDS
+/// usage; Zero if unknown
+/// \return the occupancy of the kernel
+KernelOccupancy getKernelOccupancy(const hsa::KernelDescriptor &KD,
+                                   const llvm::MCSubtargetInfo &STI,
+                                   unsigned int MaxFlatWorkgroupSize);
+
+/// Calculates the occupancy of a loaded \p Kernel using its kernel descriptor
+/// and its metadata
+/// \return the occupancy of the \p Kernel, or an \c llvm::Error if the
+/// process failed
+llvm::Expected<KernelOccupancy>
+getKernelOccupancy(const hsa::LoadedCodeObjectKernel &Kernel);
+
+/// \brief Number of registers of each kind the instrumented code of a
+/// \c LiftedRepresentation is allowed to use without violating the occupancy
+/// requirements of its \c InstrumentationTask
+class OccupancyBudget {
+private:
+  /// Minimum number of waves per SIMD the instrumented kernel must be able to
+  /// run with, or zero if the task has no occupancy requirements
+  unsigned int MinWavesPerEU{0};
+  /// Number of VGPRs the instrumented code is allowed to use
+  unsigned int MaxNumVGPRs{std::numeric_limits<unsigned int>::max()};
+  /// Number of AGPRs the instrumented code is allowed to use
+  unsigned int MaxNumAGPRs{std::numeric_limits<unsigned int>::max()};
+  /// Number of SGPRs the instrumented code is allowed to use
+  unsigned int MaxNumSGPRs{std::numeric_limits<unsigned int>::max()};
+
+public:
+  OccupancyBudget() = default;
+
+  /// Calculates the budget for instrumenting \p LR with \p Task
+  /// \return an \c llvm::Error indicating the success or failure of the
+  /// operation
+  llvm::Error calculate(const LiftedRepresentation &LR,
+                        const InstrumentationTask &Task);
+
+  /// \return \c true if the instrumented code is under an occupancy budget,
+  /// \c false otherwise
+  [[nodiscard]] bool isActive() const { return MinWavesPerEU != 0; }
+
+  /// \return the minimum number of waves per SIMD the instrumented kernel
+  /// must be able to run with, or zero if there is no budget
+  [[nodiscard]] unsigned int getMinWavesPerEU() const { return MinWavesPerEU; }
+
+  /// Adds the registers outside the budget to \p Regs
+  /// \param [in, out] Regs an initialized set of physical registers, to
+  /// which the registers the instrumented code cannot use are added
+  void addRegistersOutsideBudget(llvm::LivePhysRegs &Regs) const;
+
+  bool invalidate(llvm::Module &, const llvm::PreservedAnalyses &,
+                  llvm::ModuleAnalysisManager::Invalidator &) {
+    return false;
+  }
+};
+
+/// \brief Calculates the \c OccupancyBudget of the \c LiftedRepresentation
+/// being instrumented
+class OccupancyBudgetAnalysis
+    : public llvm::AnalysisInfoMixin<OccupancyBudgetAnalysis> {
+private:
+  friend llvm::AnalysisInfoMixin<OccupancyBudgetAnalysis>;
+
+  static llvm::AnalysisKey Key;
+
+  /// The task being applied to the \c LiftedRepresentation
+  const InstrumentationTask &Task;
+
+public:
+  using Result = OccupancyBudget;
+
+  explicit OccupancyBudgetAnalysis(const InstrumentationTask &Task)
+      : Task(Task) {}
+
+  Result run(llvm::Module &TargetModule, llvm::ModuleAnalysisManager &MAM);
+};
+
+} // namespace luthier
+
+#endif
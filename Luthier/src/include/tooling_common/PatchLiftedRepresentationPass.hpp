@@ -24,9 +24,19 @@
 #include <llvm/CodeGen/MachineBasicBlock.h>
 #include <llvm/CodeGen/MachineModuleInfo.h>
 #include <llvm/IR/PassManager.h>
+#include <llvm/MC/MCRegister.h>
 
 namespace luthier {
 
+/// \brief A set of instrumentation points inside the same function whose
+/// injected payloads are identical, and are patched as a single outlined copy
+struct SharedInjectedPayload {
+  /// The injected payload of the first instrumentation point of the set
+  const llvm::MachineFunction *InjectedPayloadMF;
+  /// The instrumentation points sharing the injected payload
+  llvm::SmallVector<llvm::MachineInstr *, 4> InsertionPoints{};
+};
+
 class PatchLiftedRepresentationPass
     : public llvm::PassInfoMixin<PatchLiftedRepresentationPass> {
 public:
@@ -52,6 +62,18 @@ private:
   decidePatchingMethod(llvm::Module &TargetAppM,
                        llvm::ModuleAnalysisManager &TargetMAM);
 
+  /// Finds the sets of instrumentation points inside outlined functions that
+  /// can share a single copy of their injected payload
+  /// \param [out] ReturnAddressRegs the 64-bit SGPR used by the shared
+  /// injected payloads of each function to hold their return address
+  /// \return the shared injected payloads of \p TargetAppM
+  llvm::SmallVector<SharedInjectedPayload> findSharedInjectedPayloads(
+      llvm::Module &TargetAppM, llvm::ModuleAnalysisManager &TargetMAM,
+      const llvm::DenseMap<const llvm::MachineFunction *, PatchType>
+          &PatchMethods,
+      llvm::DenseMap<const llvm::MachineFunction *, llvm::MCRegister>
+          &ReturnAddressRegs);
+
 public:
   PatchLiftedRepresentationPass(llvm::Module &IModule,
                                 llvm::MachineModuleInfo &IMMI)
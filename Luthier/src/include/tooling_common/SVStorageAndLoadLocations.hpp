@@ -27,6 +27,7 @@
 #include "hsa/LoadedCodeObject.hpp"
 #include "luthier/tooling/AMDGPURegisterLiveness.h"
 #include "luthier/tooling/LiftedRepresentation.h"
+#include "tooling_common/KernelOccupancy.hpp"
 #include "tooling_common/PrePostAmbleEmitter.hpp"
 #include "tooling_common/StateValueArrayStorage.hpp"
 #include <llvm/CodeGen/SlotIndexes.h>
@@ -120,10 +121,37 @@ private:
   llvm::DenseMap<const llvm::MachineInstr *, InstPointSVALoadPlan>
       InstPointSVSLoadPlans{};
 
+  /// Schedules the storage of the state value array inside \p MF by
+  /// walking its instructions in layout order and relocating the storage
+  /// whenever its registers become live
+  llvm::Error scheduleStorageGreedily(
+      llvm::MachineFunction &MF, const llvm::SlotIndexes &SlotIndexes,
+      const AMDGPURegisterLiveness &RegLiveness,
+      const InjectedPayloadAndInstPoint &IPIP,
+      llvm::ArrayRef<StateValueArrayStorage::StorageKind> SupportedStorage,
+      int MaxNumAGPRsUsedByAllStorage, int MaxNumSGPRsUsedByAllStorage,
+      const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns);
+
+  /// Schedules the storage of the state value array inside \p MF by
+  /// minimizing the estimated number of dynamically executed instructions
+  /// spent on switching between storage locations and on loading/storing
+  /// the state value array around hooks over the whole function
+  /// \return \c true if a schedule was found, \c false if no storage
+  /// location could be kept at all basic block boundaries of \p MF
+  llvm::Expected<bool> scheduleStorageGlobally(
+      llvm::MachineFunction &MF, const llvm::SlotIndexes &SlotIndexes,
+      const AMDGPURegisterLiveness &RegLiveness,
+      const InjectedPayloadAndInstPoint &IPIP,
+      llvm::ArrayRef<StateValueArrayStorage::StorageKind> SupportedStorage,
+      const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns);
+
 public:
   SVStorageAndLoadLocations() = default;
 
   /// calculates the storage and load locations of the state value array
+  /// \param Budget the occupancy budget of the instrumented code; Registers
+  /// outside the budget are never used for storing or loading the state
+  /// value array
   /// \return an \c llvm::Error indication the success of failure of the
   /// operation
   llvm::Error calculate(
@@ -131,7 +159,8 @@ public:
       const MMISlotIndexesAnalysis::Result &SlotIndexes,
       const AMDGPURegisterLiveness &RegLiveness,
       const InjectedPayloadAndInstPoint &IPIP, FunctionPreambleDescriptor &FPD,
-      const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns);
+      const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns,
+      const OccupancyBudget &Budget);
 
   /// Given the \p MBB of the \c LiftedRepresentation being worked on by this
   /// analysis, returns the state value array storage of every instruction
@@ -0,0 +1,219 @@
+//===-- api_interceptor_benchmark.cpp - API Interceptor Lookup Bench ------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements a micro-benchmark measuring the per-call overhead of
+/// the \c ROCmLibraryApiInterceptor on intercepted API functions. It uses a
+/// fake API table with wrappers laid out the same way as the generated
+/// HSA/HIP wrappers, and calls into it from multiple threads while callbacks
+/// are enabled, disabled, and replaced.
+//===----------------------------------------------------------------------===//
+#include "common/ROCmLibraryApiInterceptor.hpp"
+#include "luthier/common/ErrorCheck.h"
+#include <chrono>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/raw_ostream.h>
+#include <thread>
+#include <vector>
+
+using namespace luthier;
+
+namespace {
+
+enum FakeApiEvtID : unsigned int {
+  FAKE_API_EVT_ID_FIRST = 0,
+  FAKE_API_EVT_ID_add = 0,
+  FAKE_API_EVT_ID_sub = 1,
+  FAKE_API_EVT_ID_LAST = 1,
+};
+
+union FakeApiEvtArgs {
+  struct {
+    uint64_t a;
+    uint64_t b;
+  } add;
+  struct {
+    uint64_t a;
+    uint64_t b;
+  } sub;
+};
+
+/// Stands in for a ROCm runtime API dispatch table
+struct FakeApiTable {
+  uint64_t (*add_fn)(uint64_t, uint64_t);
+  uint64_t (*sub_fn)(uint64_t, uint64_t);
+};
+
+/// The "actual" API functions of the fake runtime; Not inlined so that the
+/// benchmark reflects a call through the runtime's dispatch table
+[[gnu::noinline]] uint64_t fakeAdd(uint64_t A, uint64_t B) { return A + B; }
+
+[[gnu::noinline]] uint64_t fakeSub(uint64_t A, uint64_t B) { return A - B; }
+
+FakeApiTable FakeRuntimeTable{fakeAdd, fakeSub};
+
+class FakeApiInterceptor final
+    : public ROCmLibraryApiInterceptor<FakeApiEvtID, FakeApiEvtArgs,
+                                       FakeApiTable, FakeApiTable,
+                                       FAKE_API_EVT_ID_LAST + 1> {
+public:
+  llvm::Error enableUserCallback(FakeApiEvtID Op) override {
+    EnabledUserOps.insert(Op);
+    return llvm::Error::success();
+  }
+
+  llvm::Error disableUserCallback(FakeApiEvtID Op) override {
+    EnabledUserOps.erase(Op);
+    return llvm::Error::success();
+  }
+
+  llvm::Error enableInternalCallback(FakeApiEvtID Op) override {
+    EnabledInternalOps.insert(Op);
+    return llvm::Error::success();
+  }
+
+  llvm::Error disableInternalCallback(FakeApiEvtID Op) override {
+    EnabledInternalOps.erase(Op);
+    return llvm::Error::success();
+  }
+
+  llvm::Error captureApiTable(FakeApiTable *Table) override {
+    RuntimeApiTable = Table;
+    SavedRuntimeApiTable = *Table;
+    Status = API_TABLE_CAPTURED;
+    return llvm::Error::success();
+  }
+};
+
+FakeApiInterceptor *Interceptor{nullptr};
+
+/// Wrapper of \c fakeAdd, following the structure of the generated HSA/HIP
+/// API wrappers
+uint64_t fakeAddWrapper(uint64_t A, uint64_t B) {
+  auto &FakeInterceptor = *Interceptor;
+  FakeInterceptor.freezeRuntimeApiTable();
+  auto ApiId = FAKE_API_EVT_ID_add;
+  bool IsUserCallbackEnabled = FakeInterceptor.isUserCallbackEnabled(ApiId);
+  bool IsInternalCallbackEnabled =
+      FakeInterceptor.isInternalCallbackEnabled(ApiId);
+  bool ShouldCallback = IsUserCallbackEnabled || IsInternalCallbackEnabled;
+  if (ShouldCallback) {
+    const auto *UserCallback = FakeInterceptor.getUserCallback();
+    const auto *InternalCallback = FakeInterceptor.getInternalCallback();
+    FakeApiEvtArgs Args;
+    Args.add.a = A;
+    Args.add.b = B;
+    if (IsUserCallbackEnabled)
+      (*UserCallback)(&Args, API_EVT_PHASE_BEFORE, ApiId);
+    if (IsInternalCallbackEnabled)
+      (*InternalCallback)(&Args, API_EVT_PHASE_BEFORE, ApiId);
+    uint64_t Out = FakeInterceptor.getSavedApiTableContainer().add_fn(
+        Args.add.a, Args.add.b);
+    if (IsUserCallbackEnabled)
+      (*UserCallback)(&Args, API_EVT_PHASE_AFTER, ApiId);
+    if (IsInternalCallbackEnabled)
+      (*InternalCallback)(&Args, API_EVT_PHASE_AFTER, ApiId);
+    return Out;
+  }
+  return FakeInterceptor.getSavedApiTableContainer().add_fn(A, B);
+}
+
+} // namespace
+
+/// Number of API calls made by each thread per configuration
+static constexpr uint64_t NumIterations = 1 << 24;
+
+/// Calls the fake add API \c NumIterations times on each of \p NumThreads
+/// threads, and prints the average time spent per call
+/// \param ReplaceCallbacks if \c true, the user callback is replaced
+/// continuously by a separate thread while the API is being called
+static void runConfiguration(llvm::StringRef Name, unsigned int NumThreads,
+                             bool ReplaceCallbacks = false) {
+  std::atomic<bool> IsDone{false};
+  std::thread Replacer;
+  if (ReplaceCallbacks) {
+    Replacer = std::thread([&]() {
+      while (!IsDone.load(std::memory_order_relaxed)) {
+        Interceptor->setUserCallback(
+            [](FakeApiEvtArgs *, ApiEvtPhase, FakeApiEvtID) {});
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+  std::vector<std::thread> Callers;
+  std::vector<uint64_t> Results(NumThreads);
+  auto T1 = std::chrono::high_resolution_clock::now();
+  for (unsigned int T = 0; T < NumThreads; T++) {
+    Callers.emplace_back([&, T]() {
+      uint64_t Sum = 0;
+      for (uint64_t I = 0; I < NumIterations; I++)
+        Sum = FakeRuntimeTable.add_fn(Sum, I);
+      Results[T] = Sum;
+    });
+  }
+  for (auto &Caller : Callers)
+    Caller.join();
+  auto T2 = std::chrono::high_resolution_clock::now();
+  IsDone.store(true, std::memory_order_relaxed);
+  if (Replacer.joinable())
+    Replacer.join();
+  double NsPerCall =
+      static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(T2 - T1)
+              .count()) /
+      static_cast<double>(NumIterations);
+  llvm::outs() << llvm::formatv("{0,-40} {1,2} thread(s): {2,8:f2} ns/call\n",
+                                Name, NumThreads, NsPerCall);
+}
+
+int main() {
+  Interceptor = new FakeApiInterceptor();
+  LUTHIER_REPORT_FATAL_ON_ERROR(
+      Interceptor->captureApiTable(&FakeRuntimeTable));
+  // Install the wrapper the same way generated interceptors do
+  FakeRuntimeTable.add_fn = fakeAddWrapper;
+
+  unsigned int MaxThreads = std::max(1U, std::thread::hardware_concurrency());
+
+  for (unsigned int NumThreads = 1; NumThreads <= MaxThreads;
+       NumThreads *= 2) {
+    runConfiguration("Callbacks disabled", NumThreads);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor->enableUserCallback(FAKE_API_EVT_ID_sub));
+    runConfiguration("Callback enabled for another API", NumThreads);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor->enableUserCallback(FAKE_API_EVT_ID_add));
+    runConfiguration("No-op user callback", NumThreads);
+    runConfiguration("No-op user callback, being replaced", NumThreads,
+                     true);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor->enableInternalCallback(FAKE_API_EVT_ID_add));
+    runConfiguration("No-op user + internal callbacks", NumThreads);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor->disableInternalCallback(FAKE_API_EVT_ID_add));
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor->disableUserCallback(FAKE_API_EVT_ID_add));
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor->disableUserCallback(FAKE_API_EVT_ID_sub));
+  }
+
+  delete Interceptor;
+  return 0;
+}
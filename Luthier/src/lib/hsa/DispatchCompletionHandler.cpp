@@ -0,0 +1,176 @@
+//===-- DispatchCompletionHandler.cpp -------------------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the \c hsa::DispatchCompletionHandler Singleton.
+//===----------------------------------------------------------------------===//
+#include "hsa/DispatchCompletionHandler.hpp"
+#include "hsa/HsaRuntimeInterceptor.hpp"
+#include "luthier/hsa/HsaError.h"
+#include <hsa/amd_hsa_signal.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-hsa-dispatch-completion-handler"
+
+namespace luthier {
+template <>
+hsa::DispatchCompletionHandler
+    *Singleton<hsa::DispatchCompletionHandler>::Instance{nullptr};
+
+namespace hsa {
+
+DispatchCompletionHandler::~DispatchCompletionHandler() {
+  {
+    std::lock_guard Lock(WorkMutex);
+    IsShuttingDown = true;
+  }
+  WorkCV.notify_all();
+  if (Worker.joinable())
+    Worker.join();
+  // Pooled signals are not destroyed here, as the HSA runtime might have
+  // already been shut down by the time the handler is destroyed; They will
+  // be reclaimed by the runtime instead
+  Singleton::~Singleton();
+}
+
+llvm::Expected<hsa_signal_t> DispatchCompletionHandler::acquireSignal() {
+  {
+    std::lock_guard Lock(PoolMutex);
+    if (!FreeSignals.empty())
+      return FreeSignals.pop_back_val();
+  }
+  hsa_signal_t Signal;
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_HSA_SUCCESS_CHECK(
+      HsaRuntimeInterceptor::instance()
+          .getSavedApiTableContainer()
+          .amd_ext.hsa_amd_signal_create_fn(1, 0, nullptr, 0, &Signal)));
+  return Signal;
+}
+
+void DispatchCompletionHandler::releaseSignal(hsa_signal_t Signal) {
+  HsaRuntimeInterceptor::instance()
+      .getSavedApiTableContainer()
+      .core.hsa_signal_store_relaxed_fn(Signal, 1);
+  std::lock_guard Lock(PoolMutex);
+  FreeSignals.push_back(Signal);
+}
+
+/// Copies the dispatch start and end timestamps the packet processor wrote
+/// to \p From over to \p To, so that
+/// \c hsa_amd_profiling_get_dispatch_time returns them when queried with
+/// \p To
+/// \details The handle of an HSA signal is the address of its
+/// \c amd_signal_t, which is where the packet processor writes the
+/// timestamps of the dispatches it completes when profiling is enabled on
+/// their queue
+static void copyDispatchTimestamps(hsa_signal_t From, hsa_signal_t To) {
+  const auto *FromSignal = reinterpret_cast<const amd_signal_t *>(From.handle);
+  auto *ToSignal = reinterpret_cast<amd_signal_t *>(To.handle);
+  ToSignal->start_ts = FromSignal->start_ts;
+  ToSignal->end_ts = FromSignal->end_ts;
+}
+
+bool DispatchCompletionHandler::asyncSignalHandler(hsa_signal_value_t,
+                                                   void *Arg) {
+  std::unique_ptr<PendingDispatch> Dispatch(
+      static_cast<PendingDispatch *>(Arg));
+  // Forward the completion to the application's original signal right away,
+  // so that the application does not have to wait on the tool callback;
+  // The timestamps are copied first, as the release of the decrement makes
+  // them visible to whoever is waiting on the original signal
+  if (Dispatch->Packet.completion_signal.handle != 0) {
+    copyDispatchTimestamps(Dispatch->PooledSignal,
+                           Dispatch->Packet.completion_signal);
+    HsaRuntimeInterceptor::instance()
+        .getSavedApiTableContainer()
+        .core.hsa_signal_subtract_screlease_fn(
+            Dispatch->Packet.completion_signal, 1);
+  }
+  auto &Handler = instance();
+  {
+    std::lock_guard Lock(Handler.WorkMutex);
+    Handler.CompletedDispatches.push_back(std::move(Dispatch));
+  }
+  Handler.WorkCV.notify_one();
+  return false;
+}
+
+void DispatchCompletionHandler::processCompletedDispatches() {
+  while (true) {
+    std::unique_ptr<PendingDispatch> Dispatch;
+    {
+      std::unique_lock Lock(WorkMutex);
+      WorkCV.wait(Lock, [&]() {
+        return IsShuttingDown || !CompletedDispatches.empty();
+      });
+      if (CompletedDispatches.empty())
+        return;
+      Dispatch = std::move(CompletedDispatches.front());
+      CompletedDispatches.pop_front();
+    }
+    Dispatch->Callback(Dispatch->Packet);
+    releaseSignal(Dispatch->PooledSignal);
+    {
+      std::lock_guard Lock(WorkMutex);
+      NumPendingDispatches--;
+    }
+    DrainCV.notify_all();
+  }
+}
+
+llvm::Error DispatchCompletionHandler::registerCallback(
+    hsa_kernel_dispatch_packet_t &Packet, const callback_t &Callback) {
+  auto Signal = acquireSignal();
+  LUTHIER_RETURN_ON_ERROR(Signal.takeError());
+
+  auto Dispatch = std::make_unique<PendingDispatch>(
+      PendingDispatch{Packet, *Signal, Callback});
+  {
+    std::lock_guard Lock(WorkMutex);
+    if (!Worker.joinable())
+      Worker = std::thread([this]() { processCompletedDispatches(); });
+    NumPendingDispatches++;
+  }
+  // The packet processor decrements the completion signal by one once the
+  // kernel has finished executing
+  hsa_status_t Status =
+      HsaRuntimeInterceptor::instance()
+          .getSavedApiTableContainer()
+          .amd_ext.hsa_amd_signal_async_handler_fn(
+              *Signal, HSA_SIGNAL_CONDITION_LT, 1, asyncSignalHandler,
+              Dispatch.get());
+  if (Status != HSA_STATUS_SUCCESS) {
+    releaseSignal(*Signal);
+    {
+      std::lock_guard Lock(WorkMutex);
+      NumPendingDispatches--;
+    }
+    DrainCV.notify_all();
+    return LUTHIER_HSA_SUCCESS_CHECK(Status);
+  }
+  // Ownership of the pending dispatch is now with the async handler
+  (void)Dispatch.release();
+  Packet.completion_signal = *Signal;
+  return llvm::Error::success();
+}
+
+void DispatchCompletionHandler::drain() {
+  std::unique_lock Lock(WorkMutex);
+  DrainCV.wait(Lock, [&]() { return NumPendingDispatches == 0; });
+}
+
+} // namespace hsa
+} // namespace luthier
@@ -103,6 +103,10 @@ uint8_t hsa::LoadedCodeObjectSymbol::getBinding() const {
   return Symbol.getBinding();
 }
 
+llvm::object::ELFSymbolRef hsa::LoadedCodeObjectSymbol::getELFSymbol() const {
+  return Symbol;
+}
+
 llvm::Expected<std::unique_ptr<hsa::LoadedCodeObjectSymbol>>
 hsa::LoadedCodeObjectSymbol::fromLoadedAddress(
     luthier::address_t LoadedAddress) {
@@ -0,0 +1,371 @@
+//===-- MockHsaRuntime.cpp ------------------------------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the \c hsa::MockHsaRuntime.
+//===----------------------------------------------------------------------===//
+#include "MockHsaRuntime.hpp"
+#include <cstring>
+#include <hsa/amd_hsa_signal.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace luthier::hsa {
+
+namespace {
+
+/// A signal handler registered via \c hsa_amd_signal_async_handler
+struct MockAsyncHandler {
+  hsa_signal_condition_t Condition;
+  hsa_signal_value_t CompareValue;
+  hsa_amd_signal_handler Handler;
+  void *Arg;
+};
+
+/// Host-only signal; The handle of the \c hsa_signal_t is the address of
+/// its \c MockSignal
+struct MockSignal {
+  /// Stands in for the signal's \c amd_signal_t, which the handle of a real
+  /// signal points to; Must be the first field, as the dispatch completion
+  /// handler copies dispatch timestamps through it
+  amd_signal_t AmdSignal{};
+  std::atomic<hsa_signal_value_t> Value;
+  /// Protects \c Handlers
+  std::mutex HandlersMutex{};
+  llvm::SmallVector<MockAsyncHandler, 1> Handlers{};
+
+  explicit MockSignal(hsa_signal_value_t InitialValue) : Value(InitialValue) {}
+};
+
+/// Host-only queue; \c Queue must be the first field, as the address of the
+/// \c hsa_queue_t handed out to the application is also the address of its
+/// \c MockQueue
+struct MockQueue {
+  hsa_queue_t Queue{};
+  /// Stands in for the hardware ring buffer
+  std::vector<AqlPacket> RingBuffer;
+  /// Index of the next packet written to \c RingBuffer
+  uint64_t WriteIndex{0};
+  /// Index of the next packet submitted by the application
+  uint64_t UserWriteIndex{0};
+  /// Intercept handler registered with this queue, if any
+  hsa_amd_queue_intercept_handler InterceptHandler{nullptr};
+  void *InterceptHandlerData{nullptr};
+
+  explicit MockQueue(uint32_t Size) : RingBuffer(Size) {}
+};
+
+/// The currently active mock runtime
+MockHsaRuntime *Runtime{nullptr};
+
+/// Protects \c Queues
+std::mutex QueuesMutex;
+
+/// Queues created by the mock runtime which have not been destroyed yet
+llvm::DenseMap<hsa_queue_t *, std::unique_ptr<MockQueue>> Queues;
+
+/// The queue whose intercept handler is currently running on this thread;
+/// Used by \c writeToInterceptedQueue, as the packet writer passed to
+/// intercept handlers does not carry any context
+thread_local MockQueue *QueueBeingIntercepted{nullptr};
+
+MockSignal &getMockSignal(hsa_signal_t Signal) {
+  return *reinterpret_cast<MockSignal *>(Signal.handle);
+}
+
+bool isConditionSatisfied(hsa_signal_value_t Value,
+                          hsa_signal_condition_t Condition,
+                          hsa_signal_value_t CompareValue) {
+  switch (Condition) {
+  case HSA_SIGNAL_CONDITION_EQ:
+    return Value == CompareValue;
+  case HSA_SIGNAL_CONDITION_NE:
+    return Value != CompareValue;
+  case HSA_SIGNAL_CONDITION_LT:
+    return Value < CompareValue;
+  case HSA_SIGNAL_CONDITION_GTE:
+    return Value >= CompareValue;
+  }
+  llvm_unreachable("Invalid HSA signal condition");
+}
+
+/// Invokes the async handlers of \p Signal whose conditions are satisfied
+/// by its current value, on the calling thread; Handlers returning \c true are
+/// re-armed
+void runAsyncHandlers(MockSignal &Signal) {
+  llvm::SmallVector<MockAsyncHandler, 1> ReadyHandlers;
+  {
+    std::lock_guard Lock(Signal.HandlersMutex);
+    if (Signal.Handlers.empty())
+      return;
+    hsa_signal_value_t Value = Signal.Value.load(std::memory_order_acquire);
+    llvm::erase_if(Signal.Handlers, [&](const MockAsyncHandler &H) {
+      if (!isConditionSatisfied(Value, H.Condition, H.CompareValue))
+        return false;
+      ReadyHandlers.push_back(H);
+      return true;
+    });
+  }
+  for (const auto &H : ReadyHandlers) {
+    if (H.Handler(Signal.Value.load(std::memory_order_acquire), H.Arg)) {
+      std::lock_guard Lock(Signal.HandlersMutex);
+      Signal.Handlers.push_back(H);
+    }
+  }
+}
+
+/// Writes \p Packets to the ring buffer of \p Queue, and simulates the
+/// completion of the kernel dispatches among them
+void writePackets(MockQueue &Queue, const AqlPacket *Packets,
+                  uint64_t PktCount) {
+  for (uint64_t I = 0; I < PktCount; I++) {
+    Queue.RingBuffer[Queue.WriteIndex % Queue.RingBuffer.size()] = Packets[I];
+    Queue.WriteIndex++;
+  }
+  Runtime->Calls.PacketsWritten.fetch_add(PktCount, std::memory_order_relaxed);
+  // The packet processor decrements the completion signal of each dispatch
+  // once it has finished executing
+  for (uint64_t I = 0; I < PktCount; I++) {
+    const auto *Dispatch = Packets[I].asKernelDispatch();
+    if (!Dispatch)
+      continue;
+    Runtime->Calls.DispatchesCompleted.fetch_add(1, std::memory_order_relaxed);
+    if (Dispatch->completion_signal.handle == 0)
+      continue;
+    auto &Signal = getMockSignal(Dispatch->completion_signal);
+    Signal.Value.fetch_sub(1, std::memory_order_release);
+    runAsyncHandlers(Signal);
+  }
+}
+
+void writeToInterceptedQueue(const void *Packets, uint64_t PktCount) {
+  writePackets(*QueueBeingIntercepted, static_cast<const AqlPacket *>(Packets),
+               PktCount);
+}
+
+//===----------------------------------------------------------------------===//
+// Mocked HSA API functions
+//===----------------------------------------------------------------------===//
+
+hsa_status_t mockSystemGetMajorExtensionTable(uint16_t Extension, uint16_t,
+                                              size_t TableLength, void *Table) {
+  Runtime->Calls.SystemGetMajorExtensionTable.fetch_add(
+      1, std::memory_order_relaxed);
+  if (Extension != HSA_EXTENSION_AMD_LOADER)
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  // The loader API is not used by the interception layer
+  std::memset(Table, 0, TableLength);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t mockSignalCreate(hsa_signal_value_t InitialValue, uint32_t,
+                              const hsa_agent_t *, hsa_signal_t *Signal) {
+  Runtime->Calls.SignalCreate.fetch_add(1, std::memory_order_relaxed);
+  Signal->handle = reinterpret_cast<uint64_t>(new MockSignal(InitialValue));
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t mockAmdSignalCreate(hsa_signal_value_t InitialValue,
+                                 uint32_t NumConsumers,
+                                 const hsa_agent_t *Consumers, uint64_t,
+                                 hsa_signal_t *Signal) {
+  return mockSignalCreate(InitialValue, NumConsumers, Consumers, Signal);
+}
+
+hsa_status_t mockSignalDestroy(hsa_signal_t Signal) {
+  Runtime->Calls.SignalDestroy.fetch_add(1, std::memory_order_relaxed);
+  delete &getMockSignal(Signal);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_signal_value_t mockSignalLoad(hsa_signal_t Signal) {
+  Runtime->Calls.SignalLoad.fetch_add(1, std::memory_order_relaxed);
+  return getMockSignal(Signal).Value.load(std::memory_order_acquire);
+}
+
+void mockSignalStore(hsa_signal_t Signal, hsa_signal_value_t Value) {
+  Runtime->Calls.SignalStore.fetch_add(1, std::memory_order_relaxed);
+  auto &MockSig = getMockSignal(Signal);
+  MockSig.Value.store(Value, std::memory_order_release);
+  runAsyncHandlers(MockSig);
+}
+
+void mockSignalSubtract(hsa_signal_t Signal, hsa_signal_value_t Value) {
+  Runtime->Calls.SignalSubtract.fetch_add(1, std::memory_order_relaxed);
+  auto &MockSig = getMockSignal(Signal);
+  MockSig.Value.fetch_sub(Value, std::memory_order_release);
+  runAsyncHandlers(MockSig);
+}
+
+hsa_signal_value_t mockSignalWait(hsa_signal_t Signal,
+                                  hsa_signal_condition_t Condition,
+                                  hsa_signal_value_t CompareValue, uint64_t,
+                                  hsa_wait_state_t) {
+  Runtime->Calls.SignalWait.fetch_add(1, std::memory_order_relaxed);
+  auto &MockSig = getMockSignal(Signal);
+  while (true) {
+    hsa_signal_value_t Value = MockSig.Value.load(std::memory_order_acquire);
+    if (isConditionSatisfied(Value, Condition, CompareValue))
+      return Value;
+    std::this_thread::yield();
+  }
+}
+
+hsa_status_t mockAmdSignalAsyncHandler(hsa_signal_t Signal,
+                                       hsa_signal_condition_t Condition,
+                                       hsa_signal_value_t CompareValue,
+                                       hsa_amd_signal_handler Handler,
+                                       void *Arg) {
+  Runtime->Calls.SignalAsyncHandler.fetch_add(1, std::memory_order_relaxed);
+  auto &MockSig = getMockSignal(Signal);
+  {
+    std::lock_guard Lock(MockSig.HandlersMutex);
+    MockSig.Handlers.push_back({Condition, CompareValue, Handler, Arg});
+  }
+  // The condition might already be satisfied
+  runAsyncHandlers(MockSig);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_queue_t *createMockQueue(uint32_t Size, hsa_queue_type32_t Type) {
+  auto Queue = std::make_unique<MockQueue>(Size);
+  Queue->Queue.type = Type;
+  Queue->Queue.features = HSA_QUEUE_FEATURE_KERNEL_DISPATCH;
+  Queue->Queue.base_address = Queue->RingBuffer.data();
+  Queue->Queue.size = Size;
+  (void)mockSignalCreate(0, 0, nullptr, &Queue->Queue.doorbell_signal);
+  std::lock_guard Lock(QueuesMutex);
+  Queue->Queue.id = Queues.size();
+  auto *Out = &Queue->Queue;
+  Queues.insert({Out, std::move(Queue)});
+  return Out;
+}
+
+hsa_status_t mockQueueCreate(hsa_agent_t, uint32_t Size,
+                             hsa_queue_type32_t Type,
+                             void (*)(hsa_status_t, hsa_queue_t *, void *),
+                             void *, uint32_t, uint32_t, hsa_queue_t **Queue) {
+  Runtime->Calls.QueueCreate.fetch_add(1, std::memory_order_relaxed);
+  *Queue = createMockQueue(Size, Type);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t mockAmdQueueInterceptCreate(
+    hsa_agent_t, uint32_t Size, hsa_queue_type32_t Type,
+    void (*)(hsa_status_t, hsa_queue_t *, void *), void *, uint32_t, uint32_t,
+    hsa_queue_t **Queue) {
+  Runtime->Calls.InterceptQueueCreate.fetch_add(1, std::memory_order_relaxed);
+  *Queue = createMockQueue(Size, Type);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t
+mockAmdQueueInterceptRegister(hsa_queue_t *Queue,
+                              hsa_amd_queue_intercept_handler Handler,
+                              void *UserData) {
+  Runtime->Calls.InterceptQueueRegister.fetch_add(1,
+                                                  std::memory_order_relaxed);
+  auto *MockQ = reinterpret_cast<MockQueue *>(Queue);
+  // Chaining multiple intercept handlers is not supported by the mock
+  if (MockQ->InterceptHandler != nullptr)
+    return HSA_STATUS_ERROR_INVALID_QUEUE;
+  MockQ->InterceptHandler = Handler;
+  MockQ->InterceptHandlerData = UserData;
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t mockQueueDestroy(hsa_queue_t *Queue) {
+  Runtime->Calls.QueueDestroy.fetch_add(1, std::memory_order_relaxed);
+  std::unique_ptr<MockQueue> MockQ;
+  {
+    std::lock_guard Lock(QueuesMutex);
+    auto It = Queues.find(Queue);
+    if (It == Queues.end())
+      return HSA_STATUS_ERROR_INVALID_QUEUE;
+    MockQ = std::move(It->second);
+    Queues.erase(It);
+  }
+  delete &getMockSignal(MockQ->Queue.doorbell_signal);
+  return HSA_STATUS_SUCCESS;
+}
+
+} // namespace
+
+MockHsaRuntime::MockHsaRuntime() {
+  if (Runtime != nullptr)
+    llvm::report_fatal_error("Only one mock HSA runtime can be active.");
+  Runtime = this;
+  Tables.root.core_ = &Tables.core;
+  Tables.root.amd_ext_ = &Tables.amd_ext;
+  Tables.root.finalizer_ext_ = &Tables.finalizer_ext;
+  Tables.root.image_ext_ = &Tables.image_ext;
+
+  auto &Core = Tables.core;
+  Core.hsa_system_get_major_extension_table_fn =
+      mockSystemGetMajorExtensionTable;
+  Core.hsa_queue_create_fn = mockQueueCreate;
+  Core.hsa_queue_destroy_fn = mockQueueDestroy;
+  Core.hsa_signal_create_fn = mockSignalCreate;
+  Core.hsa_signal_destroy_fn = mockSignalDestroy;
+  Core.hsa_signal_load_relaxed_fn = mockSignalLoad;
+  Core.hsa_signal_load_scacquire_fn = mockSignalLoad;
+  Core.hsa_signal_store_relaxed_fn = mockSignalStore;
+  Core.hsa_signal_store_screlease_fn = mockSignalStore;
+  Core.hsa_signal_subtract_relaxed_fn = mockSignalSubtract;
+  Core.hsa_signal_subtract_screlease_fn = mockSignalSubtract;
+  Core.hsa_signal_wait_relaxed_fn = mockSignalWait;
+  Core.hsa_signal_wait_scacquire_fn = mockSignalWait;
+
+  auto &AmdExt = Tables.amd_ext;
+  AmdExt.hsa_amd_signal_create_fn = mockAmdSignalCreate;
+  AmdExt.hsa_amd_signal_async_handler_fn = mockAmdSignalAsyncHandler;
+  AmdExt.hsa_amd_queue_intercept_create_fn = mockAmdQueueInterceptCreate;
+  AmdExt.hsa_amd_queue_intercept_register_fn = mockAmdQueueInterceptRegister;
+}
+
+MockHsaRuntime::~MockHsaRuntime() {
+  {
+    std::lock_guard Lock(QueuesMutex);
+    for (auto &[Queue, MockQ] : Queues)
+      delete &getMockSignal(MockQ->Queue.doorbell_signal);
+    Queues.clear();
+  }
+  Runtime = nullptr;
+}
+
+void MockHsaRuntime::submitPackets(hsa_queue_t *Queue,
+                                   llvm::ArrayRef<AqlPacket> Packets) {
+  auto *MockQ = reinterpret_cast<MockQueue *>(Queue);
+  uint64_t UserPktIndex = MockQ->UserWriteIndex;
+  MockQ->UserWriteIndex += Packets.size();
+  if (MockQ->InterceptHandler == nullptr) {
+    writePackets(*MockQ, Packets.data(), Packets.size());
+    return;
+  }
+  QueueBeingIntercepted = MockQ;
+  MockQ->InterceptHandler(Packets.data(), Packets.size(), UserPktIndex,
+                          MockQ->InterceptHandlerData,
+                          writeToInterceptedQueue);
+  QueueBeingIntercepted = nullptr;
+}
+
+} // namespace luthier::hsa
@@ -0,0 +1,108 @@
+//===-- MockHsaRuntime.hpp - CPU-only HSA Runtime Stand-in ----------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the \c hsa::MockHsaRuntime, a stand-in for the ROCm
+/// runtime's HSA API table which lets the \c hsa::HsaRuntimeInterceptor,
+/// its generated API wrappers, and its packet submission path be exercised
+/// on machines without an AMD GPU.
+//===----------------------------------------------------------------------===//
+#ifndef LUTHIER_HSA_BENCHMARK_MOCK_HSA_RUNTIME_HPP
+#define LUTHIER_HSA_BENCHMARK_MOCK_HSA_RUNTIME_HPP
+#include <atomic>
+#include <hsa/hsa_api_trace.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <luthier/hsa/AqlPacket.h>
+
+namespace luthier::hsa {
+
+/// \brief Mock of the HSA runtime, implementing the subset of the HSA API
+/// table used by Luthier's HSA interception layer entirely on the host
+/// \details The mock provides an \c HsaApiTable that can be passed to
+/// \c HsaRuntimeInterceptor::captureApiTable in place of the one handed out by
+/// rocprofiler-sdk. Signals are plain host atomics. Queues are host ring
+/// buffers; Regular queues and intercept queues are both supported, and
+/// \c submitPackets acts as the doorbell of a queue, running the packets
+/// through the queue's intercept handler (if any) before they reach the ring
+/// buffer. Kernel dispatches "complete" as soon as they are written to the
+/// ring buffer, by decrementing their completion signal, which in turn
+/// invokes any handlers registered via \c hsa_amd_signal_async_handler.
+/// Every call to the mocked functions is counted in \c MockHsaRuntime::Calls,
+/// so that the interception layer can be checked for forwarding each call
+/// exactly once. \n
+/// Unlike the real runtime, async signal handlers run on the thread that
+/// modified the signal instead of a dedicated runtime thread. Mocked functions
+/// without an explicit implementation are left as \c nullptr in the API
+/// table. Only a single instance of the mock can be alive at any given time
+class MockHsaRuntime {
+public:
+  /// Number of calls made to each mocked API function, or the number of
+  /// simulated device events
+  struct CallCounters {
+    std::atomic<uint64_t> SystemGetMajorExtensionTable{0};
+    std::atomic<uint64_t> QueueCreate{0};
+    std::atomic<uint64_t> QueueDestroy{0};
+    std::atomic<uint64_t> InterceptQueueCreate{0};
+    std::atomic<uint64_t> InterceptQueueRegister{0};
+    std::atomic<uint64_t> SignalCreate{0};
+    std::atomic<uint64_t> SignalDestroy{0};
+    std::atomic<uint64_t> SignalLoad{0};
+    std::atomic<uint64_t> SignalStore{0};
+    std::atomic<uint64_t> SignalSubtract{0};
+    std::atomic<uint64_t> SignalWait{0};
+    std::atomic<uint64_t> SignalAsyncHandler{0};
+    /// Number of packets written to the ring buffer of any queue
+    std::atomic<uint64_t> PacketsWritten{0};
+    /// Number of kernel dispatch packets simulated to completion
+    std::atomic<uint64_t> DispatchesCompleted{0};
+  };
+
+  CallCounters Calls{};
+
+private:
+  /// Holds the mocked API tables; The root \c HsaApiTable points to the
+  /// tables inside the container
+  HsaApiTableContainer Tables{};
+
+public:
+  MockHsaRuntime();
+
+  ~MockHsaRuntime();
+
+  MockHsaRuntime(const MockHsaRuntime &) = delete;
+  MockHsaRuntime &operator=(const MockHsaRuntime &) = delete;
+
+  /// \return the mocked HSA API table, to be captured by the
+  /// \c HsaRuntimeInterceptor
+  HsaApiTable &getApiTable() { return Tables.root; }
+
+  /// \return a fake agent to create queues on
+  static hsa_agent_t getAgent() { return {0x1000}; }
+
+  /// Rings the doorbell of \p Queue with \p Packets; If \p Queue is an
+  /// intercept queue, the packets are handed to its registered intercept
+  /// handler, otherwise they are written directly to its ring buffer
+  /// \param Queue a queue created by either the mock's \c hsa_queue_create
+  /// or \c hsa_amd_queue_intercept_create
+  /// \param Packets the packets submitted by the "application"
+  /// \note Packets must not be submitted to the same queue from multiple
+  /// threads at the same time
+  void submitPackets(hsa_queue_t *Queue, llvm::ArrayRef<AqlPacket> Packets);
+};
+
+} // namespace luthier::hsa
+
+#endif
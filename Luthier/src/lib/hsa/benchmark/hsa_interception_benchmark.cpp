@@ -0,0 +1,271 @@
+//===-- hsa_interception_benchmark.cpp - HSA Interception Overhead Bench --===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements a benchmark of the end-to-end overhead of Luthier's
+/// HSA interception layer, on top of the \c hsa::MockHsaRuntime. The
+/// \c hsa::HsaRuntimeInterceptor captures the mock's API table the same way
+/// it captures the real one, after which the per-call overhead of the
+/// generated API wrappers and the per-dispatch overhead of the queues created
+/// through the intercepted \c hsa_queue_create are measured under different
+/// callback configurations. Each configuration also checks that every call
+/// and every packet reached the mock runtime exactly once.
+//===----------------------------------------------------------------------===//
+#include "MockHsaRuntime.hpp"
+#include "hip/HipRuntimeApiInterceptor.hpp"
+#include "hsa/DispatchCompletionHandler.hpp"
+#include "hsa/HsaRuntimeInterceptor.hpp"
+#include "luthier/hsa/HsaError.h"
+#include <chrono>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace luthier {
+
+// Tool callbacks required by the tooling library
+
+void atToolInit(ApiEvtPhase) {}
+
+void atToolFini(ApiEvtPhase) {}
+
+llvm::StringRef getToolName() { return "HSA interception benchmark"; }
+
+} // namespace luthier
+
+using namespace luthier;
+
+/// Number of API calls made per API configuration
+static constexpr uint64_t NumApiIterations = 1 << 22;
+
+/// Number of packet batches submitted per dispatch configuration
+static constexpr uint64_t NumDispatchIterations = 1 << 20;
+
+/// Size of the queues created by the benchmark
+static constexpr uint32_t QueueSize = 1024;
+
+/// Reports a fatal error if \p Actual does not match \p Expected
+static void checkCount(llvm::StringRef What, uint64_t Actual,
+                       uint64_t Expected) {
+  if (Actual != Expected)
+    llvm::report_fatal_error(
+        llvm::formatv("Expected {0} {1}, got {2} instead.", Expected, What,
+                      Actual)
+            .str());
+}
+
+static void printResult(llvm::StringRef Name, std::chrono::nanoseconds Time,
+                        uint64_t NumEvents, llvm::StringRef Unit) {
+  double NsPerEvent = static_cast<double>(Time.count()) /
+                      static_cast<double>(NumEvents);
+  llvm::outs() << llvm::formatv("{0,-60}: {1,8:f2} ns/{2}\n", Name, NsPerEvent,
+                                Unit);
+}
+
+/// Calls \c hsa_signal_load_relaxed through the mock's API table
+/// \c NumApiIterations times and prints the average time spent per call
+static void runApiConfiguration(llvm::StringRef Name, hsa::MockHsaRuntime &Mock,
+                                hsa_signal_t Signal) {
+  auto &Core = *Mock.getApiTable().core_;
+  uint64_t NumLoadsBefore = Mock.Calls.SignalLoad.load();
+  hsa_signal_value_t Sum = 0;
+  auto T1 = std::chrono::high_resolution_clock::now();
+  for (uint64_t I = 0; I < NumApiIterations; I++) {
+    Sum += Core.hsa_signal_load_relaxed_fn(Signal);
+  }
+  auto T2 = std::chrono::high_resolution_clock::now();
+  checkCount("signal loads", Mock.Calls.SignalLoad.load() - NumLoadsBefore,
+             NumApiIterations);
+  checkCount("loaded signal value sum", Sum, NumApiIterations);
+  printResult(Name, T2 - T1, NumApiIterations, "call");
+}
+
+/// Submits \c NumDispatchIterations batches of \p BatchSize kernel dispatch
+/// packets to \p Queue and prints the average time spent per dispatch
+static void runDispatchConfiguration(llvm::StringRef Name,
+                                     hsa::MockHsaRuntime &Mock,
+                                     hsa_queue_t *Queue,
+                                     unsigned int BatchSize) {
+  llvm::SmallVector<hsa::AqlPacket, 4> Batch(BatchSize);
+  for (auto &Packet : Batch) {
+    Packet.Packet.Header = HSA_PACKET_TYPE_KERNEL_DISPATCH
+                           << HSA_PACKET_HEADER_TYPE;
+  }
+  uint64_t NumWrittenBefore = Mock.Calls.PacketsWritten.load();
+  uint64_t NumCompletedBefore = Mock.Calls.DispatchesCompleted.load();
+  auto T1 = std::chrono::high_resolution_clock::now();
+  for (uint64_t I = 0; I < NumDispatchIterations; I++) {
+    Mock.submitPackets(Queue, Batch);
+  }
+  // Wait for any asynchronous completion callbacks to finish
+  hsa::DispatchCompletionHandler::instance().drain();
+  auto T2 = std::chrono::high_resolution_clock::now();
+  uint64_t NumDispatches = NumDispatchIterations * BatchSize;
+  checkCount("packets written",
+             Mock.Calls.PacketsWritten.load() - NumWrittenBefore,
+             NumDispatches);
+  checkCount("dispatches completed",
+             Mock.Calls.DispatchesCompleted.load() - NumCompletedBefore,
+             NumDispatches);
+  printResult(llvm::formatv("{0} (batch size {1})", Name, BatchSize).str(),
+              T2 - T1, NumDispatches, "dispatch");
+}
+
+/// Creates a queue through the (intercepted) \c hsa_queue_create of the mock
+static hsa_queue_t *createQueue(hsa::MockHsaRuntime &Mock) {
+  hsa_queue_t *Queue;
+  LUTHIER_REPORT_FATAL_ON_ERROR(LUTHIER_HSA_SUCCESS_CHECK(
+      Mock.getApiTable().core_->hsa_queue_create_fn(
+          hsa::MockHsaRuntime::getAgent(), QueueSize, HSA_QUEUE_TYPE_SINGLE,
+          nullptr, nullptr, 0, 0, &Queue)));
+  return Queue;
+}
+
+static void benchmarkApiInterception(hsa::MockHsaRuntime &Mock,
+                                     hsa::HsaRuntimeInterceptor &Interceptor) {
+  constexpr auto SignalLoad = hsa::HSA_API_EVT_ID_hsa_signal_load_relaxed;
+  hsa_signal_t Signal;
+  LUTHIER_REPORT_FATAL_ON_ERROR(
+      LUTHIER_HSA_SUCCESS_CHECK(Mock.getApiTable().core_->hsa_signal_create_fn(
+          1, 0, nullptr, &Signal)));
+
+  runApiConfiguration("API: wrapper not installed", Mock, Signal);
+
+  LUTHIER_REPORT_FATAL_ON_ERROR(Interceptor.enableUserCallback(SignalLoad));
+  runApiConfiguration("API: no-op user callback", Mock, Signal);
+
+  LUTHIER_REPORT_FATAL_ON_ERROR(Interceptor.enableInternalCallback(SignalLoad));
+  runApiConfiguration("API: no-op user + internal callbacks", Mock, Signal);
+
+  LUTHIER_REPORT_FATAL_ON_ERROR(Interceptor.disableUserCallback(SignalLoad));
+  runApiConfiguration("API: no-op internal callback", Mock, Signal);
+
+  // After the first wrapper call the API table is frozen, so the wrapper
+  // remains installed even with both callbacks disabled
+  LUTHIER_REPORT_FATAL_ON_ERROR(
+      Interceptor.disableInternalCallback(SignalLoad));
+  runApiConfiguration("API: wrapper installed, callbacks disabled", Mock,
+                      Signal);
+
+  LUTHIER_REPORT_FATAL_ON_ERROR(LUTHIER_HSA_SUCCESS_CHECK(
+      Mock.getApiTable().core_->hsa_signal_destroy_fn(Signal)));
+}
+
+static void
+benchmarkDispatchInterception(hsa::MockHsaRuntime &Mock,
+                              hsa::HsaRuntimeInterceptor &Interceptor) {
+  constexpr auto PacketSubmit = hsa::HSA_API_EVT_ID_hsa_queue_packet_submit;
+
+  // With no packet submit callbacks enabled, a regular queue is created
+  uint64_t NumInterceptQueuesBefore = Mock.Calls.InterceptQueueCreate.load();
+  hsa_queue_t *RegularQueue = createQueue(Mock);
+  checkCount("intercept queues created",
+             Mock.Calls.InterceptQueueCreate.load() - NumInterceptQueuesBefore,
+             0);
+
+  LUTHIER_REPORT_FATAL_ON_ERROR(Interceptor.enableUserCallback(PacketSubmit));
+  hsa_queue_t *InterceptQueue = createQueue(Mock);
+  checkCount("intercept queues created",
+             Mock.Calls.InterceptQueueCreate.load() - NumInterceptQueuesBefore,
+             1);
+
+  for (unsigned int BatchSize : {1, 4}) {
+    runDispatchConfiguration("Dispatch: regular queue", Mock, RegularQueue,
+                             BatchSize);
+
+    Interceptor.setPacketSubmitPassThrough(true);
+    runDispatchConfiguration("Dispatch: intercept queue, pass-through", Mock,
+                             InterceptQueue, BatchSize);
+    Interceptor.setPacketSubmitPassThrough(false);
+
+    Interceptor.setUserCallback(
+        [](hsa::ApiEvtArgs *, ApiEvtPhase, hsa::ApiEvtID) {});
+    runDispatchConfiguration("Dispatch: no-op user callback", Mock,
+                             InterceptQueue, BatchSize);
+
+    Interceptor.setUserCallback(
+        [](hsa::ApiEvtArgs *Args, ApiEvtPhase Phase, hsa::ApiEvtID) {
+          if (Phase != API_EVT_PHASE_BEFORE)
+            return;
+          for (auto &Packet : *Args->hsa_queue_packet_submit.packets) {
+            if (auto *Dispatch = Packet.asKernelDispatch())
+              Dispatch->kernel_object++;
+          }
+        });
+    runDispatchConfiguration("Dispatch: packet-modifying user callback", Mock,
+                             InterceptQueue, BatchSize);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor.enableInternalCallback(PacketSubmit));
+    Interceptor.setInternalCallback(
+        [](hsa::ApiEvtArgs *, ApiEvtPhase, hsa::ApiEvtID) {});
+    runDispatchConfiguration("Dispatch: modifying user + no-op internal "
+                             "callbacks",
+                             Mock, InterceptQueue, BatchSize);
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        Interceptor.disableInternalCallback(PacketSubmit));
+
+    uint64_t NumCallbacks = 0;
+    Interceptor.setUserCallback(
+        [&](hsa::ApiEvtArgs *Args, ApiEvtPhase Phase, hsa::ApiEvtID) {
+          if (Phase != API_EVT_PHASE_BEFORE)
+            return;
+          for (auto &Packet : *Args->hsa_queue_packet_submit.packets) {
+            if (auto *Dispatch = Packet.asKernelDispatch())
+              LUTHIER_REPORT_FATAL_ON_ERROR(
+                  hsa::DispatchCompletionHandler::instance().registerCallback(
+                      *Dispatch,
+                      [&](const hsa_kernel_dispatch_packet_t &) {
+                        NumCallbacks++;
+                      }));
+          }
+        });
+    runDispatchConfiguration("Dispatch: async completion callback", Mock,
+                             InterceptQueue, BatchSize);
+    checkCount("completion callbacks", NumCallbacks,
+               NumDispatchIterations * BatchSize);
+  }
+
+  LUTHIER_REPORT_FATAL_ON_ERROR(Interceptor.disableUserCallback(PacketSubmit));
+  Interceptor.setUserCallback(
+      [](hsa::ApiEvtArgs *, ApiEvtPhase, hsa::ApiEvtID) {});
+
+  auto &Core = *Mock.getApiTable().core_;
+  LUTHIER_REPORT_FATAL_ON_ERROR(
+      LUTHIER_HSA_SUCCESS_CHECK(Core.hsa_queue_destroy_fn(InterceptQueue)));
+  LUTHIER_REPORT_FATAL_ON_ERROR(
+      LUTHIER_HSA_SUCCESS_CHECK(Core.hsa_queue_destroy_fn(RegularQueue)));
+}
+
+int main() {
+  hsa::MockHsaRuntime Mock;
+  auto *HipInterceptor = new hip::HipRuntimeApiInterceptor();
+  auto *HsaInterceptor = new hsa::HsaRuntimeInterceptor();
+  auto *CompletionHandler = new hsa::DispatchCompletionHandler();
+  // Pretend the HIP API table has been captured so that the packet submit
+  // interceptor does not attempt to initialize the HIP runtime
+  static HipDispatchTable MockHipTable{};
+  LUTHIER_REPORT_FATAL_ON_ERROR(HipInterceptor->captureApiTable(&MockHipTable));
+  LUTHIER_REPORT_FATAL_ON_ERROR(
+      HsaInterceptor->captureApiTable(&Mock.getApiTable()));
+
+  benchmarkApiInterception(Mock, *HsaInterceptor);
+  benchmarkDispatchInterception(Mock, *HsaInterceptor);
+
+  delete CompletionHandler;
+  delete HsaInterceptor;
+  delete HipInterceptor;
+  return 0;
+}
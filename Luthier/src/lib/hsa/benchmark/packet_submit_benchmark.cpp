@@ -0,0 +1,135 @@
+//===-- packet_submit_benchmark.cpp - Packet Submit Interception Bench ----===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements a micro-benchmark measuring the dispatch rate of
+/// \c hsa::queueSubmitWriteInterceptor against a mocked packet writer, under
+/// different packet submit callback configurations. It does not require
+/// a GPU or the HSA runtime to be initialized.
+//===----------------------------------------------------------------------===//
+#include "hip/HipRuntimeApiInterceptor.hpp"
+#include "hsa/HsaRuntimeInterceptor.hpp"
+#include <array>
+#include <chrono>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace luthier {
+
+// Tool callbacks required by the tooling library
+
+void atToolInit(ApiEvtPhase) {}
+
+void atToolFini(ApiEvtPhase) {}
+
+llvm::StringRef getToolName() { return "packet submit benchmark"; }
+
+} // namespace luthier
+
+using namespace luthier;
+
+/// Number of packet batches submitted per configuration
+static constexpr uint64_t NumIterations = 1 << 22;
+
+/// Ring buffer standing in for the hardware queue
+static std::array<hsa::AqlPacket, 1024> MockHardwareQueue{};
+
+/// Write index of the \c MockHardwareQueue
+static uint64_t MockWriteIndex{0};
+
+/// Mocked packet writer, copying the packets to the \c MockHardwareQueue
+static void mockPacketWriter(const void *Packets, uint64_t PktCount) {
+  const auto *Pkts = static_cast<const hsa::AqlPacket *>(Packets);
+  for (uint64_t I = 0; I < PktCount; I++) {
+    MockHardwareQueue[MockWriteIndex % MockHardwareQueue.size()] = Pkts[I];
+    MockWriteIndex++;
+  }
+}
+
+/// Submits \c NumIterations batches of \p BatchSize kernel dispatch packets
+/// to the interceptor and prints the average time spent per dispatch
+static void runConfiguration(llvm::StringRef Name, unsigned int BatchSize) {
+  llvm::SmallVector<hsa::AqlPacket, 4> Batch(BatchSize);
+  for (auto &Packet : Batch) {
+    Packet.Packet.Header = HSA_PACKET_TYPE_KERNEL_DISPATCH
+                           << HSA_PACKET_HEADER_TYPE;
+  }
+  auto T1 = std::chrono::high_resolution_clock::now();
+  for (uint64_t I = 0; I < NumIterations; I++) {
+    hsa::queueSubmitWriteInterceptor(Batch.data(), Batch.size(),
+                                     I * BatchSize, nullptr, mockPacketWriter);
+  }
+  auto T2 = std::chrono::high_resolution_clock::now();
+  double NsPerDispatch =
+      static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(T2 - T1)
+              .count()) /
+      static_cast<double>(NumIterations * BatchSize);
+  llvm::outs() << llvm::formatv("{0,-40} batch size {1}: {2,8:f2} ns/dispatch, "
+                                "{3,8:f2} M dispatches/s\n",
+                                Name, BatchSize, NsPerDispatch,
+                                1e3 / NsPerDispatch);
+}
+
+int main() {
+  auto *HipInterceptor = new hip::HipRuntimeApiInterceptor();
+  auto *HsaInterceptor = new hsa::HsaRuntimeInterceptor();
+  // Pretend the HIP API table has been captured so that the interceptor does
+  // not attempt to initialize the HIP runtime
+  static HipDispatchTable MockHipTable{};
+  LUTHIER_REPORT_FATAL_ON_ERROR(HipInterceptor->captureApiTable(&MockHipTable));
+  // Enabling packet submit callbacks does not modify the HSA API table, so
+  // the interceptor does not need a real one to be captured
+  HsaInterceptor->Status = hsa::HsaRuntimeInterceptor::API_TABLE_CAPTURED;
+
+  constexpr auto PacketSubmit = hsa::HSA_API_EVT_ID_hsa_queue_packet_submit;
+
+  for (unsigned int BatchSize : {1, 4}) {
+    runConfiguration("No callbacks", BatchSize);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        HsaInterceptor->enableUserCallback(PacketSubmit));
+    HsaInterceptor->setUserCallback(
+        [](hsa::ApiEvtArgs *, ApiEvtPhase, hsa::ApiEvtID) {});
+    runConfiguration("No-op user callback", BatchSize);
+
+    HsaInterceptor->setUserCallback(
+        [](hsa::ApiEvtArgs *Args, ApiEvtPhase Phase, hsa::ApiEvtID) {
+          if (Phase != API_EVT_PHASE_BEFORE)
+            return;
+          for (auto &Packet : *Args->hsa_queue_packet_submit.packets) {
+            if (auto *Dispatch = Packet.asKernelDispatch())
+              Dispatch->kernel_object++;
+          }
+        });
+    runConfiguration("Packet-modifying user callback", BatchSize);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        HsaInterceptor->enableInternalCallback(PacketSubmit));
+    HsaInterceptor->setInternalCallback(
+        [](hsa::ApiEvtArgs *, ApiEvtPhase, hsa::ApiEvtID) {});
+    runConfiguration("Modifying user + no-op internal callback", BatchSize);
+
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        HsaInterceptor->disableInternalCallback(PacketSubmit));
+    LUTHIER_REPORT_FATAL_ON_ERROR(
+        HsaInterceptor->disableUserCallback(PacketSubmit));
+  }
+
+  delete HsaInterceptor;
+  delete HipInterceptor;
+  return 0;
+}
@@ -0,0 +1,94 @@
+//===-- HwId.cpp - Luthier hardware ID intrinsic  -------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements Luthier's <tt>hwId</tt> intrinsic.
+//===----------------------------------------------------------------------===//
+#include "intrinsic/HwId.hpp"
+#include "AMDGPUTargetMachine.h"
+#include "GCNSubtarget.h"
+#include "SIDefines.h"
+#include "SIRegisterInfo.h"
+#include "luthier/common/ErrorCheck.h"
+#include "luthier/common/LuthierError.h"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/User.h>
+#include <llvm/MC/MCRegister.h>
+
+namespace luthier {
+
+/// \return the immediate operand of an \c S_GETREG_B32 reading all 32 bits
+/// of the hardware register \p HwRegId
+static constexpr int64_t encodeFullHwRegRead(unsigned int HwRegId) {
+  // The operand encodes the register ID in bits [5:0], the offset of the
+  // bit-field being read in bits [10:6], and its width minus one in
+  // bits [15:11]
+  return HwRegId | (0 << 6) | ((32 - 1) << 11);
+}
+
+llvm::Expected<IntrinsicIRLoweringInfo>
+hwIdIRProcessor(const llvm::Function &Intrinsic, const llvm::CallInst &User,
+                const llvm::GCNTargetMachine &TM) {
+  // The user must not have any operands
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(User.arg_size() == 0,
+                          "Expected no operands to be passed to the "
+                          "luthier::hwId intrinsic '{0}', got {1}.",
+                          User, User.arg_size()));
+
+  luthier::IntrinsicIRLoweringInfo Out;
+  // The hardware ID will be returned in an SGPR
+  Out.setReturnValueInfo(&User, "s");
+  return Out;
+}
+
+llvm::Error hwIdMIRProcessor(
+    const IntrinsicIRLoweringInfo &IRLoweringInfo,
+    llvm::ArrayRef<std::pair<llvm::InlineAsm::Flag, llvm::Register>> Args,
+    const std::function<llvm::MachineInstrBuilder(int)> &MIBuilder,
+    const std::function<llvm::Register(const llvm::TargetRegisterClass *)>
+        &VirtRegBuilder,
+    const std::function<llvm::Register(KernelArgumentType)> &,
+    const llvm::MachineFunction &MF,
+    const std::function<llvm::Register(llvm::MCRegister)> &PhysRegAccessor,
+    llvm::DenseMap<llvm::MCRegister, llvm::Register> &PhysRegsToBeOverwritten) {
+  // There should be only a single virtual register involved in the operation
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(Args.size() == 1,
+                          "Number of virtual register arguments "
+                          "involved in the MIR lowering stage of "
+                          "luthier::hwId is {0} instead of 1.",
+                          Args.size()));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Args[0].first.isRegDefKind(),
+      "The register argument of luthier::hwId is not a definition."));
+  llvm::Register Output = Args[0].second;
+  // GFX10 and later replaced HW_ID with HW_ID1, which holds the same
+  // information in a different layout
+  auto HwRegId = MF.getSubtarget<llvm::GCNSubtarget>().getGeneration() >=
+                         llvm::AMDGPUSubtarget::GFX10
+                     ? llvm::AMDGPU::Hwreg::ID_HW_ID1
+                     : llvm::AMDGPU::Hwreg::ID_HW_ID;
+
+  (void)MIBuilder(llvm::AMDGPU::S_GETREG_B32)
+      .addReg(Output, llvm::RegState::Define)
+      .addImm(encodeFullHwRegRead(HwRegId));
+
+  return llvm::Error::success();
+}
+
+} // namespace luthier
@@ -0,0 +1,219 @@
+//===-- ReadClock.cpp - Luthier clock intrinsics  -------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements Luthier's <tt>readCycleCounter</tt> and
+/// <tt>readRealtime</tt> intrinsics.
+//===----------------------------------------------------------------------===//
+#include "intrinsic/ReadClock.hpp"
+#include "AMDGPUTargetMachine.h"
+#include "GCNSubtarget.h"
+#include "SIDefines.h"
+#include "SIRegisterInfo.h"
+#include "Utils/AMDGPUBaseInfo.h"
+#include "luthier/common/ErrorCheck.h"
+#include "luthier/common/LuthierError.h"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/User.h>
+#include <llvm/MC/MCRegister.h>
+#include <llvm/TargetParser/TargetParser.h>
+
+namespace luthier {
+
+/// Width of the \c SHADER_CYCLES hardware register in bits
+static constexpr unsigned int ShaderCyclesRegWidth = 20;
+
+/// \return \c true if \p ST can read its cycle counter
+static bool canReadCycleCounter(const llvm::GCNSubtarget &ST) {
+  return ST.hasSMemTimeInst() || ST.hasShaderCyclesRegister();
+}
+
+/// \return \c true if \p ST can read its constant-rate real time counter
+static bool canReadRealtime(const llvm::GCNSubtarget &ST) {
+  return ST.hasSMemRealTime() ||
+         ST.getGeneration() >= llvm::AMDGPUSubtarget::GFX11;
+}
+
+/// Waits for the scalar memory counter to be returned by the instruction
+/// emitted right before
+/// \details The counters are returned through the LGKM counter (the KM
+/// counter on targets with extended wait counts), same as scalar loads and
+/// LDS accesses. Waiting right away ensures that no counter read is left
+/// outstanding once the instrumentation code returns to the application,
+/// which tracks its own outstanding LGKM operations. As the wait is for a
+/// count of zero, it also drains all of the application's outstanding LGKM
+/// operations at the point of the read: Clock hooks serialize LGKM
+/// operations, and a read placed right after a scalar load or an LDS access
+/// also accounts for its latency. Vector memory counters are not waited on,
+/// so outstanding vector memory operations of the application are not
+/// serialized
+static void emitWaitForCounter(
+    const llvm::MachineFunction &MF,
+    const std::function<llvm::MachineInstrBuilder(int)> &MIBuilder) {
+  const auto &ST = MF.getSubtarget<llvm::GCNSubtarget>();
+  if (ST.hasExtendedWaitCounts()) {
+    (void)MIBuilder(llvm::AMDGPU::S_WAIT_KMCNT).addImm(0);
+    return;
+  }
+  llvm::AMDGPU::IsaVersion IV = llvm::AMDGPU::getIsaVersion(ST.getCPU());
+  (void)MIBuilder(llvm::AMDGPU::S_WAITCNT)
+      .addImm(llvm::AMDGPU::encodeLgkmcnt(
+          IV, llvm::AMDGPU::getWaitcntBitMask(IV), 0));
+}
+
+/// Common argument checks of the IR processors of the clock intrinsics
+static llvm::Expected<IntrinsicIRLoweringInfo>
+clockIRProcessor(const llvm::CallInst &User, llvm::StringRef IntrinsicName,
+                 bool IsSupported) {
+  // The user must not have any operands
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(User.arg_size() == 0,
+                          "Expected no operands to be passed to the "
+                          "luthier::{0} intrinsic '{1}', got {2}.",
+                          IntrinsicName, User, User.arg_size()));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      IsSupported,
+      "The luthier::{0} intrinsic '{1}' is not supported on the target.",
+      IntrinsicName, User));
+
+  luthier::IntrinsicIRLoweringInfo Out;
+  // The counter will be returned in an SGPR pair
+  Out.setReturnValueInfo(&User, "s");
+  return Out;
+}
+
+/// Checks the arguments of the MIR processors of the clock intrinsics
+/// \return the output register of the intrinsic
+static llvm::Expected<llvm::Register> getClockOutputRegister(
+    llvm::ArrayRef<std::pair<llvm::InlineAsm::Flag, llvm::Register>> Args,
+    llvm::StringRef IntrinsicName) {
+  // There should be only a single virtual register involved in the operation
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(Args.size() == 1,
+                          "Number of virtual register arguments "
+                          "involved in the MIR lowering stage of "
+                          "luthier::{0} is {1} instead of 1.",
+                          IntrinsicName, Args.size()));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Args[0].first.isRegDefKind(),
+      "The register argument of luthier::{0} is not a definition.",
+      IntrinsicName));
+  return Args[0].second;
+}
+
+llvm::Expected<IntrinsicIRLoweringInfo>
+readCycleCounterIRProcessor(const llvm::Function &Intrinsic,
+                            const llvm::CallInst &User,
+                            const llvm::GCNTargetMachine &TM) {
+  return clockIRProcessor(User, "readCycleCounter",
+                          canReadCycleCounter(*TM.getSubtargetImpl(Intrinsic)));
+}
+
+llvm::Error readCycleCounterMIRProcessor(
+    const IntrinsicIRLoweringInfo &IRLoweringInfo,
+    llvm::ArrayRef<std::pair<llvm::InlineAsm::Flag, llvm::Register>> Args,
+    const std::function<llvm::MachineInstrBuilder(int)> &MIBuilder,
+    const std::function<llvm::Register(const llvm::TargetRegisterClass *)>
+        &VirtRegBuilder,
+    const std::function<llvm::Register(KernelArgumentType)> &,
+    const llvm::MachineFunction &MF,
+    const std::function<llvm::Register(llvm::MCRegister)> &PhysRegAccessor,
+    llvm::DenseMap<llvm::MCRegister, llvm::Register> &PhysRegsToBeOverwritten) {
+  auto Output = getClockOutputRegister(Args, "readCycleCounter");
+  LUTHIER_RETURN_ON_ERROR(Output.takeError());
+  const auto &ST = MF.getSubtarget<llvm::GCNSubtarget>();
+
+  if (ST.hasSMemTimeInst()) {
+    llvm::Register Counter =
+        VirtRegBuilder(&llvm::AMDGPU::SReg_64_XEXECRegClass);
+    (void)MIBuilder(llvm::AMDGPU::S_MEMTIME)
+        .addReg(Counter, llvm::RegState::Define);
+    emitWaitForCounter(MF, MIBuilder);
+    (void)MIBuilder(llvm::AMDGPU::COPY)
+        .addReg(*Output, llvm::RegState::Define)
+        .addReg(Counter, llvm::RegState::Kill);
+    return llvm::Error::success();
+  }
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      ST.hasShaderCyclesRegister(),
+      "The target does not have a cycle counter to be read."));
+  // Targets without s_memtime only expose the low bits of the cycle counter
+  // through the SHADER_CYCLES register; Zero-extend it to 64 bits
+  llvm::Register CounterLo = VirtRegBuilder(&llvm::AMDGPU::SGPR_32RegClass);
+  llvm::Register CounterHi = VirtRegBuilder(&llvm::AMDGPU::SGPR_32RegClass);
+  // The s_getreg operand holds the register ID in bits [5:0], the offset of
+  // the bit-field in bits [10:6], and its width minus one in bits [15:11]
+  (void)MIBuilder(llvm::AMDGPU::S_GETREG_B32)
+      .addReg(CounterLo, llvm::RegState::Define)
+      .addImm(llvm::AMDGPU::Hwreg::ID_SHADER_CYCLES |
+              ((ShaderCyclesRegWidth - 1) << 11));
+  (void)MIBuilder(llvm::AMDGPU::S_MOV_B32)
+      .addReg(CounterHi, llvm::RegState::Define)
+      .addImm(0);
+  (void)MIBuilder(llvm::AMDGPU::REG_SEQUENCE)
+      .addReg(*Output, llvm::RegState::Define)
+      .addReg(CounterLo)
+      .addImm(llvm::SIRegisterInfo::getSubRegFromChannel(0))
+      .addReg(CounterHi)
+      .addImm(llvm::SIRegisterInfo::getSubRegFromChannel(1));
+  return llvm::Error::success();
+}
+
+llvm::Expected<IntrinsicIRLoweringInfo>
+readRealtimeIRProcessor(const llvm::Function &Intrinsic,
+                        const llvm::CallInst &User,
+                        const llvm::GCNTargetMachine &TM) {
+  return clockIRProcessor(User, "readRealtime",
+                          canReadRealtime(*TM.getSubtargetImpl(Intrinsic)));
+}
+
+llvm::Error readRealtimeMIRProcessor(
+    const IntrinsicIRLoweringInfo &IRLoweringInfo,
+    llvm::ArrayRef<std::pair<llvm::InlineAsm::Flag, llvm::Register>> Args,
+    const std::function<llvm::MachineInstrBuilder(int)> &MIBuilder,
+    const std::function<llvm::Register(const llvm::TargetRegisterClass *)>
+        &VirtRegBuilder,
+    const std::function<llvm::Register(KernelArgumentType)> &,
+    const llvm::MachineFunction &MF,
+    const std::function<llvm::Register(llvm::MCRegister)> &PhysRegAccessor,
+    llvm::DenseMap<llvm::MCRegister, llvm::Register> &PhysRegsToBeOverwritten) {
+  auto Output = getClockOutputRegister(Args, "readRealtime");
+  LUTHIER_RETURN_ON_ERROR(Output.takeError());
+  const auto &ST = MF.getSubtarget<llvm::GCNSubtarget>();
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      canReadRealtime(ST),
+      "The target does not have a real time counter to be read."));
+
+  llvm::Register Counter = VirtRegBuilder(&llvm::AMDGPU::SReg_64_XEXECRegClass);
+  if (ST.hasSMemRealTime()) {
+    (void)MIBuilder(llvm::AMDGPU::S_MEMREALTIME)
+        .addReg(Counter, llvm::RegState::Define);
+  } else {
+    // GFX11 and later removed s_memrealtime; The real time counter is
+    // requested from the message interface instead
+    (void)MIBuilder(llvm::AMDGPU::S_SENDMSG_RTN_B64)
+        .addReg(Counter, llvm::RegState::Define)
+        .addImm(llvm::AMDGPU::SendMsg::ID_RTN_GET_REALTIME);
+  }
+  emitWaitForCounter(MF, MIBuilder);
+  (void)MIBuilder(llvm::AMDGPU::COPY)
+      .addReg(*Output, llvm::RegState::Define)
+      .addReg(Counter, llvm::RegState::Kill);
+  return llvm::Error::success();
+}
+
+} // namespace luthier
@@ -0,0 +1,89 @@
+//===-- WaveIdInGroup.cpp - Luthier wave ID intrinsic  --------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements Luthier's <tt>waveIdInGroup</tt> intrinsic.
+//===----------------------------------------------------------------------===//
+#include "intrinsic/WaveIdInGroup.hpp"
+#include "AMDGPUTargetMachine.h"
+#include "GCNSubtarget.h"
+#include "SIRegisterInfo.h"
+#include "luthier/common/ErrorCheck.h"
+#include "luthier/common/LuthierError.h"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/User.h>
+#include <llvm/MC/MCRegister.h>
+
+namespace luthier {
+
+llvm::Expected<IntrinsicIRLoweringInfo>
+waveIdInGroupIRProcessor(const llvm::Function &Intrinsic,
+                         const llvm::CallInst &User,
+                         const llvm::GCNTargetMachine &TM) {
+  // The user must not have any operands
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(User.arg_size() == 0,
+                          "Expected no operands to be passed to the "
+                          "luthier::waveIdInGroup intrinsic '{0}', got {1}.",
+                          User, User.arg_size()));
+  // The index of the wave inside its workgroup is only provided by the
+  // hardware on targets with architected SGPRs; Other targets don't keep it
+  // in any register
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      TM.getSubtargetImpl(Intrinsic)->hasArchitectedSGPRs(),
+      "The luthier::waveIdInGroup intrinsic '{0}' is not supported on "
+      "targets without architected SGPRs.",
+      User));
+
+  luthier::IntrinsicIRLoweringInfo Out;
+  // The wave ID will be returned in an SGPR
+  Out.setReturnValueInfo(&User, "s");
+  return Out;
+}
+
+llvm::Error waveIdInGroupMIRProcessor(
+    const IntrinsicIRLoweringInfo &IRLoweringInfo,
+    llvm::ArrayRef<std::pair<llvm::InlineAsm::Flag, llvm::Register>> Args,
+    const std::function<llvm::MachineInstrBuilder(int)> &MIBuilder,
+    const std::function<llvm::Register(const llvm::TargetRegisterClass *)>
+        &VirtRegBuilder,
+    const std::function<llvm::Register(KernelArgumentType)> &,
+    const llvm::MachineFunction &MF,
+    const std::function<llvm::Register(llvm::MCRegister)> &PhysRegAccessor,
+    llvm::DenseMap<llvm::MCRegister, llvm::Register> &PhysRegsToBeOverwritten) {
+  // There should be only a single virtual register involved in the operation
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(Args.size() == 1,
+                          "Number of virtual register arguments "
+                          "involved in the MIR lowering stage of "
+                          "luthier::waveIdInGroup is {0} instead of 1.",
+                          Args.size()));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Args[0].first.isRegDefKind(),
+      "The register argument of luthier::waveIdInGroup is not a definition."));
+  llvm::Register Output = Args[0].second;
+  // The wave ID is stored in bits [29:25] of TTMP8; The bit-field extract
+  // operand holds the offset in its low half and the width in its high half
+  (void)MIBuilder(llvm::AMDGPU::S_BFE_U32)
+      .addReg(Output, llvm::RegState::Define)
+      .addReg(llvm::AMDGPU::TTMP8)
+      .addImm(25 | (5 << 16));
+
+  return llvm::Error::success();
+}
+
+} // namespace luthier
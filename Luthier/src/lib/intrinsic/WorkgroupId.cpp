@@ -0,0 +1,142 @@
+//===-- WorkgroupId.cpp - Luthier workgroup ID intrinsics  ----------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements Luthier's <tt>workgroupIdX</tt>, <tt>workgroupIdY</tt>
+/// and <tt>workgroupIdZ</tt> intrinsics.
+//===----------------------------------------------------------------------===//
+#include "intrinsic/WorkgroupId.hpp"
+#include "AMDGPUTargetMachine.h"
+#include "GCNSubtarget.h"
+#include "SIRegisterInfo.h"
+#include "luthier/common/ErrorCheck.h"
+#include "luthier/common/LuthierError.h"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/User.h>
+#include <llvm/MC/MCRegister.h>
+
+namespace luthier {
+
+/// Common IR processor of the workgroup ID intrinsics
+/// \param WorkgroupId the kernel argument of the dimension being queried;
+/// One of \c WORKGROUP_ID_X, \c WORKGROUP_ID_Y or \c WORKGROUP_ID_Z
+static llvm::Expected<IntrinsicIRLoweringInfo>
+workgroupIdIRProcessor(const llvm::Function &Intrinsic,
+                       const llvm::CallInst &User,
+                       const llvm::GCNTargetMachine &TM,
+                       KernelArgumentType WorkgroupId) {
+  // The user must not have any operands
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(User.arg_size() == 0,
+                          "Expected no operands to be passed to the "
+                          "luthier::workgroupId intrinsic '{0}', got {1}.",
+                          User, User.arg_size()));
+
+  luthier::IntrinsicIRLoweringInfo Out;
+  // The workgroup ID will be returned in an SGPR
+  Out.setReturnValueInfo(&User, "s");
+  // Pass the queried dimension to the MIR processor
+  Out.setLoweringData(WorkgroupId);
+  // Targets with architected SGPRs always have the workgroup IDs in trap
+  // temporary SGPRs, which are never overwritten by the app; Otherwise, the
+  // workgroup ID is a system SGPR of the kernel which must be preserved by
+  // its preamble
+  if (!TM.getSubtargetImpl(Intrinsic)->hasArchitectedSGPRs())
+    Out.requestAccessToKernelArgument(WorkgroupId);
+
+  return Out;
+}
+
+llvm::Expected<IntrinsicIRLoweringInfo>
+workgroupIdXIRProcessor(const llvm::Function &Intrinsic,
+                        const llvm::CallInst &User,
+                        const llvm::GCNTargetMachine &TM) {
+  return workgroupIdIRProcessor(Intrinsic, User, TM, WORKGROUP_ID_X);
+}
+
+llvm::Expected<IntrinsicIRLoweringInfo>
+workgroupIdYIRProcessor(const llvm::Function &Intrinsic,
+                        const llvm::CallInst &User,
+                        const llvm::GCNTargetMachine &TM) {
+  return workgroupIdIRProcessor(Intrinsic, User, TM, WORKGROUP_ID_Y);
+}
+
+llvm::Expected<IntrinsicIRLoweringInfo>
+workgroupIdZIRProcessor(const llvm::Function &Intrinsic,
+                        const llvm::CallInst &User,
+                        const llvm::GCNTargetMachine &TM) {
+  return workgroupIdIRProcessor(Intrinsic, User, TM, WORKGROUP_ID_Z);
+}
+
+llvm::Error workgroupIdMIRProcessor(
+    const IntrinsicIRLoweringInfo &IRLoweringInfo,
+    llvm::ArrayRef<std::pair<llvm::InlineAsm::Flag, llvm::Register>> Args,
+    const std::function<llvm::MachineInstrBuilder(int)> &MIBuilder,
+    const std::function<llvm::Register(const llvm::TargetRegisterClass *)>
+        &VirtRegBuilder,
+    const std::function<llvm::Register(KernelArgumentType)> &KernArgAccessor,
+    const llvm::MachineFunction &MF,
+    const std::function<llvm::Register(llvm::MCRegister)> &PhysRegAccessor,
+    llvm::DenseMap<llvm::MCRegister, llvm::Register> &PhysRegsToBeOverwritten) {
+  // There should be only a single virtual register involved in the operation
+  LUTHIER_RETURN_ON_ERROR(
+      LUTHIER_ERROR_CHECK(Args.size() == 1,
+                          "Number of virtual register arguments "
+                          "involved in the MIR lowering stage of "
+                          "luthier::workgroupId is {0} instead of 1.",
+                          Args.size()));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Args[0].first.isRegDefKind(),
+      "The register argument of luthier::workgroupId is not a definition."));
+  llvm::Register Output = Args[0].second;
+  auto WorkgroupId = IRLoweringInfo.getLoweringData<KernelArgumentType>();
+
+  if (!MF.getSubtarget<llvm::GCNSubtarget>().hasArchitectedSGPRs()) {
+    (void)MIBuilder(llvm::AMDGPU::COPY)
+        .addReg(Output, llvm::RegState::Define)
+        .addReg(KernArgAccessor(WorkgroupId), llvm::RegState::Kill);
+    return llvm::Error::success();
+  }
+  // With architected SGPRs, the X dimension is in TTMP9, while the Y and Z
+  // dimensions are packed into the low and high halves of TTMP7
+  switch (WorkgroupId) {
+  case WORKGROUP_ID_X:
+    (void)MIBuilder(llvm::AMDGPU::COPY)
+        .addReg(Output, llvm::RegState::Define)
+        .addReg(llvm::AMDGPU::TTMP9);
+    break;
+  case WORKGROUP_ID_Y:
+    (void)MIBuilder(llvm::AMDGPU::S_AND_B32)
+        .addReg(Output, llvm::RegState::Define)
+        .addReg(llvm::AMDGPU::TTMP7)
+        .addImm(0xFFFF);
+    break;
+  case WORKGROUP_ID_Z:
+    (void)MIBuilder(llvm::AMDGPU::S_LSHR_B32)
+        .addReg(Output, llvm::RegState::Define)
+        .addReg(llvm::AMDGPU::TTMP7)
+        .addImm(16);
+    break;
+  default:
+    return LUTHIER_CREATE_ERROR(
+        "Kernel argument {0} is not a workgroup ID.",
+        static_cast<int>(WorkgroupId));
+  }
+  return llvm::Error::success();
+}
+
+} // namespace luthier
@@ -22,11 +22,16 @@
 #include "common/Log.hpp"
 #include "hip/HipCompilerApiInterceptor.hpp"
 #include "hip/HipRuntimeApiInterceptor.hpp"
+#include "hsa/DispatchCompletionHandler.hpp"
 #include "hsa/Executable.hpp"
 #include "hsa/ExecutableBackedObjectsCache.hpp"
+#include "intrinsic/HwId.hpp"
 #include "intrinsic/ImplicitArgPtr.hpp"
+#include "intrinsic/ReadClock.hpp"
 #include "intrinsic/ReadReg.hpp"
 #include "intrinsic/SAtomicAdd.hpp"
+#include "intrinsic/WaveIdInGroup.hpp"
+#include "intrinsic/WorkgroupId.hpp"
 #include "intrinsic/WriteExec.hpp"
 #include "intrinsic/WriteReg.hpp"
 #include "luthier/llvm/EagerManagedStatic.h"
@@ -82,6 +87,7 @@ Controller::Controller() {
   HsaInterceptor = new hsa::HsaRuntimeInterceptor();
   HsaPlatform = new hsa::ExecutableBackedObjectsCache();
   HipRuntimeInterceptor = new hip::HipRuntimeApiInterceptor();
+  DCH = new hsa::DispatchCompletionHandler();
   TEL = new ToolExecutableLoader();
   CL = new CodeLifter();
   CG = new CodeGenerator();
@@ -98,6 +104,21 @@ Controller::Controller() {
       {implicitArgPtrIRProcessor, implicitArgPtrMIRProcessor});
   CG->registerIntrinsic("luthier::sAtomicAdd",
                         {sAtomicAddIRProcessor, sAtomicAddMIRProcessor});
+  CG->registerIntrinsic("luthier::workgroupIdX",
+                        {workgroupIdXIRProcessor, workgroupIdMIRProcessor});
+  CG->registerIntrinsic("luthier::workgroupIdY",
+                        {workgroupIdYIRProcessor, workgroupIdMIRProcessor});
+  CG->registerIntrinsic("luthier::workgroupIdZ",
+                        {workgroupIdZIRProcessor, workgroupIdMIRProcessor});
+  CG->registerIntrinsic(
+      "luthier::waveIdInGroup",
+      {waveIdInGroupIRProcessor, waveIdInGroupMIRProcessor});
+  CG->registerIntrinsic("luthier::hwId", {hwIdIRProcessor, hwIdMIRProcessor});
+  CG->registerIntrinsic(
+      "luthier::readCycleCounter",
+      {readCycleCounterIRProcessor, readCycleCounterMIRProcessor});
+  CG->registerIntrinsic("luthier::readRealtime",
+                        {readRealtimeIRProcessor, readRealtimeMIRProcessor});
 }
 
 Controller::~Controller() {
@@ -105,6 +126,7 @@ Controller::~Controller() {
   delete CL;
   delete TEL;
   delete HsaPlatform;
+  delete DCH;
   delete HipRuntimeInterceptor;
   delete HsaInterceptor;
   delete HipCompilerInterceptor;
@@ -207,6 +229,10 @@ static void parseEnvVariableArgs() {
 static void toolingLibraryFini(void *) {
   static std::once_flag Once{};
   std::call_once(Once, []() {
+    // Make sure all pending dispatch completion callbacks have been run before
+    // the tool is notified of finalization
+    if (hsa::DispatchCompletionHandler::isInitialized())
+      hsa::DispatchCompletionHandler::instance().drain();
     atToolFini(API_EVT_PHASE_BEFORE);
     if (*TimeTrace) {
       LUTHIER_REPORT_FATAL_ON_ERROR(
@@ -0,0 +1,160 @@
+//===-- DeviceHashMap.cpp -------------------------------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file implements the \c DeviceHashMap class.
+//===----------------------------------------------------------------------===//
+#include "luthier/tooling/DeviceHashMap.h"
+#include "luthier/luthier.h"
+#include <algorithm>
+#include <cmath>
+#include <llvm/Support/Debug.h>
+#include <llvm/Support/MathExtras.h>
+#include <luthier/common/LuthierError.h>
+#include <luthier/hip/HipError.h>
+#include <luthier/hsa/DisableInterceptionScope.h>
+#include <luthier/hsa/HsaError.h>
+#include <vector>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-device-hash-map"
+
+namespace luthier {
+
+/// Smallest number of slots of a map
+static constexpr uint64_t MinHashMapCapacity = 64;
+
+/// Copies \p Size bytes from \p Src to \p Dest, either of which can be
+/// device memory
+static llvm::Error copyMemory(void *Dest, const void *Src, size_t Size) {
+  return LUTHIER_HSA_SUCCESS_CHECK(
+      hsa::getHsaApiTable().core_->hsa_memory_copy_fn(Dest, Src, Size));
+}
+
+llvm::Expected<std::unique_ptr<DeviceHashMap>>
+DeviceHashMap::create(uint64_t NumExpectedKeys, double MaxLoadFactor,
+                      HashMapOverflowPolicy OverflowPolicy,
+                      uint32_t MaxProbes) {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      MaxLoadFactor > 0.0 && MaxLoadFactor <= 1.0,
+      "Maximum load factor of a device hash map must be in (0, 1], got {0}.",
+      MaxLoadFactor));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      MaxProbes != 0, "Device hash maps must probe at least one slot."));
+  uint64_t Capacity = llvm::PowerOf2Ceil(std::max(
+      MinHashMapCapacity,
+      static_cast<uint64_t>(
+          std::ceil(static_cast<double>(NumExpectedKeys) / MaxLoadFactor))));
+  LLVM_DEBUG(llvm::dbgs() << "Creating a device hash map with " << Capacity
+                          << " slots.\n");
+
+  std::unique_ptr<DeviceHashMap> Map(new DeviceHashMap());
+  DeviceHashMapDescriptor &Desc = Map->Descriptor;
+  Desc.CapacityMask = Capacity - 1;
+  Desc.MaxProbes = static_cast<uint32_t>(
+      std::min<uint64_t>(MaxProbes, Capacity));
+  Desc.OverflowPolicy = OverflowPolicy;
+
+  const auto &HipTable = hip::getSavedDispatchTable();
+  hsa::DisableUserInterceptionScope Scope;
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_HIP_SUCCESS_CHECK(HipTable.hipMalloc_fn(
+      reinterpret_cast<void **>(&Desc.Keys), Capacity * sizeof(uint64_t))));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_HIP_SUCCESS_CHECK(HipTable.hipMalloc_fn(
+      reinterpret_cast<void **>(&Desc.Values), Capacity * sizeof(uint64_t))));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_HIP_SUCCESS_CHECK(
+      HipTable.hipMalloc_fn(reinterpret_cast<void **>(&Desc.Stats),
+                            sizeof(HashMapDeviceStatistics))));
+  LUTHIER_RETURN_ON_ERROR(Map->clear());
+  return Map;
+}
+
+DeviceHashMap::~DeviceHashMap() {
+  const auto &HipTable = hip::getSavedDispatchTable();
+  hsa::DisableUserInterceptionScope Scope;
+  // Failing to free the memory is not recoverable at this point, and only
+  // leaks device memory; Ignore the result
+  for (void *Ptr : {static_cast<void *>(Descriptor.Keys),
+                    static_cast<void *>(Descriptor.Values),
+                    static_cast<void *>(Descriptor.Stats)}) {
+    if (Ptr)
+      (void)HipTable.hipFree_fn(Ptr);
+  }
+}
+
+llvm::Error DeviceHashMap::bind(const void *DescriptorVariable) const {
+  hsa::DisableUserInterceptionScope Scope;
+  void *DeviceDescriptor;
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_HIP_SUCCESS_CHECK(
+      hip::getSavedDispatchTable().hipGetSymbolAddress_fn(
+          &DeviceDescriptor, DescriptorVariable)));
+  return copyMemory(DeviceDescriptor, &Descriptor, sizeof(Descriptor));
+}
+
+llvm::Error DeviceHashMap::clear() {
+  hsa::DisableUserInterceptionScope Scope;
+  // All bytes of the empty key are set, so the same host buffer can be used
+  // to clear both the keys and the values
+  static_assert(HashMapEmptyKey == ~uint64_t{0});
+  std::vector<uint64_t> Buffer(getCapacity(), HashMapEmptyKey);
+  size_t Size = Buffer.size() * sizeof(uint64_t);
+  LUTHIER_RETURN_ON_ERROR(copyMemory(Descriptor.Keys, Buffer.data(), Size));
+  std::fill(Buffer.begin(), Buffer.end(), 0);
+  LUTHIER_RETURN_ON_ERROR(copyMemory(Descriptor.Values, Buffer.data(), Size));
+  HashMapDeviceStatistics Stats{};
+  return copyMemory(Descriptor.Stats, &Stats, sizeof(Stats));
+}
+
+llvm::Expected<HashMapStatistics> DeviceHashMap::readBack(
+    llvm::function_ref<void(uint64_t Key, uint64_t Value)> Callback) const {
+  std::vector<uint64_t> Keys(getCapacity());
+  std::vector<uint64_t> Values(getCapacity());
+  HashMapDeviceStatistics DeviceStats;
+  {
+    hsa::DisableUserInterceptionScope Scope;
+    size_t Size = Keys.size() * sizeof(uint64_t);
+    LUTHIER_RETURN_ON_ERROR(copyMemory(Keys.data(), Descriptor.Keys, Size));
+    LUTHIER_RETURN_ON_ERROR(
+        copyMemory(Values.data(), Descriptor.Values, Size));
+    LUTHIER_RETURN_ON_ERROR(
+        copyMemory(&DeviceStats, Descriptor.Stats, sizeof(DeviceStats)));
+  }
+
+  HashMapStatistics Stats;
+  Stats.Capacity = getCapacity();
+  for (uint64_t Slot = 0; Slot < Keys.size(); Slot++) {
+    uint64_t Key = Keys[Slot];
+    if (Key == HashMapEmptyKey)
+      continue;
+    Stats.NumKeys++;
+    uint64_t HomeSlot = hashMapHash(Key) & Descriptor.CapacityMask;
+    Stats.MaxProbeDistance =
+        std::max(Stats.MaxProbeDistance,
+                 ((Slot - HomeSlot) & Descriptor.CapacityMask) + 1);
+    Callback(Key, Values[Slot]);
+  }
+  Stats.LoadFactor = static_cast<double>(Stats.NumKeys) /
+                     static_cast<double>(Stats.Capacity);
+  Stats.NumLookups = DeviceStats.NumLookups;
+  Stats.AverageProbesPerLookup =
+      DeviceStats.NumLookups == 0
+          ? 0.0
+          : static_cast<double>(DeviceStats.NumProbes) /
+                static_cast<double>(DeviceStats.NumLookups);
+  Stats.NumOverflowedUpdates = DeviceStats.NumOverflowedUpdates;
+  Stats.OverflowValue = DeviceStats.OverflowValue;
+  return Stats;
+}
+
+} // namespace luthier
@@ -0,0 +1,302 @@
+//===-- DeviceSketch.cpp --------------------------------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file implements the host-side sketches and their device
+/// memory owners.
+//===----------------------------------------------------------------------===//
+#include "luthier/tooling/DeviceSketch.h"
+#include "luthier/luthier.h"
+#include <algorithm>
+#include <cmath>
+#include <llvm/Support/Debug.h>
+#include <luthier/common/LuthierError.h>
+#include <luthier/hip/HipError.h>
+#include <luthier/hsa/DisableInterceptionScope.h>
+#include <luthier/hsa/HsaError.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-device-sketch"
+
+namespace luthier {
+
+//===----------------------------------------------------------------------===//
+// Device memory helpers
+//===----------------------------------------------------------------------===//
+
+/// Copies \p Size bytes from \p Src to \p Dest, either of which can be
+/// device memory
+static llvm::Error copyMemory(void *Dest, const void *Src, size_t Size) {
+  return LUTHIER_HSA_SUCCESS_CHECK(
+      hsa::getHsaApiTable().core_->hsa_memory_copy_fn(Dest, Src, Size));
+}
+
+/// Allocates \p Size bytes of device memory in \p Ptr
+template <typename T>
+static llvm::Error allocateDeviceMemory(T *&Ptr, size_t Size) {
+  hsa::DisableUserInterceptionScope Scope;
+  return LUTHIER_HIP_SUCCESS_CHECK(hip::getSavedDispatchTable().hipMalloc_fn(
+      reinterpret_cast<void **>(&Ptr), Size));
+}
+
+/// Frees the device memory at \p Ptr, if any
+static void freeDeviceMemory(void *Ptr) {
+  if (!Ptr)
+    return;
+  hsa::DisableUserInterceptionScope Scope;
+  // Failing to free the memory is not recoverable at this point, and only
+  // leaks device memory; Ignore the result
+  (void)hip::getSavedDispatchTable().hipFree_fn(Ptr);
+}
+
+/// Copies the \p Size bytes of \p Descriptor to the device variable with
+/// the host shadow \p DescriptorVariable
+static llvm::Error bindDescriptor(const void *DescriptorVariable,
+                                 const void *Descriptor, size_t Size) {
+  hsa::DisableUserInterceptionScope Scope;
+  void *DeviceDescriptor;
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_HIP_SUCCESS_CHECK(
+      hip::getSavedDispatchTable().hipGetSymbolAddress_fn(
+          &DeviceDescriptor, DescriptorVariable)));
+  return copyMemory(DeviceDescriptor, Descriptor, Size);
+}
+
+/// Zeros the \p NumElements elements of type \p T at \p DevicePtr
+template <typename T>
+static llvm::Error zeroDeviceMemory(T *DevicePtr, size_t NumElements) {
+  hsa::DisableUserInterceptionScope Scope;
+  std::vector<T> Zeros(NumElements, 0);
+  return copyMemory(DevicePtr, Zeros.data(), NumElements * sizeof(T));
+}
+
+/// Copies the \p NumElements elements of type \p T at \p DevicePtr to
+/// \p HostPtr
+template <typename T>
+static llvm::Error readDeviceMemory(T *HostPtr, const T *DevicePtr,
+                                    size_t NumElements) {
+  hsa::DisableUserInterceptionScope Scope;
+  return copyMemory(HostPtr, DevicePtr, NumElements * sizeof(T));
+}
+
+//===----------------------------------------------------------------------===//
+// HyperLogLogSketch
+//===----------------------------------------------------------------------===//
+
+HyperLogLogSketch::HyperLogLogSketch(uint32_t Precision)
+    : Precision(Precision), Registers(size_t{1} << Precision, 0) {
+  assert(Precision >= HyperLogLogMinPrecision &&
+         Precision <= HyperLogLogMaxPrecision &&
+         "HyperLogLog precision out of range");
+}
+
+void HyperLogLogSketch::setRegisters(
+    llvm::ArrayRef<uint32_t> DeviceRegisters) {
+  assert(DeviceRegisters.size() == Registers.size() &&
+         "Mismatched number of HyperLogLog registers");
+  // Ranks never exceed 65, so they fit in a byte on the host
+  llvm::copy(DeviceRegisters, Registers.begin());
+}
+
+void HyperLogLogSketch::add(uint64_t Key) {
+  uint64_t Hash = hashMapHash(Key);
+  uint8_t &Register = Registers[hyperLogLogRegister(Hash, Precision)];
+  Register = std::max(Register,
+                      static_cast<uint8_t>(hyperLogLogRank(Hash, Precision)));
+}
+
+llvm::Error HyperLogLogSketch::merge(const HyperLogLogSketch &Other) {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Precision == Other.Precision,
+      "Cannot merge HyperLogLog sketches of precisions {0} and {1}.",
+      Precision, Other.Precision));
+  for (size_t I = 0; I < Registers.size(); I++)
+    Registers[I] = std::max(Registers[I], Other.Registers[I]);
+  return llvm::Error::success();
+}
+
+double HyperLogLogSketch::estimate() const {
+  auto M = static_cast<double>(Registers.size());
+  double Alpha;
+  switch (Registers.size()) {
+  case 16:
+    Alpha = 0.673;
+    break;
+  case 32:
+    Alpha = 0.697;
+    break;
+  case 64:
+    Alpha = 0.709;
+    break;
+  default:
+    Alpha = 0.7213 / (1.0 + 1.079 / M);
+  }
+  double Sum = 0.0;
+  size_t NumZeroRegisters = 0;
+  for (uint8_t Register : Registers) {
+    Sum += std::ldexp(1.0, -static_cast<int>(Register));
+    NumZeroRegisters += Register == 0;
+  }
+  double Estimate = Alpha * M * M / Sum;
+  // Small cardinalities are estimated more accurately by the number of
+  // registers never hit; With 64-bit hashes, no large range correction is
+  // needed
+  if (Estimate <= 2.5 * M && NumZeroRegisters != 0)
+    return M * std::log(M / static_cast<double>(NumZeroRegisters));
+  return Estimate;
+}
+
+double HyperLogLogSketch::getStandardError() const {
+  return 1.04 / std::sqrt(static_cast<double>(Registers.size()));
+}
+
+//===----------------------------------------------------------------------===//
+// CountMinSketch
+//===----------------------------------------------------------------------===//
+
+CountMinSketch::CountMinSketch(uint32_t WidthLog2, uint32_t Depth)
+    : WidthLog2(WidthLog2), Depth(Depth),
+      Counters(size_t{Depth} << WidthLog2, 0) {}
+
+void CountMinSketch::add(uint64_t Key, uint64_t Value) {
+  for (uint32_t Row = 0; Row < Depth; Row++)
+    Counters[(size_t{Row} << WidthLog2) +
+             countMinColumn(Key, Row, WidthLog2)] += Value;
+}
+
+llvm::Error CountMinSketch::merge(const CountMinSketch &Other) {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      WidthLog2 == Other.WidthLog2 && Depth == Other.Depth,
+      "Cannot merge count-min sketches of dimensions {0}x{1} and {2}x{3}.",
+      Depth, uint64_t{1} << WidthLog2, Other.Depth,
+      uint64_t{1} << Other.WidthLog2));
+  for (size_t I = 0; I < Counters.size(); I++)
+    Counters[I] += Other.Counters[I];
+  return llvm::Error::success();
+}
+
+uint64_t CountMinSketch::estimate(uint64_t Key) const {
+  uint64_t Estimate = ~uint64_t{0};
+  for (uint32_t Row = 0; Row < Depth; Row++)
+    Estimate = std::min(Estimate,
+                        Counters[(size_t{Row} << WidthLog2) +
+                                 countMinColumn(Key, Row, WidthLog2)]);
+  return Depth == 0 ? 0 : Estimate;
+}
+
+uint64_t CountMinSketch::getTotalCount() const {
+  // Each update adds to exactly one counter of every row
+  uint64_t Total = 0;
+  for (size_t I = 0; Depth != 0 && I < (size_t{1} << WidthLog2); I++)
+    Total += Counters[I];
+  return Total;
+}
+
+double CountMinSketch::getErrorBound() const {
+  return std::exp(1.0) / std::ldexp(1.0, static_cast<int>(WidthLog2)) *
+         static_cast<double>(getTotalCount());
+}
+
+//===----------------------------------------------------------------------===//
+// DeviceHyperLogLog
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<std::unique_ptr<DeviceHyperLogLog>>
+DeviceHyperLogLog::create(uint32_t Precision) {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Precision >= HyperLogLogMinPrecision &&
+          Precision <= HyperLogLogMaxPrecision,
+      "HyperLogLog precision must be in [{0}, {1}], got {2}.",
+      HyperLogLogMinPrecision, HyperLogLogMaxPrecision, Precision));
+  LLVM_DEBUG(llvm::dbgs() << "Creating a device HyperLogLog sketch with "
+                          << (1 << Precision) << " registers.\n");
+  std::unique_ptr<DeviceHyperLogLog> Sketch(new DeviceHyperLogLog());
+  Sketch->Descriptor.Precision = Precision;
+  LUTHIER_RETURN_ON_ERROR(
+      allocateDeviceMemory(Sketch->Descriptor.Registers,
+                           (size_t{1} << Precision) * sizeof(uint32_t)));
+  LUTHIER_RETURN_ON_ERROR(Sketch->clear());
+  return Sketch;
+}
+
+DeviceHyperLogLog::~DeviceHyperLogLog() {
+  freeDeviceMemory(Descriptor.Registers);
+}
+
+llvm::Error DeviceHyperLogLog::bind(const void *DescriptorVariable) const {
+  return bindDescriptor(DescriptorVariable, &Descriptor, sizeof(Descriptor));
+}
+
+llvm::Error DeviceHyperLogLog::clear() {
+  return zeroDeviceMemory(Descriptor.Registers, size_t{1}
+                                                    << Descriptor.Precision);
+}
+
+llvm::Expected<HyperLogLogSketch> DeviceHyperLogLog::readBack() const {
+  std::vector<uint32_t> Registers(size_t{1} << Descriptor.Precision);
+  LUTHIER_RETURN_ON_ERROR(readDeviceMemory(
+      Registers.data(), Descriptor.Registers, Registers.size()));
+  HyperLogLogSketch Sketch(Descriptor.Precision);
+  Sketch.setRegisters(Registers);
+  return Sketch;
+}
+
+//===----------------------------------------------------------------------===//
+// DeviceCountMinSketch
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<std::unique_ptr<DeviceCountMinSketch>>
+DeviceCountMinSketch::create(uint32_t WidthLog2, uint32_t Depth) {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      WidthLog2 >= 1 && WidthLog2 <= 30,
+      "Count-min sketch width must be in [2^1, 2^30], got 2^{0}.",
+      WidthLog2));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Depth >= 1 && Depth <= 16,
+      "Count-min sketch depth must be in [1, 16], got {0}.", Depth));
+  LLVM_DEBUG(llvm::dbgs() << "Creating a device count-min sketch of " << Depth
+                          << " rows of " << (1 << WidthLog2)
+                          << " counters.\n");
+  std::unique_ptr<DeviceCountMinSketch> Sketch(new DeviceCountMinSketch());
+  Sketch->Descriptor.WidthLog2 = WidthLog2;
+  Sketch->Descriptor.Depth = Depth;
+  LUTHIER_RETURN_ON_ERROR(
+      allocateDeviceMemory(Sketch->Descriptor.Counters,
+                           (size_t{Depth} << WidthLog2) * sizeof(uint64_t)));
+  LUTHIER_RETURN_ON_ERROR(Sketch->clear());
+  return Sketch;
+}
+
+DeviceCountMinSketch::~DeviceCountMinSketch() {
+  freeDeviceMemory(Descriptor.Counters);
+}
+
+llvm::Error DeviceCountMinSketch::bind(const void *DescriptorVariable) const {
+  return bindDescriptor(DescriptorVariable, &Descriptor, sizeof(Descriptor));
+}
+
+llvm::Error DeviceCountMinSketch::clear() {
+  return zeroDeviceMemory(Descriptor.Counters,
+                          size_t{Descriptor.Depth} << Descriptor.WidthLog2);
+}
+
+llvm::Expected<CountMinSketch> DeviceCountMinSketch::readBack() const {
+  CountMinSketch Sketch(Descriptor.WidthLog2, Descriptor.Depth);
+  llvm::MutableArrayRef<uint64_t> Counters = Sketch.counters();
+  LUTHIER_RETURN_ON_ERROR(
+      readDeviceMemory(Counters.data(), Descriptor.Counters, Counters.size()));
+  return Sketch;
+}
+
+} // namespace luthier
@@ -22,18 +22,29 @@
 #include "luthier/luthier.h"
 #include "hip/HipCompilerApiInterceptor.hpp"
 #include "hip/HipRuntimeApiInterceptor.hpp"
+#include "hsa/DispatchCompletionHandler.hpp"
 #include "hsa/ExecutableBackedObjectsCache.hpp"
 #include "hsa/HsaRuntimeInterceptor.hpp"
 #include "luthier/hsa/Instr.h"
 #include "luthier/tooling/InstrumentationTask.h"
 #include "tooling_common/CodeGenerator.hpp"
 #include "tooling_common/CodeLifter.hpp"
+#include "tooling_common/KernelOccupancy.hpp"
 #include "tooling_common/ToolExecutableLoader.hpp"
 #include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <luthier/llvm/streams.h>
 #include <optional>
 
 namespace luthier {
 
+static llvm::cl::opt<bool> PrintOccupancyReport(
+    "luthier-print-occupancy-report",
+    llvm::cl::desc("Print the resource usage and waves per SIMD of each kernel "
+                   "before and after instrumentation."),
+    llvm::cl::init(false));
+
 namespace hip {
 
 const HipCompilerDispatchTable &getSavedCompilerTable() {
@@ -44,6 +55,19 @@ const HipDispatchTable &getSavedDispatchTable() {
   return HipRuntimeApiInterceptor::instance().getSavedApiTableContainer();
 }
 
+void setAtHipRuntimeApiEvtCallback(
+    const std::function<void(ApiEvtArgs *, ApiEvtPhase, ApiEvtID)> &Callback) {
+  HipRuntimeApiInterceptor::instance().setUserCallback(Callback);
+}
+
+llvm::Error enableHipRuntimeApiEvtIDCallback(ApiEvtID ApiID) {
+  return HipRuntimeApiInterceptor::instance().enableUserCallback(ApiID);
+}
+
+llvm::Error disableHipRuntimeApiEvtIDCallback(ApiEvtID ApiID) {
+  return HipRuntimeApiInterceptor::instance().disableUserCallback(ApiID);
+}
+
 } // namespace hip
 
 namespace hsa {
@@ -63,6 +87,14 @@ const hsa_ven_amd_loader_1_03_pfn_s &getHsaVenAmdLoaderTable() {
   return hsa::HsaRuntimeInterceptor::instance().getHsaVenAmdLoaderTable();
 }
 
+llvm::Error onDispatchComplete(
+    hsa_kernel_dispatch_packet_t &Packet,
+    const std::function<void(const hsa_kernel_dispatch_packet_t &)>
+        &Callback) {
+  return DispatchCompletionHandler::instance().registerCallback(Packet,
+                                                                Callback);
+}
+
 llvm::Error enableHsaApiEvtIDCallback(hsa::ApiEvtID ApiID) {
   return hsa::HsaRuntimeInterceptor::instance().enableUserCallback(ApiID);
 }
@@ -71,6 +103,10 @@ llvm::Error disableHsaApiEvtIDCallback(hsa::ApiEvtID ApiID) {
   return hsa::HsaRuntimeInterceptor::instance().disableUserCallback(ApiID);
 }
 
+void setPacketSubmitPassThrough(bool Enable) {
+  hsa::HsaRuntimeInterceptor::instance().setPacketSubmitPassThrough(Enable);
+}
+
 } // namespace hsa
 
 llvm::Expected<llvm::ArrayRef<hsa::Instr>>
@@ -96,6 +132,14 @@ instrument(const LiftedRepresentation &LR,
   return CodeGenerator::instance().instrument(LR, Mutator);
 }
 
+llvm::Expected<std::unique_ptr<LiftedRepresentation>>
+instrument(const LiftedRepresentation &LR,
+           llvm::ArrayRef<llvm::function_ref<
+               llvm::Error(InstrumentationTask &, LiftedRepresentation &)>>
+               Mutators) {
+  return CodeGenerator::instance().instrument(LR, Mutators);
+}
+
 llvm::Error
 printLiftedRepresentation(LiftedRepresentation &LR,
                           llvm::SmallVectorImpl<char> &CompiledObjectFile,
@@ -106,6 +150,35 @@ printLiftedRepresentation(LiftedRepresentation &LR,
   return llvm::Error::success();
 }
 
+/// Compares the kernel descriptors of \p Kernel and its instrumented version
+/// under \p Preset, and prints their resource usage and occupancy
+static llvm::Error
+printOccupancyReport(const hsa::LoadedCodeObjectKernel &Kernel,
+                     llvm::StringRef Preset) {
+  auto KernelName = Kernel.getName();
+  LUTHIER_RETURN_ON_ERROR(KernelName.takeError());
+  auto InstrumentedKernel =
+      ToolExecutableLoader::instance().getInstrumentedKernel(Kernel, Preset);
+  LUTHIER_RETURN_ON_ERROR(InstrumentedKernel.takeError());
+  auto Original = getKernelOccupancy(Kernel);
+  LUTHIER_RETURN_ON_ERROR(Original.takeError());
+  auto Instrumented = getKernelOccupancy(*InstrumentedKernel);
+  LUTHIER_RETURN_ON_ERROR(Instrumented.takeError());
+  luthier::errs() << llvm::formatv(
+      "Occupancy of kernel {0} instrumented under preset {1}:\n"
+      "  VGPRs:         {2,6} -> {3,6}\n"
+      "  SGPRs:         {4,6} -> {5,6}\n"
+      "  LDS bytes:     {6,6} -> {7,6}\n"
+      "  Scratch bytes: {8,6} -> {9,6}\n"
+      "  Waves/SIMD:    {10,6} -> {11,6}\n",
+      *KernelName, Preset, Original->NumVGPRs, Instrumented->NumVGPRs,
+      Original->NumSGPRs, Instrumented->NumSGPRs, Original->GroupSegmentSize,
+      Instrumented->GroupSegmentSize, Original->PrivateSegmentSize,
+      Instrumented->PrivateSegmentSize, Original->WavesPerEU,
+      Instrumented->WavesPerEU);
+  return llvm::Error::success();
+}
+
 llvm::Error
 instrumentAndLoad(const hsa::LoadedCodeObjectKernel &Kernel,
                   const LiftedRepresentation &LR,
@@ -113,9 +186,19 @@ instrumentAndLoad(const hsa::LoadedCodeObjectKernel &Kernel,
                                                  LiftedRepresentation &)>
                       Mutator,
                   llvm::StringRef Preset) {
+  return instrumentAndLoad(Kernel, LR, llvm::ArrayRef(Mutator), Preset);
+}
+
+llvm::Error
+instrumentAndLoad(const hsa::LoadedCodeObjectKernel &Kernel,
+                  const LiftedRepresentation &LR,
+                  llvm::ArrayRef<llvm::function_ref<llvm::Error(
+                      InstrumentationTask &, LiftedRepresentation &)>>
+                      Mutators,
+                  llvm::StringRef Preset) {
   auto Lock = LR.getLock();
   // Instrument the lifted representation
-  auto InstrumentedLR = CodeGenerator::instance().instrument(LR, Mutator);
+  auto InstrumentedLR = CodeGenerator::instance().instrument(LR, Mutators);
   LUTHIER_RETURN_ON_ERROR(InstrumentedLR.takeError());
 
   // Print the assembly file of the Instrumented LR
@@ -149,8 +232,11 @@ instrumentAndLoad(const hsa::LoadedCodeObjectKernel &Kernel,
     LUTHIER_RETURN_ON_ERROR(VarAddress.takeError());
     ExternVariables.insert({GVName, reinterpret_cast<void *>(**VarAddress)});
   }
-  return TEM.loadInstrumentedKernel(Executable, Kernel, Preset,
-                                    ExternVariables);
+  LUTHIER_RETURN_ON_ERROR(
+      TEM.loadInstrumentedKernel(Executable, Kernel, Preset, ExternVariables));
+  if (PrintOccupancyReport)
+    return printOccupancyReport(Kernel, Preset);
+  return llvm::Error::success();
 }
 
 llvm::Expected<bool>
@@ -17,6 +17,8 @@
 /// \file
 /// This file implements the \c AMDGPURegisterLiveness class and its pass.
 //===----------------------------------------------------------------------===//
+#include <llvm/CodeGen/TargetRegisterInfo.h>
+#include <llvm/CodeGen/TargetSubtargetInfo.h>
 #include <llvm/Support/TimeProfiler.h>
 #include <luthier/llvm/streams.h>
 #include <luthier/tooling/AMDGPURegisterLiveness.h>
@@ -28,94 +30,158 @@
 
 namespace luthier {
 
-static void computeLiveIns(
-    llvm::LivePhysRegs &LiveRegs, const VectorMBB &MBB,
-    llvm::DenseMap<const llvm::MachineInstr *,
-                   std::unique_ptr<llvm::LivePhysRegs>> &PerMILiveIns) {
+/// Recomputes the live-ins of \p MBB from the live-ins of its successors
+/// \param LPR scratch live register set, re-used across blocks to avoid
+/// re-allocating its register universe
+/// \return \c true if any changes were made
+static bool recomputeLiveIns(VectorMBB &MBB, llvm::LivePhysRegs &LPR) {
   auto &TRI = *MBB.getParent().getMF().getSubtarget().getRegisterInfo();
-  LiveRegs.init(TRI);
-  luthier::addLiveOutsNoPristines(LiveRegs, MBB);
-  for (const llvm::MachineInstr &MI : llvm::reverse(MBB)) {
-    LiveRegs.stepBackward(MI);
-    // Update the MI LiveIns map
-    if (!PerMILiveIns.contains(&MI))
-      (void)PerMILiveIns.insert(
-          {const_cast<llvm::MachineInstr *>(&MI),
-           std::move(std::make_unique<llvm::LivePhysRegs>())});
-    auto &MILivePhysRegs = PerMILiveIns[&MI];
-    MILivePhysRegs->init(TRI);
-    for (const auto &LivePhysReg : LiveRegs) {
-      MILivePhysRegs->addReg(LivePhysReg);
-    }
-  }
-}
-
-std::vector<llvm::MachineBasicBlock::RegisterMaskPair> computeAndAddLiveIns(
-    llvm::LivePhysRegs &LiveRegs, VectorMBB &MBB,
-    llvm::DenseMap<const llvm::MachineInstr *,
-                   std::unique_ptr<llvm::LivePhysRegs>> &PerMILiveIns) {
-  luthier::computeLiveIns(LiveRegs, MBB, PerMILiveIns);
+  LPR.init(TRI);
+  luthier::addLiveOutsNoPristines(LPR, MBB);
+  for (const llvm::MachineInstr &MI : llvm::reverse(MBB))
+    LPR.stepBackward(MI);
   std::vector<llvm::MachineBasicBlock::RegisterMaskPair> OldLiveIns;
   // Clear out the live-ins before adding the new ones
   // This ensures correct live-out information calculations in loops i.e.
   // where the MBB is a successor/predecessor of itself
   MBB.clearLiveIns(OldLiveIns);
-  luthier::addLiveIns(MBB, LiveRegs);
-  return OldLiveIns;
-}
-
-///// Convenience function for recomputing live-in's for a MBB
-///// \return \c true if any changes were made.
-static bool recomputeLiveIns(
-    VectorMBB &VectorMBB,
-    llvm::DenseMap<const llvm::MachineInstr *,
-                   std::unique_ptr<llvm::LivePhysRegs>> &PerMILiveIns) {
-  llvm::LivePhysRegs LPR;
-
-  auto OldLiveIns = luthier::computeAndAddLiveIns(LPR, VectorMBB, PerMILiveIns);
-  VectorMBB.sortUniqueLiveIns();
-
-  const std::vector<llvm::MachineBasicBlock::RegisterMaskPair> &NewLiveIns =
-      VectorMBB.getLiveIns();
-  return OldLiveIns != NewLiveIns;
+  luthier::addLiveIns(MBB, LPR);
+  MBB.sortUniqueLiveIns();
+  return OldLiveIns != MBB.getLiveIns();
 }
 
-static void recomputeLiveIns(
-    VectorCFG &CFG,
-    llvm::DenseMap<const llvm::MachineInstr *,
-                   std::unique_ptr<llvm::LivePhysRegs>> &PerMILiveIns) {
+static void recomputeLiveIns(VectorCFG &CFG, llvm::LivePhysRegs &LPR) {
   while (true) {
     bool AnyChange = false;
     for (auto &[MBB, SMBB] : CFG) {
       for (auto &VectorMBB : *SMBB)
-        if (luthier::recomputeLiveIns(*VectorMBB, PerMILiveIns))
+        if (luthier::recomputeLiveIns(*VectorMBB, LPR))
           AnyChange = true;
     }
-    if (luthier::recomputeLiveIns(CFG.getEntryBlock(), PerMILiveIns))
+    if (luthier::recomputeLiveIns(CFG.getEntryBlock(), LPR))
       AnyChange = true;
-    if (luthier::recomputeLiveIns(CFG.getExitBlock(), PerMILiveIns))
+    if (luthier::recomputeLiveIns(CFG.getExitBlock(), LPR))
       AnyChange = true;
     if (!AnyChange)
       return;
   }
 }
 
+/// \return a dense bit vector indexed by physical register number with the
+/// registers in \p LPR set
+static llvm::BitVector toBitVector(const llvm::LivePhysRegs &LPR,
+                                   const llvm::TargetRegisterInfo &TRI) {
+  llvm::BitVector Out(TRI.getNumRegs());
+  for (llvm::MCPhysReg Reg : LPR)
+    Out.set(Reg);
+  return Out;
+}
+
+/// Re-initializes \p LPR to hold the registers set in \p Regs
+static void initFromBitVector(llvm::LivePhysRegs &LPR,
+                              const llvm::BitVector &Regs,
+                              const llvm::TargetRegisterInfo &TRI) {
+  LPR.init(TRI);
+  // Live register sets are closed under sub-registers, hence adding each
+  // register along with its sub-registers re-creates the exact same set
+  for (unsigned int Reg : Regs.set_bits())
+    LPR.addReg(Reg);
+}
+
+void AMDGPURegisterLiveness::recordVectorMBBLiveness(const VectorMBB &MBB,
+                                                     llvm::LivePhysRegs &LPR) {
+  if (MBB.empty())
+    return;
+  auto &TRI = *MBB.getParent().getMF().getSubtarget().getRegisterInfo();
+  LPR.init(TRI);
+  luthier::addLiveOutsNoPristines(LPR, MBB);
+  VectorMBBLiveOuts.insert({&MBB, toBitVector(LPR, TRI)});
+  unsigned int NumInstrs = 0;
+  for (const llvm::MachineInstr &MI : llvm::reverse(MBB)) {
+    MachineInstrVectorMBBMap.insert({&MI, &MBB});
+    LPR.stepBackward(MI);
+    if (++NumInstrs % CheckpointInterval == 0)
+      LivenessCheckpoints.insert({&MI, toBitVector(LPR, TRI)});
+  }
+}
+
 AMDGPURegisterLiveness::AMDGPURegisterLiveness(
     const llvm::Module &M, const llvm::MachineModuleInfo &MMI,
     const LRCallGraph &CG)
     : CG(CG) {
   llvm::TimeTraceScope Scope("Liveness Analysis Computation");
+  llvm::LivePhysRegs LPR;
   for (const auto &F : M) {
     auto *MF = MMI.getMachineFunction(F);
     if (!MF)
       continue;
     auto VecCFG = luthier::VectorCFG::getVectorCFG(*MF);
-    // TODO: remove liveness vectors from VectorMBBs and use a
-    // map inside this pass instead
-    luthier::recomputeLiveIns(*VecCFG, MachineInstrLivenessMap);
+    luthier::recomputeLiveIns(*VecCFG, LPR);
+    for (const auto &[MBB, SMBB] : *VecCFG) {
+      for (const auto &VectorMBB : *SMBB)
+        recordVectorMBBLiveness(*VectorMBB, LPR);
+    }
 
     LLVM_DEBUG(VecCFG->print(llvm::dbgs()););
+    VectorCFGs.insert({MF, std::move(VecCFG)});
+  }
+  LLVM_DEBUG(llvm::dbgs() << "Recorded " << LivenessCheckpoints.size()
+                          << " liveness checkpoints for "
+                          << MachineInstrVectorMBBMap.size()
+                          << " machine instructions.\n";);
+}
+
+const llvm::LivePhysRegs *
+AMDGPURegisterLiveness::getMFLevelInstrLiveIns(
+    const llvm::MachineInstr &MI) const {
+  if (SrcLiveness) {
+    auto SrcMIIt = DstToSrcMIMap->find(&MI);
+    return SrcMIIt == DstToSrcMIMap->end()
+               ? nullptr
+               : SrcLiveness->getMFLevelInstrLiveIns(*SrcMIIt->second);
+  }
+  auto CacheIt = llvm::find_if(
+      QueryCache, [&](const auto &Entry) { return Entry.first == &MI; });
+  if (CacheIt != QueryCache.end()) {
+    std::rotate(QueryCache.begin(), CacheIt, std::next(CacheIt));
+    return QueryCache.front().second.get();
+  }
+  auto MBBIt = MachineInstrVectorMBBMap.find(&MI);
+  if (MBBIt == MachineInstrVectorMBBMap.end())
+    return nullptr;
+  const VectorMBB &MBB = *MBBIt->second;
+  auto &TRI = *MBB.getParent().getMF().getSubtarget().getRegisterInfo();
+
+  // Re-use the set of the least recently used cache entry if the cache is full
+  std::unique_ptr<llvm::LivePhysRegs> LPR;
+  if (QueryCache.size() == QueryCacheSize) {
+    LPR = std::move(QueryCache.back().second);
+    QueryCache.pop_back();
+  } else
+    LPR = std::make_unique<llvm::LivePhysRegs>();
+
+  // Find the closest checkpoint at or after MI, or the end of its block
+  llvm::MachineBasicBlock::const_iterator MIIt(MI);
+  llvm::MachineBasicBlock::const_iterator It = MIIt;
+  const llvm::BitVector *StartingLiveRegs = nullptr;
+  for (; It != MBB.end(); ++It) {
+    auto CheckpointIt = LivenessCheckpoints.find(&*It);
+    if (CheckpointIt != LivenessCheckpoints.end()) {
+      StartingLiveRegs = &CheckpointIt->second;
+      break;
+    }
+  }
+  if (StartingLiveRegs == nullptr)
+    StartingLiveRegs = &VectorMBBLiveOuts.at(&MBB);
+  initFromBitVector(*LPR, *StartingLiveRegs, TRI);
+  // Step backwards until the live-ins of MI are reached; The checkpoint
+  // already accounts for the instruction it is attached to
+  while (It != MIIt) {
+    --It;
+    LPR->stepBackward(*It);
   }
+  QueryCache.insert(QueryCache.begin(), std::make_pair(&MI, std::move(LPR)));
+  return QueryCache.front().second.get();
 }
 
 llvm::AnalysisKey AMDGPURegLivenessAnalysis::Key;
@@ -123,6 +189,9 @@ llvm::AnalysisKey AMDGPURegLivenessAnalysis::Key;
 AMDGPURegLivenessAnalysis::Result
 AMDGPURegLivenessAnalysis::run(llvm::Module &M,
                                llvm::ModuleAnalysisManager &MAM) {
+  if (SrcLiveness)
+    return {*SrcLiveness, *DstToSrcMIMap,
+            MAM.getResult<LRCallGraphAnalysis>(M)};
   return {M, MAM.getResult<llvm::MachineModuleAnalysis>(M).getMMI(),
           MAM.getResult<LRCallGraphAnalysis>(M)};
 }
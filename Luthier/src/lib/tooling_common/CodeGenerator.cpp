@@ -26,6 +26,7 @@
 #include "luthier/tooling/AMDGPURegisterLiveness.h"
 #include "tooling_common/CodeLifter.hpp"
 #include "tooling_common/InjectedPayloadPEIPass.hpp"
+#include "tooling_common/KernelOccupancy.hpp"
 #include "tooling_common/MMISlotIndexesAnalysis.hpp"
 #include "tooling_common/PatchLiftedRepresentationPass.hpp"
 #include "tooling_common/PrePostAmbleEmitter.hpp"
@@ -41,6 +42,7 @@
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/TimeProfiler.h>
+#include <optional>
 
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "luthier-code-generator"
@@ -152,9 +154,9 @@ llvm::Error CodeGenerator::printAssembly(
   return llvm::Error::success();
 }
 
-llvm::Error
-CodeGenerator::applyInstrumentationTask(const InstrumentationTask &Task,
-                                        LiftedRepresentation &LR) {
+llvm::Error CodeGenerator::applyInstrumentationTask(
+    const InstrumentationTask &Task, LiftedRepresentation &LR,
+    const SourceLRAnalyses *SrcAnalyses) {
   // Early exit if no hooks are to be inserted into the LR
   if (Task.getHookInsertionTasks().empty())
     return llvm::Error::success();
@@ -211,10 +213,23 @@ CodeGenerator::applyInstrumentationTask(const InstrumentationTask &Task,
   TargetMAM.registerPass([&]() { return LiftedRepresentationAnalysis(LR); });
   // Add the LCO Analysis pass
   TargetMAM.registerPass([&]() { return LoadedCodeObjectAnalysis(LCO); });
-  // Add the LR Register Liveness pass
-  TargetMAM.registerPass([&]() { return AMDGPURegLivenessAnalysis(); });
-  // Add the LR Callgraph analysis pass
-  TargetMAM.registerPass([&]() { return LRCallGraphAnalysis(); });
+  // Add the LR Register Liveness pass; Re-use the liveness of the source
+  // representation if available
+  TargetMAM.registerPass([&]() {
+    return SrcAnalyses ? AMDGPURegLivenessAnalysis(SrcAnalyses->RegLiveness,
+                                                   SrcAnalyses->DstToSrcMIMap)
+                       : AMDGPURegLivenessAnalysis();
+  });
+  // Add the LR Callgraph analysis pass; Map the call graph of the source
+  // representation if available
+  TargetMAM.registerPass([&]() {
+    return SrcAnalyses ? LRCallGraphAnalysis(SrcAnalyses->CG,
+                                             SrcAnalyses->SrcToDstMFMap,
+                                             SrcAnalyses->SrcToDstMIMap)
+                       : LRCallGraphAnalysis();
+  });
+  // Add the occupancy budget analysis pass
+  TargetMAM.registerPass([&]() { return OccupancyBudgetAnalysis(Task); });
   // Add the MMI-wide Slot indexes analysis pass
   TargetMAM.registerPass([&]() { return MMISlotIndexesAnalysis(); });
   // Add the State Value Array storage and load analysis pass
@@ -240,25 +255,154 @@ CodeGenerator::applyInstrumentationTask(const InstrumentationTask &Task,
   return llvm::Error::success();
 }
 
+/// \return \c true if \p DstMI has the same opcode and register operands as
+/// \p SrcMI, meaning it has the same effect on register liveness
+static bool haveSameRegisterOperands(const llvm::MachineInstr &SrcMI,
+                                     const llvm::MachineInstr &DstMI) {
+  if (SrcMI.getOpcode() != DstMI.getOpcode() ||
+      SrcMI.getNumOperands() != DstMI.getNumOperands())
+    return false;
+  for (const auto &[SrcOp, DstOp] :
+       llvm::zip(SrcMI.operands(), DstMI.operands())) {
+    if (SrcOp.getType() != DstOp.getType())
+      return false;
+    if ((SrcOp.isReg() || SrcOp.isRegMask()) && !SrcOp.isIdenticalTo(DstOp))
+      return false;
+  }
+  return true;
+}
+
+/// \return \c true if \p DstMBB has the same live-in registers and its
+/// successors have the same numbers as the ones of \p SrcMBB, meaning the
+/// control flow and the live-ins used to compute register liveness are
+/// unchanged
+static bool haveSameCFGAndLiveIns(const llvm::MachineBasicBlock &SrcMBB,
+                                  const llvm::MachineBasicBlock &DstMBB) {
+  if (!llvm::equal(SrcMBB.successors(), DstMBB.successors(),
+                   [](const llvm::MachineBasicBlock *SrcSucc,
+                      const llvm::MachineBasicBlock *DstSucc) {
+                     return SrcSucc->getNumber() == DstSucc->getNumber();
+                   }))
+    return false;
+  return llvm::equal(SrcMBB.liveins(), DstMBB.liveins(),
+                     [](const llvm::MachineBasicBlock::RegisterMaskPair &Src,
+                        const llvm::MachineBasicBlock::RegisterMaskPair &Dst) {
+                       return Src.PhysReg == Dst.PhysReg &&
+                              Src.LaneMask == Dst.LaneMask;
+                     });
+}
+
+/// Checks if the machine code of a cloned lifted representation is still
+/// identical to the code of its source, and populates \p DstToSrcMIMap with
+/// the reverse of \p SrcToDstMIMap
+/// \return \c true if no instructions were added, removed, or had their
+/// register operands changed in the clone since cloning, and none of its
+/// blocks had their successors or live-ins changed, \c false otherwise
+static bool isUnmodifiedClone(
+    const llvm::DenseMap<const llvm::MachineFunction *,
+                         const llvm::MachineFunction *> &SrcToDstMFMap,
+    const llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+        &SrcToDstMIMap,
+    llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+        &DstToSrcMIMap) {
+  DstToSrcMIMap.reserve(SrcToDstMIMap.size());
+  for (const auto &[SrcMI, DstMI] : SrcToDstMIMap)
+    DstToSrcMIMap.insert({DstMI, SrcMI});
+  // Source instructions are never freed, hence they can be safely
+  // dereferenced; Clone instructions are only dereferenced when found
+  // inside the clone's MMI
+  size_t NumDstInstrs = 0;
+  for (const auto &[SrcMF, DstMF] : SrcToDstMFMap) {
+    if (SrcMF->size() != DstMF->size())
+      return false;
+    for (const auto &MBB : *DstMF) {
+      const llvm::MachineBasicBlock *SrcMBB =
+          SrcMF->getBlockNumbered(MBB.getNumber());
+      if (!SrcMBB || !haveSameCFGAndLiveIns(*SrcMBB, MBB))
+        return false;
+      for (const auto &DstMI : MBB) {
+        auto SrcMIIt = DstToSrcMIMap.find(&DstMI);
+        if (SrcMIIt == DstToSrcMIMap.end())
+          return false;
+        const llvm::MachineInstr &SrcMI = *SrcMIIt->second;
+        if (SrcMI.getParent()->getNumber() != MBB.getNumber() ||
+            !haveSameRegisterOperands(SrcMI, DstMI))
+          return false;
+        NumDstInstrs++;
+      }
+    }
+  }
+  return NumDstInstrs == SrcToDstMIMap.size();
+}
+
 llvm::Expected<std::unique_ptr<LiftedRepresentation>> CodeGenerator::instrument(
     const LiftedRepresentation &LR,
     llvm::function_ref<llvm::Error(InstrumentationTask &,
                                    LiftedRepresentation &)>
         Mutator) {
+  return instrument(LR, llvm::ArrayRef(Mutator));
+}
+
+llvm::Expected<std::unique_ptr<LiftedRepresentation>> CodeGenerator::instrument(
+    const LiftedRepresentation &LR,
+    llvm::ArrayRef<llvm::function_ref<llvm::Error(InstrumentationTask &,
+                                                  LiftedRepresentation &)>>
+        Mutators) {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      !Mutators.empty(), "No mutator was passed for instrumentation."));
   // Acquire the context lock for thread-safety
   auto Lock = LR.getLock();
+  auto &CL = CodeLifter::instance();
+  // Get the analyses of the lifted representation, which are only computed
+  // once and are then re-used by all its instrumented clones
+  const LRCallGraph *SrcCG;
+  const AMDGPURegisterLiveness *SrcRegLiveness;
+  LUTHIER_RETURN_ON_ERROR(CL.getCachedAnalyses(LR, SrcCG, SrcRegLiveness));
   std::unique_ptr<LiftedRepresentation> ClonedLR;
+  llvm::DenseMap<const llvm::MachineFunction *, const llvm::MachineFunction *>
+      SrcToDstMFMap;
+  llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+      SrcToDstMIMap;
   // Clone the Lifted Representation
   LUTHIER_RETURN_ON_ERROR(
-      CodeLifter::instance().cloneRepresentation(LR).moveInto(ClonedLR));
+      CL.cloneRepresentation(LR, &SrcToDstMFMap, &SrcToDstMIMap)
+          .moveInto(ClonedLR));
   // Create an instrumentation task to keep track of the hooks called before
   // each MI of the application
   InstrumentationTask IT(*ClonedLR);
-  // Run the mutator function on the Lifted Representation and populate the
-  // instrumentation task
-  LUTHIER_RETURN_ON_ERROR(Mutator(IT, *ClonedLR));
+  for (const auto &[I, Mutator] : llvm::enumerate(Mutators)) {
+    // Each mutator populates its own task, so that its options only apply to
+    // its own hooks; The first mutator populates the final task directly
+    std::optional<InstrumentationTask> MutatorIT;
+    if (I != 0)
+      MutatorIT.emplace(*ClonedLR);
+    InstrumentationTask &CurrentIT = MutatorIT ? *MutatorIT : IT;
+    // Run the mutator function on the Lifted Representation and populate the
+    // instrumentation task
+    LUTHIER_RETURN_ON_ERROR(Mutator(CurrentIT, *ClonedLR));
+    // Hoist the counting hooks out of counted loops if the mutator asked for
+    // it
+    if (CurrentIT.shouldHoistCountingHooks())
+      CurrentIT.hoistCountingHooksOutOfLoops();
+    if (MutatorIT)
+      LUTHIER_RETURN_ON_ERROR(IT.append(*MutatorIT));
+  }
+  // The cached analyses can only be re-used if the mutator did not modify
+  // the clone's machine code
+  llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+      DstToSrcMIMap;
+  std::optional<SourceLRAnalyses> SrcAnalyses;
+  if (SrcCG &&
+      isUnmodifiedClone(SrcToDstMFMap, SrcToDstMIMap, DstToSrcMIMap))
+    SrcAnalyses.emplace(SourceLRAnalyses{*SrcCG, *SrcRegLiveness,
+                                         SrcToDstMFMap, SrcToDstMIMap,
+                                         DstToSrcMIMap});
+  LLVM_DEBUG(llvm::dbgs() << "Re-using the analyses of the lifted "
+                             "representation for its clone: "
+                          << SrcAnalyses.has_value() << "\n";);
   // Apply the instrumentation task to the Lifted Representation
-  LUTHIER_RETURN_ON_ERROR(applyInstrumentationTask(IT, *ClonedLR));
+  LUTHIER_RETURN_ON_ERROR(applyInstrumentationTask(
+      IT, *ClonedLR, SrcAnalyses ? &*SrcAnalyses : nullptr));
 
   LLVM_DEBUG(
 
@@ -31,6 +31,7 @@
 #include "luthier/hsa/Instr.h"
 #include "luthier/hsa/KernelDescriptor.h"
 #include "luthier/llvm/streams.h"
+#include "luthier/tooling/AMDGPURegisterLiveness.h"
 #include "luthier/tooling/LRCallgraph.h"
 #include "luthier/types.h"
 #include "tooling_common/TargetManager.hpp"
@@ -528,6 +529,23 @@ CodeLifter::initLiftedKernelEntry(const hsa::LoadedCodeObjectKernel &Kernel,
     if (KCP.EnableSgprFlatScratchInit == 1) {
         MFI->addFlatScratchInit(*TRI);
     }
+    // System SGPRs are preloaded right after the user SGPRs in the order
+    // below; The workgroup IDs must be added before the private segment wave
+    // byte offset so that each of them is assigned its actual SGPR
+    bool HasArchitectedSGPRs =
+        MF.getSubtarget<llvm::GCNSubtarget>().hasArchitectedSGPRs();
+    if (Rsrc2.EnableSgprWorkgroupIdX == 1) {
+        MFI->addWorkGroupIDX(HasArchitectedSGPRs);
+    }
+    if (Rsrc2.EnableSgprWorkgroupIdY == 1) {
+        MFI->addWorkGroupIDY(HasArchitectedSGPRs);
+    }
+    if (Rsrc2.EnableSgprWorkgroupIdZ == 1) {
+        MFI->addWorkGroupIDZ(HasArchitectedSGPRs);
+    }
+    if (Rsrc2.EnableSgprInfo == 1) {
+        MFI->addWorkGroupInfo();
+    }
     if (Rsrc2.EnableSgprPrivateSegmentWaveByteOffset == 1) {
         MFI->addPrivateSegmentWaveByteOffset();
     }
@@ -1105,8 +1123,38 @@ luthier::CodeLifter::lift(const hsa::LoadedCodeObjectKernel &KernelSymbol) {
     return *LiftedKernelSymbols.find(&KernelSymbol)->second;
 }
 
+llvm::Error CodeLifter::getCachedAnalyses(
+    const LiftedRepresentation &LR, const LRCallGraph *&CG,
+    const AMDGPURegisterLiveness *&RegLiveness) {
+    std::lock_guard Lock(CacheMutex);
+    CG = nullptr;
+    RegLiveness = nullptr;
+    // Only representations cached by the lifter are guaranteed to never be
+    // modified; The analysis of others cannot be safely re-used
+    auto LRIt = LiftedKernelSymbols.find(LR.Kernel.get());
+    if (LRIt == LiftedKernelSymbols.end() || LRIt->second.get() != &LR)
+        return llvm::Error::success();
+    auto LRLock = LR.getLock();
+    if (!LR.CallGraph) {
+        llvm::TimeTraceScope Scope("Lifted Representation Analysis Caching");
+        auto NewCG = std::make_unique<LRCallGraph>();
+        LUTHIER_RETURN_ON_ERROR(NewCG->analyse(*LR.Module, LR.getMMI()));
+        LR.RegLiveness = std::make_unique<AMDGPURegisterLiveness>(
+            *LR.Module, LR.getMMI(), *NewCG);
+        LR.CallGraph = std::move(NewCG);
+    }
+    CG = LR.CallGraph.get();
+    RegLiveness = LR.RegLiveness.get();
+    return llvm::Error::success();
+}
+
 llvm::Expected<std::unique_ptr<LiftedRepresentation>>
-CodeLifter::cloneRepresentation(const LiftedRepresentation &SrcLR) {
+CodeLifter::cloneRepresentation(
+    const LiftedRepresentation &SrcLR,
+    llvm::DenseMap<const llvm::MachineFunction *, const llvm::MachineFunction *>
+        *SrcToDstMFMap,
+    llvm::DenseMap<const llvm::MachineInstr *, const llvm::MachineInstr *>
+        *SrcToDstMIMap) {
     llvm::TimeTraceScope ProfilerScope("Lifted Representation Cloning");
     // Since we're going to use the SrcLR's context, acquire its lock
     auto Lock = SrcLR.getLock();
@@ -1183,6 +1231,21 @@ CodeLifter::cloneRepresentation(const LiftedRepresentation &SrcLR) {
     for (const auto &[SrcMI, HSAInst] : SrcLR.MachineInstrToMCMap) {
         DestLR->MachineInstrToMCMap.insert({SrcToDstInstrMap[SrcMI], HSAInst});
     }
+    if (SrcToDstMIMap) {
+        SrcToDstMIMap->reserve(SrcToDstInstrMap.size());
+        for (const auto &[SrcMI, DstMI] : SrcToDstInstrMap)
+            SrcToDstMIMap->insert({SrcMI, DstMI});
+    }
+    if (SrcToDstMFMap) {
+        for (const auto &SrcF : SrcModule) {
+            auto *SrcMF = SrcMMI.getMachineFunction(SrcF);
+            if (!SrcMF)
+                continue;
+            auto *DstF = cast<llvm::Function>(VMap[&SrcF]);
+            SrcToDstMFMap->insert(
+                {SrcMF, DestLR->getMMI().getMachineFunction(*DstF)});
+        }
+    }
 
     return DestLR;
 }
@@ -0,0 +1,371 @@
+//===-- CountedLoops.cpp --------------------------------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file implements the \c findCountedLoops function.
+//===----------------------------------------------------------------------===//
+#include <SIInstrInfo.h>
+#include <llvm/CodeGen/MachineFunction.h>
+#include <llvm/CodeGen/MachineLoopInfo.h>
+#include <llvm/Support/Debug.h>
+#include <luthier/tooling/CountedLoops.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-counted-loops"
+
+namespace luthier {
+
+/// Sign or zero extends the lower 32 bits of \p Value
+static int64_t extend32BitValue(int64_t Value, bool IsSigned) {
+  return IsSigned ? static_cast<int64_t>(static_cast<int32_t>(Value))
+                  : static_cast<int64_t>(static_cast<uint32_t>(Value));
+}
+
+std::optional<uint64_t> LoopTripCount::getConstantTripCount() const {
+  if (!std::holds_alternative<int64_t>(Init) ||
+      !std::holds_alternative<int64_t>(Bound))
+    return std::nullopt;
+  bool IsSigned = llvm::CmpInst::isSigned(ContinuePredicate);
+  int64_t InitVal = extend32BitValue(std::get<int64_t>(Init), IsSigned);
+  int64_t BoundVal = extend32BitValue(std::get<int64_t>(Bound), IsSigned);
+  // Distance the induction register has to travel before the loop exits
+  int64_t Distance;
+  switch (ContinuePredicate) {
+  case llvm::CmpInst::ICMP_NE:
+    Distance = static_cast<uint32_t>(Step > 0 ? BoundVal - InitVal
+                                              : InitVal - BoundVal);
+    break;
+  case llvm::CmpInst::ICMP_ULT:
+  case llvm::CmpInst::ICMP_SLT:
+    Distance = BoundVal - InitVal;
+    break;
+  case llvm::CmpInst::ICMP_ULE:
+  case llvm::CmpInst::ICMP_SLE:
+    Distance = BoundVal - InitVal + 1;
+    break;
+  case llvm::CmpInst::ICMP_UGT:
+  case llvm::CmpInst::ICMP_SGT:
+    Distance = InitVal - BoundVal;
+    break;
+  case llvm::CmpInst::ICMP_UGE:
+  case llvm::CmpInst::ICMP_SGE:
+    Distance = InitVal - BoundVal + 1;
+    break;
+  default:
+    llvm_unreachable("Invalid loop continue predicate");
+  }
+  // The latch is always reached at least once
+  if (Distance <= 0)
+    return 1;
+  return llvm::divideCeil(static_cast<uint64_t>(Distance),
+                          static_cast<uint64_t>(std::abs(Step)));
+}
+
+/// \return the predicate and the size of the immediate of the scalar compare
+/// \p Opcode, or \c std::nullopt if \p Opcode is not a supported compare
+static std::optional<std::pair<llvm::CmpInst::Predicate, bool>>
+getScalarComparePredicate(unsigned int Opcode) {
+  using llvm::CmpInst;
+  switch (Opcode) {
+  case llvm::AMDGPU::S_CMP_EQ_U32:
+  case llvm::AMDGPU::S_CMP_EQ_I32:
+    return std::make_pair(CmpInst::ICMP_EQ, false);
+  case llvm::AMDGPU::S_CMPK_EQ_U32:
+  case llvm::AMDGPU::S_CMPK_EQ_I32:
+    return std::make_pair(CmpInst::ICMP_EQ, true);
+  case llvm::AMDGPU::S_CMP_LG_U32:
+  case llvm::AMDGPU::S_CMP_LG_I32:
+    return std::make_pair(CmpInst::ICMP_NE, false);
+  case llvm::AMDGPU::S_CMPK_LG_U32:
+  case llvm::AMDGPU::S_CMPK_LG_I32:
+    return std::make_pair(CmpInst::ICMP_NE, true);
+  case llvm::AMDGPU::S_CMP_LT_U32:
+    return std::make_pair(CmpInst::ICMP_ULT, false);
+  case llvm::AMDGPU::S_CMP_LT_I32:
+    return std::make_pair(CmpInst::ICMP_SLT, false);
+  case llvm::AMDGPU::S_CMPK_LT_U32:
+    return std::make_pair(CmpInst::ICMP_ULT, true);
+  case llvm::AMDGPU::S_CMPK_LT_I32:
+    return std::make_pair(CmpInst::ICMP_SLT, true);
+  case llvm::AMDGPU::S_CMP_LE_U32:
+    return std::make_pair(CmpInst::ICMP_ULE, false);
+  case llvm::AMDGPU::S_CMP_LE_I32:
+    return std::make_pair(CmpInst::ICMP_SLE, false);
+  case llvm::AMDGPU::S_CMPK_LE_U32:
+    return std::make_pair(CmpInst::ICMP_ULE, true);
+  case llvm::AMDGPU::S_CMPK_LE_I32:
+    return std::make_pair(CmpInst::ICMP_SLE, true);
+  case llvm::AMDGPU::S_CMP_GT_U32:
+    return std::make_pair(CmpInst::ICMP_UGT, false);
+  case llvm::AMDGPU::S_CMP_GT_I32:
+    return std::make_pair(CmpInst::ICMP_SGT, false);
+  case llvm::AMDGPU::S_CMPK_GT_U32:
+    return std::make_pair(CmpInst::ICMP_UGT, true);
+  case llvm::AMDGPU::S_CMPK_GT_I32:
+    return std::make_pair(CmpInst::ICMP_SGT, true);
+  case llvm::AMDGPU::S_CMP_GE_U32:
+    return std::make_pair(CmpInst::ICMP_UGE, false);
+  case llvm::AMDGPU::S_CMP_GE_I32:
+    return std::make_pair(CmpInst::ICMP_SGE, false);
+  case llvm::AMDGPU::S_CMPK_GE_U32:
+    return std::make_pair(CmpInst::ICMP_UGE, true);
+  case llvm::AMDGPU::S_CMPK_GE_I32:
+    return std::make_pair(CmpInst::ICMP_SGE, true);
+  default:
+    return std::nullopt;
+  }
+}
+
+/// \return the immediate value of \p MO if it is an immediate operand of a
+/// scalar compare, extended from 16 bits if \p IsImm16
+static int64_t getCompareImmediate(const llvm::MachineOperand &MO,
+                                   bool IsImm16, bool IsSigned) {
+  if (!IsImm16)
+    return extend32BitValue(MO.getImm(), IsSigned);
+  return IsSigned ? static_cast<int64_t>(static_cast<int16_t>(MO.getImm()))
+                  : static_cast<int64_t>(static_cast<uint16_t>(MO.getImm()));
+}
+
+/// Checks if \p MI increments \p Reg by a constant amount
+/// \return the amount \p Reg is incremented by, or \c std::nullopt if
+/// \p MI is not a supported increment of \p Reg
+static std::optional<int64_t> getInductionStep(const llvm::MachineInstr &MI,
+                                               llvm::MCRegister Reg) {
+  unsigned int Opcode = MI.getOpcode();
+  bool IsAdd = Opcode == llvm::AMDGPU::S_ADD_U32 ||
+               Opcode == llvm::AMDGPU::S_ADD_I32 ||
+               Opcode == llvm::AMDGPU::S_ADDK_I32;
+  bool IsSub = Opcode == llvm::AMDGPU::S_SUB_U32 ||
+               Opcode == llvm::AMDGPU::S_SUB_I32;
+  if (!IsAdd && !IsSub)
+    return std::nullopt;
+  if (!MI.getOperand(0).isReg() || MI.getOperand(0).getReg() != Reg)
+    return std::nullopt;
+  auto Uses = MI.explicit_uses();
+  if (std::distance(Uses.begin(), Uses.end()) != 2)
+    return std::nullopt;
+  const llvm::MachineOperand &Src0 = *Uses.begin();
+  const llvm::MachineOperand &Src1 = *std::next(Uses.begin());
+  const llvm::MachineOperand *ImmOp;
+  if (Src0.isReg() && Src0.getReg() == Reg && Src1.isImm())
+    ImmOp = &Src1;
+  else if (IsAdd && Src1.isReg() && Src1.getReg() == Reg && Src0.isImm())
+    ImmOp = &Src0;
+  else
+    return std::nullopt;
+  int64_t Step = Opcode == llvm::AMDGPU::S_ADDK_I32
+                     ? static_cast<int16_t>(ImmOp->getImm())
+                     : static_cast<int32_t>(ImmOp->getImm());
+  if (Step == 0)
+    return std::nullopt;
+  return IsSub ? -Step : Step;
+}
+
+/// Resolves \p Value, an operand of a \c LoopTripCount, so that reading it
+/// before the \p PreheaderInsertionPoint yields its value on loop entry
+/// \return \c false if the register of \p Value is modified at or after the
+/// insertion point in a way that cannot be tracked, \c true otherwise
+static bool
+resolveValueOnLoopEntry(std::variant<int64_t, llvm::MCRegister> &Value,
+                        const llvm::MachineInstr &PreheaderInsertionPoint,
+                        const llvm::TargetRegisterInfo &TRI) {
+  if (!std::holds_alternative<llvm::MCRegister>(Value))
+    return true;
+  llvm::MCRegister Reg = std::get<llvm::MCRegister>(Value);
+  const llvm::MachineBasicBlock &Preheader =
+      *PreheaderInsertionPoint.getParent();
+  for (auto It = PreheaderInsertionPoint.getIterator(); It != Preheader.end();
+       ++It) {
+    if (!It->modifiesRegister(Reg, &TRI))
+      continue;
+    // Allow the insertion point itself to set the register to an immediate,
+    // e.g. when the preheader falls through to the header right after
+    // initializing the induction register
+    if (&*It == &PreheaderInsertionPoint &&
+        It->getOpcode() == llvm::AMDGPU::S_MOV_B32 &&
+        It->getOperand(0).getReg() == Reg && It->getOperand(1).isImm()) {
+      Value = It->getOperand(1).getImm();
+      continue;
+    }
+    return false;
+  }
+  return true;
+}
+
+/// Analyzes \p Loop
+/// \return the \c CountedLoop describing \p Loop, or \c std::nullopt if
+/// \p Loop is not a counted loop
+static std::optional<CountedLoop>
+analyzeLoop(const llvm::MachineLoop &Loop,
+            const llvm::DomTreeBase<llvm::MachineBasicBlock> &DT,
+            const llvm::LoopInfoBase<llvm::MachineBasicBlock,
+                                     llvm::MachineLoop> &LI,
+            const llvm::TargetRegisterInfo &TRI) {
+  llvm::MachineBasicBlock *Latch = Loop.getLoopLatch();
+  llvm::MachineBasicBlock *Preheader = Loop.getLoopPreheader();
+  if (!Latch || !Preheader || Loop.getExitingBlock() != Latch)
+    return std::nullopt;
+
+  CountedLoop Out;
+  Out.Header = Loop.getHeader();
+  for (llvm::MachineBasicBlock *MBB : Loop.blocks()) {
+    for (const auto &MI : *MBB) {
+      if (MI.isCall() || MI.modifiesRegister(llvm::AMDGPU::EXEC, &TRI))
+        return std::nullopt;
+    }
+    if (LI.getLoopFor(MBB) == &Loop && DT.dominates(MBB, Latch))
+      Out.BlocksExecutedOncePerIteration.push_back(MBB);
+  }
+
+  // Find the conditional branch of the latch and the compare feeding it
+  auto FirstTerm = Latch->getFirstTerminator();
+  if (FirstTerm == Latch->end())
+    return std::nullopt;
+  const llvm::MachineInstr &CondBr = *FirstTerm;
+  if (CondBr.getOpcode() != llvm::AMDGPU::S_CBRANCH_SCC0 &&
+      CondBr.getOpcode() != llvm::AMDGPU::S_CBRANCH_SCC1)
+    return std::nullopt;
+  bool ContinuesOnBranch = CondBr.getOperand(0).getMBB() == Out.Header;
+  bool ContinuesOnSCC1 =
+      (CondBr.getOpcode() == llvm::AMDGPU::S_CBRANCH_SCC1) == ContinuesOnBranch;
+
+  const llvm::MachineInstr *Cmp{nullptr};
+  for (auto It = FirstTerm; It != Latch->begin();) {
+    --It;
+    if (It->modifiesRegister(llvm::AMDGPU::SCC, &TRI)) {
+      Cmp = &*It;
+      break;
+    }
+  }
+  if (!Cmp)
+    return std::nullopt;
+  auto PredAndImmSize = getScalarComparePredicate(Cmp->getOpcode());
+  if (!PredAndImmSize)
+    return std::nullopt;
+  auto [Pred, IsImm16] = *PredAndImmSize;
+  bool IsSigned = llvm::CmpInst::isSigned(Pred);
+  auto Uses = Cmp->explicit_uses();
+  if (std::distance(Uses.begin(), Uses.end()) != 2)
+    return std::nullopt;
+  const llvm::MachineOperand &LHS = *Uses.begin();
+  const llvm::MachineOperand &RHS = *std::next(Uses.begin());
+
+  // Finds the only definition of Reg inside the loop, if it is an increment
+  // executed once per iteration
+  auto GetStep = [&](const llvm::MachineOperand &MO) -> std::optional<int64_t> {
+    if (!MO.isReg())
+      return std::nullopt;
+    std::optional<int64_t> Step;
+    for (llvm::MachineBasicBlock *MBB : Loop.blocks()) {
+      for (const auto &MI : *MBB) {
+        if (!MI.modifiesRegister(MO.getReg(), &TRI))
+          continue;
+        if (Step || !llvm::is_contained(Out.BlocksExecutedOncePerIteration,
+                                        MI.getParent()))
+          return std::nullopt;
+        Step = getInductionStep(MI, MO.getReg());
+        if (!Step)
+          return std::nullopt;
+      }
+    }
+    return Step;
+  };
+
+  const llvm::MachineOperand *BoundOp;
+  std::optional<int64_t> Step = GetStep(LHS);
+  if (Step) {
+    BoundOp = &RHS;
+    Out.TripCount.InductionReg = LHS.getReg();
+  } else if ((Step = GetStep(RHS))) {
+    BoundOp = &LHS;
+    Out.TripCount.InductionReg = RHS.getReg();
+    Pred = llvm::CmpInst::getSwappedPredicate(Pred);
+  } else
+    return std::nullopt;
+  if (!ContinuesOnSCC1)
+    Pred = llvm::CmpInst::getInversePredicate(Pred);
+  Out.TripCount.Step = *Step;
+  Out.TripCount.ContinuePredicate = Pred;
+  bool IsIncreasing = *Step > 0;
+  bool IsValidPredicate =
+      Pred == llvm::CmpInst::ICMP_NE ||
+      (IsIncreasing && (Pred == llvm::CmpInst::ICMP_ULT ||
+                        Pred == llvm::CmpInst::ICMP_SLT ||
+                        Pred == llvm::CmpInst::ICMP_ULE ||
+                        Pred == llvm::CmpInst::ICMP_SLE)) ||
+      (!IsIncreasing && (Pred == llvm::CmpInst::ICMP_UGT ||
+                         Pred == llvm::CmpInst::ICMP_SGT ||
+                         Pred == llvm::CmpInst::ICMP_UGE ||
+                         Pred == llvm::CmpInst::ICMP_SGE));
+  if (!IsValidPredicate)
+    return std::nullopt;
+
+  // The bound must be loop invariant
+  if (BoundOp->isImm())
+    Out.TripCount.Bound = getCompareImmediate(*BoundOp, IsImm16, IsSigned);
+  else if (BoundOp->isReg()) {
+    for (llvm::MachineBasicBlock *MBB : Loop.blocks())
+      for (const auto &MI : *MBB)
+        if (MI.modifiesRegister(BoundOp->getReg(), &TRI))
+          return std::nullopt;
+    Out.TripCount.Bound = llvm::MCRegister(BoundOp->getReg());
+  } else
+    return std::nullopt;
+  Out.TripCount.Init = Out.TripCount.InductionReg;
+
+  // Find where code can be inserted in the preheader; The exec mask must
+  // not change between the insertion point and the loop
+  auto PreheaderTerm = Preheader->getFirstTerminator();
+  if (PreheaderTerm != Preheader->end())
+    Out.PreheaderInsertionPoint = &*PreheaderTerm;
+  else if (!Preheader->empty())
+    Out.PreheaderInsertionPoint = &Preheader->back();
+  else
+    return std::nullopt;
+  for (auto It = Out.PreheaderInsertionPoint->getIterator();
+       It != Preheader->end(); ++It) {
+    if (It->modifiesRegister(llvm::AMDGPU::EXEC, &TRI))
+      return std::nullopt;
+  }
+  if (!resolveValueOnLoopEntry(Out.TripCount.Init,
+                               *Out.PreheaderInsertionPoint, TRI) ||
+      !resolveValueOnLoopEntry(Out.TripCount.Bound,
+                               *Out.PreheaderInsertionPoint, TRI))
+    return std::nullopt;
+  return Out;
+}
+
+void findCountedLoops(llvm::MachineFunction &MF,
+                      llvm::SmallVectorImpl<CountedLoop> &Loops) {
+  const auto &TRI = *MF.getSubtarget().getRegisterInfo();
+  llvm::DomTreeBase<llvm::MachineBasicBlock> DT;
+  DT.recalculate(MF);
+  llvm::LoopInfoBase<llvm::MachineBasicBlock, llvm::MachineLoop> LI;
+  LI.analyze(DT);
+  // Reverse pre-order visits inner loops before their parents
+  for (const llvm::MachineLoop *Loop : llvm::reverse(LI.getLoopsInPreorder())) {
+    if (auto CL = analyzeLoop(*Loop, DT, LI, TRI)) {
+      LLVM_DEBUG(llvm::dbgs()
+                     << "Found counted loop with header bb."
+                     << CL->Header->getNumber() << " in " << MF.getName()
+                     << ", constant trip count: "
+                     << CL->TripCount.getConstantTripCount().value_or(0)
+                     << "\n";);
+      Loops.push_back(std::move(*CL));
+    }
+  }
+}
+
+} // namespace luthier
@@ -23,6 +23,9 @@
 #include "luthier/consts.h"
 #include "luthier/intrinsic/IntrinsicCalls.h"
 #include "luthier/tooling/InstrumentationTask.h"
+#include "tooling_common/KernelOccupancy.hpp"
+#include "tooling_common/WrapperAnalysisPasses.hpp"
+#include <llvm/ADT/StringExtras.h>
 #include <llvm/CodeGen/MachineBasicBlock.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
@@ -42,11 +45,61 @@ InjectedPayloadAndInstPointAnalysis::run(llvm::Module &M,
   return {};
 }
 
+/// Emits code calculating the trip count of a counted loop described by
+/// \p TripCount, to be run at the loop's preheader
+/// \return the trip count of the loop as a 64-bit integer
+static llvm::Value *emitLoopTripCount(llvm::Module &IModule,
+                                      llvm::IRBuilderBase &Builder,
+                                      const LoopTripCount &TripCount) {
+  auto *Int32Ty = Builder.getInt32Ty();
+  auto *Int64Ty = Builder.getInt64Ty();
+  bool IsSigned = llvm::CmpInst::isSigned(TripCount.ContinuePredicate);
+  // Materializes an operand of the trip count as a 32-bit value
+  auto GetOperand =
+      [&](const std::variant<int64_t, llvm::MCRegister> &Op) -> llvm::Value * {
+    if (std::holds_alternative<int64_t>(Op))
+      return Builder.getInt32(static_cast<uint32_t>(std::get<int64_t>(Op)));
+    return insertCallToIntrinsic(IModule, Builder, "luthier::readReg",
+                                 *Int32Ty, std::get<llvm::MCRegister>(Op).id());
+  };
+  llvm::Value *Init = GetOperand(TripCount.Init);
+  llvm::Value *Bound = GetOperand(TripCount.Bound);
+  // Distance the induction register has to travel before the loop exits;
+  // Mirrors LoopTripCount::getConstantTripCount
+  llvm::Value *Distance;
+  switch (TripCount.ContinuePredicate) {
+  case llvm::CmpInst::ICMP_NE:
+    Distance = Builder.CreateZExt(TripCount.Step > 0
+                                      ? Builder.CreateSub(Bound, Init)
+                                      : Builder.CreateSub(Init, Bound),
+                                  Int64Ty);
+    break;
+  default: {
+    bool IsIncreasing = TripCount.Step > 0;
+    llvm::Value *From = Builder.CreateIntCast(IsIncreasing ? Init : Bound,
+                                              Int64Ty, IsSigned);
+    llvm::Value *To = Builder.CreateIntCast(IsIncreasing ? Bound : Init,
+                                            Int64Ty, IsSigned);
+    Distance = Builder.CreateSub(To, From);
+    if (!llvm::CmpInst::isStrictPredicate(TripCount.ContinuePredicate))
+      Distance = Builder.CreateAdd(Distance, Builder.getInt64(1));
+  }
+  }
+  uint64_t AbsStep = std::abs(TripCount.Step);
+  llvm::Value *Trips = Builder.CreateUDiv(
+      Builder.CreateAdd(Distance, Builder.getInt64(AbsStep - 1)),
+      Builder.getInt64(AbsStep));
+  // The latch is always reached at least once
+  return Builder.CreateSelect(
+      Builder.CreateICmpSGT(Distance, Builder.getInt64(0)), Trips,
+      Builder.getInt64(1));
+}
+
 static llvm::Expected<llvm::Function &> generateInjectedPayloadForApplicationMI(
     llvm::Module &IModule,
     llvm::ArrayRef<InstrumentationTask::hook_invocation_descriptor>
         HookInvocationSpecs,
-    const llvm::MachineInstr &ApplicationMI) {
+    const llvm::MachineInstr &ApplicationMI, unsigned int MinWavesPerEU) {
   auto &LLVMContext = IModule.getContext();
   // Create an empty function to house the code injected before the
   // target application MI
@@ -70,6 +123,11 @@ static llvm::Expected<llvm::Function &> generateInjectedPayloadForApplicationMI(
   // Set an attribute indicating that this is the top-level function for an
   // injected payload
   InjectedPayload->addFnAttr(InjectedPayloadAttribute);
+  // Limit the registers allocated to the payload to stay within the
+  // occupancy budget; The register allocator will spill the rest
+  if (MinWavesPerEU != 0)
+    InjectedPayload->addFnAttr("amdgpu-waves-per-eu",
+                               llvm::utostr(MinWavesPerEU));
 
   LLVM_DEBUG(
 
@@ -94,6 +152,12 @@ static llvm::Expected<llvm::Function &> generateInjectedPayloadForApplicationMI(
         HookFunc != nullptr,
         "Failed to find hook {0} inside the instrumentation module.",
         HookInvSpec.HookName));
+    // If the hook was hoisted out of a loop, calculate the loop's trip count
+    // to scale its count arguments with
+    llvm::Value *TripCount =
+        HookInvSpec.CountMultiplier
+            ? emitLoopTripCount(IModule, Builder, *HookInvSpec.CountMultiplier)
+            : nullptr;
     // Construct the operands of the hook call
     llvm::SmallVector<llvm::Value *, 4> Operands;
     for (const auto &[Idx, Op] : llvm::enumerate(HookInvSpec.Args)) {
@@ -105,6 +169,14 @@ static llvm::Expected<llvm::Function &> generateInjectedPayloadForApplicationMI(
             *HookFunc->getArg(Idx)->getType(),
             std::get<llvm::MCRegister>(Op).id());
         Operands.push_back(ReadRegVal);
+      } else if (TripCount && llvm::is_contained(HookInvSpec.CountArgIndices,
+                                                 Idx)) {
+        // Scale the count argument by the trip count of the loop
+        auto *Count = std::get<llvm::Constant *>(Op);
+        auto *ScaledCount = Builder.CreateMul(
+            TripCount, Builder.CreateZExtOrTrunc(Count, TripCount->getType()));
+        Operands.push_back(
+            Builder.CreateZExtOrTrunc(ScaledCount, Count->getType()));
       } else {
         // Otherwise it's a constant, we can just pass it directly
         Operands.push_back(std::get<llvm::Constant *>(Op));
@@ -122,13 +194,18 @@ static llvm::Expected<llvm::Function &> generateInjectedPayloadForApplicationMI(
 llvm::PreservedAnalyses
 IModuleIRGeneratorPass::run(llvm::Module &M, llvm::ModuleAnalysisManager &MAM) {
   auto &IPIP = MAM.getResult<InjectedPayloadAndInstPointAnalysis>(M);
+  auto &TargetAppRes = MAM.getResult<TargetAppModuleAndMAMAnalysis>(M);
+  const auto &Budget =
+      TargetAppRes.getTargetAppMAM().getResult<OccupancyBudgetAnalysis>(
+          TargetAppRes.getTargetAppModule());
   llvm::TimeTraceScope Scope("Instrumentation Module IR Generation");
   // Generate and populate the injected payload functions in the
   // instrumentation module and keep track of them inside the map
   for (const auto &[ApplicationMI, HookSpecs] : Task.getHookInsertionTasks()) {
     // Generate the Hooks for each MI
     auto HookFunc =
-        generateInjectedPayloadForApplicationMI(M, HookSpecs, *ApplicationMI);
+        generateInjectedPayloadForApplicationMI(M, HookSpecs, *ApplicationMI,
+                                                Budget.getMinWavesPerEU());
     if (auto Err = HookFunc.takeError()) {
       M.getContext().emitError(llvm::toString(std::move(Err)));
       return llvm::PreservedAnalyses::all();
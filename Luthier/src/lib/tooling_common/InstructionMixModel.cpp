@@ -0,0 +1,192 @@
+//===-- InstructionMixModel.cpp -------------------------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file implements the \c InstructionMixModel class.
+//===----------------------------------------------------------------------===//
+#include <SIInstrInfo.h>
+#include <llvm/ADT/MapVector.h>
+#include <llvm/CodeGen/MachineFunction.h>
+#include <llvm/Support/Debug.h>
+#include <luthier/common/ErrorCheck.h>
+#include <luthier/common/LuthierError.h>
+#include <luthier/llvm/CodeGenHelpers.h>
+#include <luthier/tooling/InstructionMixModel.h>
+#include <luthier/tooling/LiftedRepresentation.h>
+#include <luthier/tooling/UniformExecRegions.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-instruction-mix-model"
+
+namespace luthier {
+
+llvm::StringRef getInstructionCategoryName(InstructionCategory Category) {
+  switch (Category) {
+  case InstructionCategory::ScalarALU:
+    return "Scalar ALU";
+  case InstructionCategory::ScalarMemory:
+    return "Scalar Memory";
+  case InstructionCategory::VectorALU:
+    return "Vector ALU";
+  case InstructionCategory::VectorMemory:
+    return "Vector Memory";
+  case InstructionCategory::LDS:
+    return "LDS";
+  case InstructionCategory::ProgramControl:
+    return "Program Control";
+  case InstructionCategory::Export:
+    return "Export";
+  default:
+    return "Other";
+  }
+}
+
+/// \return the \c InstructionCategory of \p MI
+static InstructionCategory
+getInstructionCategory(const llvm::MachineInstr &MI) {
+  if (MI.isBranch() || MI.isCall() || MI.isReturn() ||
+      llvm::SIInstrInfo::isSOPP(MI))
+    return InstructionCategory::ProgramControl;
+  if (llvm::SIInstrInfo::isSMRD(MI))
+    return InstructionCategory::ScalarMemory;
+  if (llvm::SIInstrInfo::isSALU(MI))
+    return InstructionCategory::ScalarALU;
+  if (llvm::SIInstrInfo::isDS(MI))
+    return InstructionCategory::LDS;
+  if (llvm::SIInstrInfo::isVMEM(MI) || llvm::SIInstrInfo::isFLAT(MI))
+    return InstructionCategory::VectorMemory;
+  if (llvm::SIInstrInfo::isVALU(MI))
+    return InstructionCategory::VectorALU;
+  if (llvm::SIInstrInfo::isEXP(MI))
+    return InstructionCategory::Export;
+  return InstructionCategory::Other;
+}
+
+llvm::Expected<InstructionMixModel> InstructionMixModel::create(
+    LiftedRepresentation &LR,
+    llvm::SmallVectorImpl<llvm::MachineInstr *> *BlockEntries) {
+  InstructionMixModel Model;
+  /// Non-zero entries of the composition matrix, in block order
+  struct Entry {
+    unsigned int Opcode;
+    uint32_t Block;
+    uint32_t NumOccurrences;
+  };
+  llvm::SmallVector<Entry> Entries;
+  /// Properties of each opcode encountered so far
+  llvm::DenseMap<unsigned int, std::pair<bool, InstructionCategory>>
+      OpcodeInfo;
+
+  LUTHIER_RETURN_ON_ERROR(LR.iterateAllDefinedFunctionTypes(
+      [&](const hsa::LoadedCodeObjectSymbol &, llvm::MachineFunction &MF)
+          -> llvm::Error {
+        llvm::SmallVector<UniformExecRegion> Regions;
+        findUniformExecRegions(MF, Regions);
+        for (const auto &Region : Regions) {
+          auto Block = static_cast<uint32_t>(Model.NumBlocks++);
+          if (BlockEntries)
+            BlockEntries->push_back(&Region.front());
+          llvm::SmallMapVector<unsigned int, uint32_t, 16> Composition;
+          for (const llvm::MachineInstr *MI : Region.Instructions) {
+            Composition[MI->getOpcode()]++;
+            OpcodeInfo.try_emplace(
+                MI->getOpcode(),
+                !luthier::isScalar(*MI) && !luthier::isLaneAccess(*MI),
+                getInstructionCategory(*MI));
+          }
+          for (const auto &[Opcode, NumOccurrences] : Composition)
+            Entries.push_back({Opcode, Block, NumOccurrences});
+        }
+        return llvm::Error::success();
+      }));
+
+  // Group the entries by opcode; Entries of each opcode remain in block
+  // order, so that the weights are read sequentially during extrapolation
+  llvm::stable_sort(Entries, [](const Entry &A, const Entry &B) {
+    return A.Opcode < B.Opcode;
+  });
+  Model.BlockIndices.reserve(Entries.size());
+  Model.NumOccurrences.reserve(Entries.size());
+  for (const auto &E : Entries) {
+    if (Model.Opcodes.empty() || Model.Opcodes.back() != E.Opcode) {
+      const auto &[IsVector, Category] = OpcodeInfo.at(E.Opcode);
+      Model.Opcodes.push_back(E.Opcode);
+      Model.IsVectorOpcode.push_back(IsVector);
+      Model.OpcodeCategories.push_back(Category);
+      Model.OpcodeEntriesBegin.push_back(Model.BlockIndices.size());
+    }
+    Model.BlockIndices.push_back(E.Block);
+    Model.NumOccurrences.push_back(E.NumOccurrences);
+  }
+  Model.OpcodeEntriesBegin.push_back(Model.BlockIndices.size());
+  LLVM_DEBUG(llvm::dbgs() << "Built an instruction mix model with "
+                          << Model.NumBlocks << " blocks, "
+                          << Model.Opcodes.size() << " opcodes and "
+                          << Model.BlockIndices.size()
+                          << " non-zero entries.\n";);
+  return Model;
+}
+
+/// \return the dot product of an opcode's column of the composition matrix
+/// with \p Weights
+static uint64_t dotColumn(llvm::ArrayRef<uint32_t> BlockIndices,
+                          llvm::ArrayRef<uint32_t> NumOccurrences,
+                          llvm::ArrayRef<uint64_t> Weights) {
+  uint64_t Out{0};
+  for (size_t I = 0; I < BlockIndices.size(); I++)
+    Out += static_cast<uint64_t>(NumOccurrences[I]) * Weights[BlockIndices[I]];
+  return Out;
+}
+
+llvm::Error InstructionMixModel::extrapolateOpcodeHistogram(
+    llvm::ArrayRef<uint64_t> ScalarWeights,
+    llvm::ArrayRef<uint64_t> VectorWeights,
+    llvm::MutableArrayRef<uint64_t> Histogram) const {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      ScalarWeights.size() == NumBlocks && VectorWeights.size() == NumBlocks,
+      "Expected {0} block weights, got {1} scalar and {2} vector weights.",
+      NumBlocks, ScalarWeights.size(), VectorWeights.size()));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      Opcodes.empty() || Opcodes.back() < Histogram.size(),
+      "Opcode histogram of size {0} cannot hold opcode {1}.", Histogram.size(),
+      Opcodes.empty() ? 0 : Opcodes.back()));
+  for (size_t I = 0; I < Opcodes.size(); I++) {
+    size_t Begin = OpcodeEntriesBegin[I];
+    size_t Size = OpcodeEntriesBegin[I + 1] - Begin;
+    Histogram[Opcodes[I]] +=
+        dotColumn(llvm::ArrayRef(BlockIndices).slice(Begin, Size),
+                  llvm::ArrayRef(NumOccurrences).slice(Begin, Size),
+                  IsVectorOpcode[I] ? VectorWeights : ScalarWeights);
+  }
+  return llvm::Error::success();
+}
+
+llvm::Error InstructionMixModel::extrapolateCategoryHistogram(
+    llvm::ArrayRef<uint64_t> ScalarWeights,
+    llvm::ArrayRef<uint64_t> VectorWeights,
+    std::array<uint64_t,
+               static_cast<size_t>(InstructionCategory::NumCategories)>
+        &Histogram) const {
+  llvm::SmallVector<uint64_t> OpcodeHistogram(
+      Opcodes.empty() ? 0 : Opcodes.back() + 1, 0);
+  LUTHIER_RETURN_ON_ERROR(extrapolateOpcodeHistogram(
+      ScalarWeights, VectorWeights, OpcodeHistogram));
+  for (size_t I = 0; I < Opcodes.size(); I++)
+    Histogram[static_cast<size_t>(OpcodeCategories[I])] +=
+        OpcodeHistogram[Opcodes[I]];
+  return llvm::Error::success();
+}
+
+} // namespace luthier
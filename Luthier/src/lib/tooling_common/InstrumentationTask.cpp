@@ -21,6 +21,11 @@
 #include "tooling_common/CodeGenerator.hpp"
 #include "tooling_common/CodeLifter.hpp"
 #include "tooling_common/ToolExecutableLoader.hpp"
+#include <llvm/CodeGen/MachineModuleInfo.h>
+#include <llvm/IR/Constants.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-instrumentation-task"
 
 namespace luthier {
 
@@ -42,6 +47,130 @@ llvm::Error luthier::InstrumentationTask::insertHookBefore(
   return llvm::Error::success();
 }
 
+llvm::Error InstrumentationTask::insertCountingHookBefore(
+    llvm::MachineInstr &MI, const void *Hook,
+    llvm::ArrayRef<unsigned int> CountArgIndices,
+    llvm::ArrayRef<std::variant<llvm::Constant *, llvm::MCRegister>> Args) {
+  for (unsigned int Idx : CountArgIndices) {
+    LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+        Idx < Args.size() &&
+            std::holds_alternative<llvm::Constant *>(Args[Idx]) &&
+            llvm::isa<llvm::ConstantInt>(std::get<llvm::Constant *>(Args[Idx])),
+        "Count argument {0} of the hook is not an integer constant.", Idx));
+  }
+  LUTHIER_RETURN_ON_ERROR(insertHookBefore(MI, Hook, Args));
+  HookInsertionTasks[&MI].back().CountArgIndices.assign(CountArgIndices.begin(),
+                                                        CountArgIndices.end());
+  return llvm::Error::success();
+}
+
+/// \return \c true if \p Hook can be hoisted out of a counted loop
+static bool isHoistable(
+    const InstrumentationTask::hook_invocation_descriptor &Hook) {
+  if (Hook.CountArgIndices.empty() || Hook.CountMultiplier.has_value())
+    return false;
+  return llvm::all_of(Hook.Args, [](const auto &Arg) {
+    return std::holds_alternative<llvm::Constant *>(Arg);
+  });
+}
+
+/// \return \c true if \p A and \p B are invocations of the same counting
+/// hook which only differ in their count arguments
+static bool
+isMergeable(const InstrumentationTask::hook_invocation_descriptor &A,
+            const InstrumentationTask::hook_invocation_descriptor &B) {
+  if (A.HookName != B.HookName || A.CountArgIndices != B.CountArgIndices ||
+      A.CountMultiplier != B.CountMultiplier || A.Args.size() != B.Args.size())
+    return false;
+  for (unsigned int I = 0; I < A.Args.size(); I++) {
+    if (!llvm::is_contained(A.CountArgIndices, I) && A.Args[I] != B.Args[I])
+      return false;
+  }
+  return true;
+}
+
+void InstrumentationTask::hoistCountingHooksOutOfLoops() {
+  for (const auto &F : LR.getModule()) {
+    auto *MF = LR.getMMI().getMachineFunction(F);
+    if (!MF)
+      continue;
+    llvm::SmallVector<CountedLoop> Loops;
+    findCountedLoops(*MF, Loops);
+    for (const auto &Loop : Loops) {
+      llvm::SmallVector<hook_invocation_descriptor> HoistedHooks;
+      for (llvm::MachineBasicBlock *MBB : Loop.BlocksExecutedOncePerIteration) {
+        for (auto &MI : *MBB) {
+          auto It = HookInsertionTasks.find(&MI);
+          if (It == HookInsertionTasks.end())
+            continue;
+          auto &Hooks = It->second;
+          auto FirstHoisted = std::stable_partition(
+              Hooks.begin(), Hooks.end(),
+              [](const auto &Hook) { return !isHoistable(Hook); });
+          std::move(FirstHoisted, Hooks.end(),
+                    std::back_inserter(HoistedHooks));
+          Hooks.erase(FirstHoisted, Hooks.end());
+          if (Hooks.empty())
+            HookInsertionTasks.erase(It);
+        }
+      }
+      if (HoistedHooks.empty())
+        continue;
+      LLVM_DEBUG(llvm::dbgs() << "Hoisting " << HoistedHooks.size()
+                              << " counting hooks out of the loop with header "
+                              << "bb." << Loop.Header->getNumber() << " of "
+                              << MF->getName() << ".\n";);
+      auto ConstantTripCount = Loop.TripCount.getConstantTripCount();
+      auto &PreheaderHooks = HookInsertionTasks[Loop.PreheaderInsertionPoint];
+      for (auto &Hook : HoistedHooks) {
+        // Fold constant trip counts into the count arguments
+        if (ConstantTripCount) {
+          for (unsigned int Idx : Hook.CountArgIndices) {
+            auto *Count = llvm::cast<llvm::ConstantInt>(
+                std::get<llvm::Constant *>(Hook.Args[Idx]));
+            Hook.Args[Idx] = llvm::ConstantInt::get(
+                Count->getContext(), Count->getValue() * *ConstantTripCount);
+          }
+        } else
+          Hook.CountMultiplier = Loop.TripCount;
+        // Merge the hook with an identical one already in the preheader
+        auto *MergeTarget = llvm::find_if(PreheaderHooks, [&](const auto &H) {
+          return isMergeable(H, Hook);
+        });
+        if (MergeTarget == PreheaderHooks.end()) {
+          PreheaderHooks.push_back(std::move(Hook));
+          continue;
+        }
+        for (unsigned int Idx : Hook.CountArgIndices) {
+          auto *Count = llvm::cast<llvm::ConstantInt>(
+              std::get<llvm::Constant *>(Hook.Args[Idx]));
+          auto *TargetCount = llvm::cast<llvm::ConstantInt>(
+              std::get<llvm::Constant *>(MergeTarget->Args[Idx]));
+          MergeTarget->Args[Idx] = llvm::ConstantInt::get(
+              Count->getContext(), TargetCount->getValue() + Count->getValue());
+        }
+      }
+    }
+  }
+}
+
+llvm::Error InstrumentationTask::append(const InstrumentationTask &Other) {
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      &Other.LR == &LR,
+      "Cannot merge instrumentation tasks of different lifted "
+      "representations."));
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      &Other.IM == &IM, "Cannot merge instrumentation tasks using different "
+                        "instrumentation modules."));
+  for (const auto &[MI, Hooks] : Other.HookInsertionTasks) {
+    auto &MIHooks = HookInsertionTasks[MI];
+    MIHooks.append(Hooks.begin(), Hooks.end());
+  }
+  MinWavesPerEU = std::max(MinWavesPerEU, Other.MinWavesPerEU);
+  PreserveOccupancy |= Other.PreserveOccupancy;
+  return llvm::Error::success();
+}
+
 InstrumentationTask::InstrumentationTask(LiftedRepresentation &LR)
     : LR(LR),
       IM(ToolExecutableLoader::instance().getStaticInstrumentationModule()) {};
@@ -0,0 +1,188 @@
+//===-- KernelOccupancy.cpp - Kernel Occupancy and Budget -----------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the kernel occupancy calculation functions and the
+/// \c OccupancyBudgetAnalysis.
+//===----------------------------------------------------------------------===//
+#include "tooling_common/KernelOccupancy.hpp"
+#include "hsa/LoadedCodeObject.hpp"
+#include "hsa/hsa.hpp"
+#include "luthier/common/ErrorCheck.h"
+#include "luthier/common/LuthierError.h"
+#include "luthier/hsa/KernelDescriptor.h"
+#include "luthier/hsa/LoadedCodeObjectKernel.h"
+#include "luthier/tooling/InstrumentationTask.h"
+#include "luthier/tooling/LiftedRepresentation.h"
+#include "tooling_common/TargetManager.hpp"
+#include "tooling_common/WrapperAnalysisPasses.hpp"
+#include <GCNSubtarget.h>
+#include <llvm/CodeGen/MachineModuleInfo.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-kernel-occupancy"
+
+namespace luthier {
+
+KernelOccupancy getKernelOccupancy(const hsa::KernelDescriptor &KD,
+                                   const llvm::MCSubtargetInfo &STI,
+                                   unsigned int MaxFlatWorkgroupSize) {
+  namespace IsaInfo = llvm::AMDGPU::IsaInfo;
+  KernelOccupancy Out;
+  auto Rsrc1 = KD.getRsrc1();
+  Out.NumVGPRs = (Rsrc1.GranulatedWorkItemVGPRCount + 1) *
+                 IsaInfo::getVGPREncodingGranule(&STI);
+  // Starting from GFX10, SGPRs are always allocated in full and do not
+  // affect occupancy
+  if (!llvm::AMDGPU::isGFX10Plus(STI))
+    Out.NumSGPRs = (Rsrc1.GranulatedWaveFrontSGPRCount + 1) *
+                   IsaInfo::getSGPREncodingGranule(&STI);
+  Out.GroupSegmentSize = KD.GroupSegmentFixedSize;
+  Out.PrivateSegmentSize = KD.PrivateSegmentFixedSize;
+
+  // Find the maximum number of waves which have enough registers
+  unsigned int WavesPerEU = IsaInfo::getMaxWavesPerEU(&STI);
+  while (WavesPerEU > 1 &&
+         (IsaInfo::getMaxNumVGPRs(&STI, WavesPerEU) < Out.NumVGPRs ||
+          IsaInfo::getMaxNumSGPRs(&STI, WavesPerEU, false) < Out.NumSGPRs))
+    WavesPerEU--;
+
+  // Limit the number of waves by the number of workgroups that fit in the
+  // LDS of a CU
+  if (Out.GroupSegmentSize != 0) {
+    unsigned int WorkgroupSize =
+        MaxFlatWorkgroupSize != 0
+            ? MaxFlatWorkgroupSize
+            : IsaInfo::getMaxFlatWorkGroupSize(&STI);
+    unsigned int WavesPerWorkgroup =
+        llvm::divideCeil(WorkgroupSize, IsaInfo::getWavefrontSize(&STI));
+    unsigned int WorkgroupsPerCU =
+        IsaInfo::getLocalMemorySize(&STI) / Out.GroupSegmentSize;
+    unsigned int LDSLimitedWavesPerEU = std::max(
+        1U, WorkgroupsPerCU * WavesPerWorkgroup / IsaInfo::getEUsPerCU(&STI));
+    WavesPerEU = std::min(WavesPerEU, LDSLimitedWavesPerEU);
+  }
+  Out.WavesPerEU = WavesPerEU;
+  return Out;
+}
+
+llvm::Expected<KernelOccupancy>
+getKernelOccupancy(const hsa::LoadedCodeObjectKernel &Kernel) {
+  auto KDOnDevice = Kernel.getKernelDescriptor();
+  LUTHIER_RETURN_ON_ERROR(KDOnDevice.takeError());
+  auto KDOnHost = hsa::queryHostAddress(*KDOnDevice);
+  LUTHIER_RETURN_ON_ERROR(KDOnHost.takeError());
+
+  auto ISA = hsa::LoadedCodeObject(Kernel.getLoadedCodeObject()).getISA();
+  LUTHIER_RETURN_ON_ERROR(ISA.takeError());
+  auto TargetInfo = TargetManager::instance().getTargetInfo(*ISA);
+  LUTHIER_RETURN_ON_ERROR(TargetInfo.takeError());
+
+  return getKernelOccupancy(**KDOnHost, *TargetInfo->getMCSubTargetInfo(),
+                            Kernel.getKernelMetadata().MaxFlatWorkgroupSize);
+}
+
+/// \return the number of registers of class \p RC used by the app, assuming
+/// registers are used starting from the first register of the class
+static unsigned int getNumRegsUsed(const llvm::MachineRegisterInfo &MRI,
+                                   const llvm::TargetRegisterClass &RC) {
+  for (unsigned int I = RC.getNumRegs(); I > 0; I--) {
+    if (MRI.isPhysRegUsed(RC.getRegister(I - 1)))
+      return I;
+  }
+  return 0;
+}
+
+llvm::Error OccupancyBudget::calculate(const LiftedRepresentation &LR,
+                                       const InstrumentationTask &Task) {
+  if (!Task.shouldPreserveOccupancy() && Task.getMinWavesPerEU() == 0)
+    return llvm::Error::success();
+  const auto &ST = LR.getKernelMF().getSubtarget<llvm::GCNSubtarget>();
+  namespace IsaInfo = llvm::AMDGPU::IsaInfo;
+
+  unsigned int WavesPerEU = Task.getMinWavesPerEU();
+  if (Task.shouldPreserveOccupancy()) {
+    auto Occupancy = getKernelOccupancy(LR.getKernel());
+    LUTHIER_RETURN_ON_ERROR(Occupancy.takeError());
+    WavesPerEU = std::max(WavesPerEU, Occupancy->WavesPerEU);
+  }
+  MinWavesPerEU = std::min(WavesPerEU, IsaInfo::getMaxWavesPerEU(&ST));
+
+  MaxNumSGPRs = IsaInfo::getMaxNumSGPRs(&ST, MinWavesPerEU, true);
+  unsigned int TotalNumVGPRs = IsaInfo::getMaxNumVGPRs(&ST, MinWavesPerEU);
+  if (ST.hasGFX90AInsts()) {
+    // VGPRs and AGPRs share the same register file, with AGPRs allocated
+    // right after the VGPRs aligned to 4; Each kind can only grow into the
+    // space not used by the app's registers of the other kind
+    unsigned int NumAppVGPRs{0};
+    unsigned int NumAppAGPRs{0};
+    for (const auto &F : LR.getModule()) {
+      if (const auto *MF = LR.getMMI().getMachineFunction(F)) {
+        const auto &MRI = MF->getRegInfo();
+        NumAppVGPRs = std::max(
+            NumAppVGPRs, getNumRegsUsed(MRI, llvm::AMDGPU::VGPR_32RegClass));
+        NumAppAGPRs = std::max(
+            NumAppAGPRs, getNumRegsUsed(MRI, llvm::AMDGPU::AGPR_32RegClass));
+      }
+    }
+    unsigned int NumAddressableVGPRs =
+        llvm::AMDGPU::VGPR_32RegClass.getNumRegs();
+    MaxNumVGPRs = std::min<unsigned int>(
+        NumAddressableVGPRs,
+        llvm::alignDown(TotalNumVGPRs - std::min(TotalNumVGPRs, NumAppAGPRs),
+                        4));
+    MaxNumAGPRs = std::min<unsigned int>(
+        NumAddressableVGPRs,
+        TotalNumVGPRs -
+            std::min<unsigned int>(TotalNumVGPRs,
+                                   llvm::alignTo(NumAppVGPRs, 4)));
+  } else {
+    MaxNumVGPRs = TotalNumVGPRs;
+    MaxNumAGPRs = ST.hasMAIInsts() ? TotalNumVGPRs : 0;
+  }
+  LLVM_DEBUG(llvm::dbgs() << "Occupancy budget of " << MinWavesPerEU
+                          << " waves per EU: " << MaxNumVGPRs << " VGPRs, "
+                          << MaxNumAGPRs << " AGPRs, " << MaxNumSGPRs
+                          << " SGPRs.\n";);
+  return llvm::Error::success();
+}
+
+void OccupancyBudget::addRegistersOutsideBudget(
+    llvm::LivePhysRegs &Regs) const {
+  if (!isActive())
+    return;
+  for (const auto &[RC, MaxNumRegs] :
+       {std::make_pair(&llvm::AMDGPU::VGPR_32RegClass, MaxNumVGPRs),
+        std::make_pair(&llvm::AMDGPU::AGPR_32RegClass, MaxNumAGPRs),
+        std::make_pair(&llvm::AMDGPU::SGPR_32RegClass, MaxNumSGPRs)}) {
+    for (unsigned int I = MaxNumRegs; I < RC->getNumRegs(); I++)
+      Regs.addReg(RC->getRegister(I));
+  }
+}
+
+llvm::AnalysisKey OccupancyBudgetAnalysis::Key;
+
+OccupancyBudgetAnalysis::Result
+OccupancyBudgetAnalysis::run(llvm::Module &TargetModule,
+                             llvm::ModuleAnalysisManager &MAM) {
+  OccupancyBudget Out;
+  auto &LR = MAM.getResult<LiftedRepresentationAnalysis>(TargetModule).getLR();
+  if (auto Err = Out.calculate(LR, Task))
+    TargetModule.getContext().emitError(toString(std::move(Err)));
+  return Out;
+}
+
+} // namespace luthier
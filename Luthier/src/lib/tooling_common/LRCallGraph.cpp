@@ -196,10 +196,36 @@ llvm::Error LRCallGraph::analyse(const llvm::Module &M,
   return llvm::Error::success();
 }
 
+LRCallGraph::LRCallGraph(
+    const LRCallGraph &SrcCG,
+    const llvm::DenseMap<const llvm::MachineFunction *,
+                         const llvm::MachineFunction *> &SrcToDstMFMap,
+    const llvm::DenseMap<const llvm::MachineInstr *,
+                         const llvm::MachineInstr *> &SrcToDstMIMap)
+    : HasNonDeterministicCallGraph(SrcCG.HasNonDeterministicCallGraph) {
+  // Unknown callees are recorded as nullptr, which maps to itself
+  auto MapMF = [&](const llvm::MachineFunction *MF) {
+    return MF ? SrcToDstMFMap.at(MF) : nullptr;
+  };
+  for (const auto &[SrcMF, SrcNode] : SrcCG.CallGraph) {
+    auto DstNode = std::make_unique<CallGraphNode>();
+    DstNode->Node = MapMF(SrcNode->Node);
+    for (const auto &[CallMI, CalledMF] : SrcNode->CalledFunctions)
+      DstNode->CalledFunctions.emplace_back(SrcToDstMIMap.at(CallMI),
+                                            MapMF(CalledMF));
+    for (const auto &[CallMI, CallerMF] : SrcNode->CalleeFunctions)
+      DstNode->CalleeFunctions.emplace_back(SrcToDstMIMap.at(CallMI),
+                                            MapMF(CallerMF));
+    CallGraph.insert({MapMF(SrcMF), std::move(DstNode)});
+  }
+}
+
 llvm::AnalysisKey LRCallGraphAnalysis::Key;
 
 LRCallGraph LRCallGraphAnalysis::run(llvm::Module &M,
                                      llvm::ModuleAnalysisManager &MAM) {
+  if (SrcCG)
+    return {*SrcCG, *SrcToDstMFMap, *SrcToDstMIMap};
   LRCallGraph Out;
   if (auto Err = Out.analyse(
           M, MAM.getCachedResult<llvm::MachineModuleAnalysis>(M)->getMMI())) {
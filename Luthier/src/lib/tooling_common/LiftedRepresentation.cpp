@@ -25,6 +25,8 @@
 #include <luthier/hsa/LoadedCodeObjectExternSymbol.h>
 #include <luthier/hsa/LoadedCodeObjectKernel.h>
 #include <luthier/hsa/LoadedCodeObjectVariable.h>
+#include <luthier/tooling/AMDGPURegisterLiveness.h>
+#include <luthier/tooling/LRCallgraph.h>
 #include <luthier/tooling/LiftedRepresentation.h>
 
 namespace luthier {
@@ -19,16 +19,25 @@
 //===----------------------------------------------------------------------===//
 #include "tooling_common/PatchLiftedRepresentationPass.hpp"
 #include "luthier/consts.h"
+#include "luthier/tooling/AMDGPURegisterLiveness.h"
 #include "tooling_common/IModuleIRGeneratorPass.hpp"
+#include "tooling_common/KernelOccupancy.hpp"
 #include "tooling_common/WrapperAnalysisPasses.hpp"
 #include "llvm/Cloning.hpp"
 #include <SIInstrInfo.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/CodeGen/LivePhysRegs.h>
 #include <llvm/CodeGen/MachineBasicBlock.h>
 #include <llvm/CodeGen/MachineFrameInfo.h>
+#include <llvm/CodeGen/MachineInstrBuilder.h>
 #include <llvm/CodeGen/TargetRegisterInfo.h>
 #include <llvm/CodeGen/TargetSubtargetInfo.h>
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/Module.h>
+#include <llvm/MC/MCContext.h>
+#include <llvm/MC/MCExpr.h>
 #include <llvm/Support/FormatVariadic.h>
 #include <llvm/Support/TimeProfiler.h>
 #include <llvm/Transforms/Utils/Cloning.h>
@@ -38,6 +47,16 @@
 
 #define DEBUG_TYPE "luthier-patch-lr"
 
+STATISTIC(NumDeduplicatedInjectedPayloads,
+          "Number of injected payloads replaced by a jump to a shared copy");
+STATISTIC(NumSharedInjectedPayloads,
+          "Number of shared copies of injected payloads");
+STATISTIC(NumBytesSavedBySharing,
+          "Estimated code size saved by sharing injected payloads, in bytes");
+STATISTIC(NumBytesAddedBySharing,
+          "Estimated code size added by sharing injected payloads where the "
+          "jumps outweigh the payloads, in bytes");
+
 namespace luthier {
 
 static llvm::cl::opt<bool> OutlineAllInjectedPayloads(
@@ -45,6 +64,13 @@ static llvm::cl::opt<bool> OutlineAllInjectedPayloads(
     llvm::cl::desc("Outline all injected payloads no matter the code size."),
     llvm::cl::init(true));
 
+static llvm::cl::opt<bool> DeduplicateInjectedPayloads(
+    "luthier-deduplicate-injected-payloads",
+    llvm::cl::desc("Outline identical injected payloads of a function only "
+                   "once, and make their instrumentation points jump to the "
+                   "shared copy."),
+    llvm::cl::init(true));
+
 static void patchFrameInfo(const llvm::MachineFunction &InjectedPayloadMF,
                            llvm::MachineFunction &ToBeInstrumentedMF) {
   auto &InjectedPayloadFrameInfo = InjectedPayloadMF.getFrameInfo();
@@ -192,7 +218,11 @@ PatchLiftedRepresentationPass::decidePatchingMethod(
 
       // If the injected payload can't be inlined, we have to check what kind
       // of branch we need to do to reach the injected payloads at the
-      // end of the function
+      // end of the function; The outlined payloads, together with the kernel
+      // preamble and state value storage switch blocks already placed there
+      // by the PrePostAmbleEmitter, form the cold region of the function,
+      // and no jump between the application code and the cold region spans
+      // more than the estimated size of the whole function
       if (Out.at(TargetMF) == OUTLINE) {
         LLVM_DEBUG(llvm::dbgs()
                        << "Have to outline MF " << TargetMF->getName() << "\n";
@@ -429,11 +459,11 @@ void inlineInjectedPayload(const llvm::MachineFunction &InjectedPayloadMF,
   }
 }
 
-void outlineInjectedPayload(const llvm::MachineFunction &InjectedPayloadMF,
-                            llvm::MachineInstr &InsertionPointMI,
-                            llvm::DenseMap<const llvm::MachineBasicBlock *,
-                                           llvm::MachineBasicBlock *> &MBBMap,
-                            const llvm::ValueToValueMapTy &VMap) {
+/// Splits the block of \p InsertionPointMI right before it
+/// \return the block that jumps to the outlined injected payload, and the
+/// block that the injected payload jumps back to
+static std::pair<llvm::MachineBasicBlock *, llvm::MachineBasicBlock *>
+splitAtInsertionPoint(llvm::MachineInstr &InsertionPointMI) {
   auto &InsertionPointMBB = *InsertionPointMI.getParent();
   auto &ToBeInstrumentedMF = *InsertionPointMI.getMF();
   // The MBB that will jump to the beginning of the injected payload
@@ -448,12 +478,11 @@ void outlineInjectedPayload(const llvm::MachineFunction &InjectedPayloadMF,
     JumpFromBlock = ToBeInstrumentedMF.CreateMachineBasicBlock();
     ToBeInstrumentedMF.insert(InsertionPointMBB.getIterator(), JumpFromBlock);
     // All the predecessors of InsertionPointMBB now become the JumpFromBlock's
-    // predecessors
+    // predecessors; Predecessors that branch to InsertionPointMBB (e.g. the
+    // outlined kernel preamble) must branch to the JumpFromBlock instead
     for (auto &Pred :
          llvm::make_early_inc_range(InsertionPointMBB.predecessors())) {
-      Pred->addSuccessor(JumpFromBlock);
-      if (Pred->isSuccessor(&InsertionPointMBB))
-        Pred->removeSuccessor(&InsertionPointMBB);
+      Pred->ReplaceUsesOfBlockWith(&InsertionPointMBB, JumpFromBlock);
     }
     // InsertionPointMBB will become the jump to block
     JumpToBlock = &InsertionPointMBB;
@@ -461,22 +490,25 @@ void outlineInjectedPayload(const llvm::MachineFunction &InjectedPayloadMF,
     JumpToBlock = InsertionPointMBB.splitAt(*InsertionPointMI.getPrevNode());
     JumpFromBlock = &InsertionPointMBB;
   }
+  return {JumpFromBlock, JumpToBlock};
+}
 
+/// Clones the blocks of \p InjectedPayloadMF to the end of
+/// \p ToBeInstrumentedMF, linking them together the same way they are linked
+/// in the injected payload
+/// \note The terminators of the injected payload's return blocks are not
+/// cloned; It is up to the caller to decide where the return blocks go next
+static void
+cloneInjectedPayloadBlocks(const llvm::MachineFunction &InjectedPayloadMF,
+                           llvm::MachineFunction &ToBeInstrumentedMF,
+                           llvm::DenseMap<const llvm::MachineBasicBlock *,
+                                          llvm::MachineBasicBlock *> &MBBMap,
+                           const llvm::ValueToValueMapTy &VMap) {
   for (const auto &InjectedPayloadMBB : InjectedPayloadMF) {
     // Create MBBs at the end of the function
     auto *NewBlock = ToBeInstrumentedMF.CreateMachineBasicBlock();
     ToBeInstrumentedMF.push_back(NewBlock);
     MBBMap.insert({&InjectedPayloadMBB, NewBlock});
-    // If this is the entry block of the injected payload then it is
-    // the jump from block's direct successor
-    if (InjectedPayloadMBB.isEntryBlock()) {
-      JumpFromBlock->addSuccessor(NewBlock);
-    }
-    // If this is a return block of the injected payload then it is the jump to
-    // block's predecessor
-    if (InjectedPayloadMBB.isReturnBlock()) {
-      NewBlock->addSuccessor(JumpToBlock);
-    }
   }
 
   // Link blocks
@@ -502,68 +534,407 @@ void outlineInjectedPayload(const llvm::MachineFunction &InjectedPayloadMF,
   for (const auto &MBB : InjectedPayloadMF) {
     auto *DstMBB = MBBMap[&MBB];
     llvm::MachineBasicBlock::iterator InsertionPoint = DstMBB->end();
-    [&]() {
-      for (auto &SrcMI : MBB.instrs()) {
-        if (MBB.isReturnBlock() && SrcMI.isTerminator()) {
-          break;
-        }
-        // Don't clone the bundle headers
-        if (SrcMI.isBundle())
-          continue;
-        const auto &MCID = TII->get(SrcMI.getOpcode());
-        // TODO: Properly import the debug location
-        auto *DstMI =
-            ToBeInstrumentedMF.CreateMachineInstr(MCID, llvm::DebugLoc(),
-                                                  /*NoImplicit=*/true);
-        DstMI->setFlags(SrcMI.getFlags());
-        DstMI->setAsmPrinterFlag(SrcMI.getAsmPrinterFlags());
-        DstMBB->insert(InsertionPoint, DstMI);
-        for (auto &SrcMO : SrcMI.operands()) {
-          llvm::MachineOperand DstMO(SrcMO);
-          DstMO.clearParent();
-
-          // Update MBB.
-          if (DstMO.isMBB())
-            DstMO.setMBB(MBBMap[DstMO.getMBB()]);
-          else if (DstMO.isRegMask()) {
-            TargetMFMRI.addPhysRegsUsedFromRegMask(DstMO.getRegMask());
-
-            if (!ConstRegisterMasks.count(DstMO.getRegMask())) {
-              uint32_t *DstMask = ToBeInstrumentedMF.allocateRegMask();
-              std::memcpy(
-                  DstMask, SrcMO.getRegMask(),
-                  sizeof(*DstMask) *
-                      llvm::MachineOperand::getRegMaskSize(TRI->getNumRegs()));
-              DstMO.setRegMask(DstMask);
-            }
-          } else if (DstMO.isGlobal()) {
-            auto GVEntry = VMap.find(DstMO.getGlobal());
-            if (GVEntry == VMap.end()) {
-              ToBeInstrumentedMF.getFunction()
-                  .getParent()
-                  ->getContext()
-                  .emitError(
-                      llvm::formatv("Failed to find global variable {0} inside "
-                                    "the representation being patched.",
-                                    DstMO.getGlobal()));
-            }
-            auto *DestGV = cast<llvm::GlobalValue>(GVEntry->second);
-            DstMO.ChangeToGA(DestGV, DstMO.getOffset(), DstMO.getTargetFlags());
-          }
+    for (auto &SrcMI : MBB.instrs()) {
+      if (MBB.isReturnBlock() && SrcMI.isTerminator()) {
+        break;
+      }
+      // Don't clone the bundle headers
+      if (SrcMI.isBundle())
+        continue;
+      const auto &MCID = TII->get(SrcMI.getOpcode());
+      // TODO: Properly import the debug location
+      auto *DstMI =
+          ToBeInstrumentedMF.CreateMachineInstr(MCID, llvm::DebugLoc(),
+                                                /*NoImplicit=*/true);
+      DstMI->setFlags(SrcMI.getFlags());
+      DstMI->setAsmPrinterFlag(SrcMI.getAsmPrinterFlags());
+      DstMBB->insert(InsertionPoint, DstMI);
+      for (auto &SrcMO : SrcMI.operands()) {
+        llvm::MachineOperand DstMO(SrcMO);
+        DstMO.clearParent();
+
+        // Update MBB.
+        if (DstMO.isMBB())
+          DstMO.setMBB(MBBMap[DstMO.getMBB()]);
+        else if (DstMO.isRegMask()) {
+          TargetMFMRI.addPhysRegsUsedFromRegMask(DstMO.getRegMask());
 
-          DstMI->addOperand(DstMO);
+          if (!ConstRegisterMasks.count(DstMO.getRegMask())) {
+            uint32_t *DstMask = ToBeInstrumentedMF.allocateRegMask();
+            std::memcpy(DstMask, SrcMO.getRegMask(),
+                        sizeof(*DstMask) * llvm::MachineOperand::getRegMaskSize(
+                                               TRI->getNumRegs()));
+            DstMO.setRegMask(DstMask);
+          }
+        } else if (DstMO.isGlobal()) {
+          auto GVEntry = VMap.find(DstMO.getGlobal());
+          if (GVEntry == VMap.end()) {
+            ToBeInstrumentedMF.getFunction()
+                .getParent()
+                ->getContext()
+                .emitError(
+                    llvm::formatv("Failed to find global variable {0} inside "
+                                  "the representation being patched.",
+                                  DstMO.getGlobal()));
+          }
+          auto *DestGV = cast<llvm::GlobalValue>(GVEntry->second);
+          DstMO.ChangeToGA(DestGV, DstMO.getOffset(), DstMO.getTargetFlags());
         }
+
+        DstMI->addOperand(DstMO);
       }
-    }();
+    }
+  }
+}
+
+void outlineInjectedPayload(const llvm::MachineFunction &InjectedPayloadMF,
+                            llvm::MachineInstr &InsertionPointMI,
+                            llvm::DenseMap<const llvm::MachineBasicBlock *,
+                                           llvm::MachineBasicBlock *> &MBBMap,
+                            const llvm::ValueToValueMapTy &VMap) {
+  auto &ToBeInstrumentedMF = *InsertionPointMI.getMF();
+  const auto *TII = ToBeInstrumentedMF.getSubtarget().getInstrInfo();
+
+  auto [JumpFromBlock, JumpToBlock] = splitAtInsertionPoint(InsertionPointMI);
+
+  cloneInjectedPayloadBlocks(InjectedPayloadMF, ToBeInstrumentedMF, MBBMap,
+                             VMap);
+
+  for (const auto &MBB : InjectedPayloadMF) {
+    auto *DstMBB = MBBMap[&MBB];
+    // If this is the entry block of the injected payload then it is
+    // the jump from block's direct successor
     if (MBB.isEntryBlock()) {
+      JumpFromBlock->addSuccessor(DstMBB);
       TII->insertUnconditionalBranch(*JumpFromBlock, DstMBB, llvm::DebugLoc());
     }
+    // If this is a return block of the injected payload then it is the jump to
+    // block's predecessor
     if (MBB.isReturnBlock()) {
+      DstMBB->addSuccessor(JumpToBlock);
       TII->insertUnconditionalBranch(*DstMBB, JumpToBlock, llvm::DebugLoc());
     }
   }
 }
 
+/// Computes a hash of \p InjectedPayloadMF's machine code, such that
+/// two injected payloads deemed identical by
+/// \c areInjectedPayloadsIdentical have the same hash
+static llvm::hash_code
+hashInjectedPayload(const llvm::MachineFunction &InjectedPayloadMF) {
+  llvm::hash_code Hash = llvm::hash_combine(
+      InjectedPayloadMF.size(),
+      InjectedPayloadMF.getFrameInfo().getStackSize());
+  for (const auto &MBB : InjectedPayloadMF) {
+    Hash = llvm::hash_combine(Hash, MBB.getNumber(), MBB.succ_size());
+    for (const auto &MI : MBB.instrs()) {
+      Hash = llvm::hash_combine(Hash, MI.getOpcode(), MI.getNumOperands());
+      for (const auto &MO : MI.operands()) {
+        // Blocks are hashed by their number inside the injected payload, and
+        // register masks only by their kind
+        if (MO.isMBB())
+          Hash = llvm::hash_combine(Hash, MO.getMBB()->getNumber());
+        else if (MO.isRegMask())
+          Hash = llvm::hash_combine(Hash, MO.getType());
+        else
+          Hash = llvm::hash_combine(Hash, llvm::hash_value(MO));
+      }
+    }
+  }
+  return Hash;
+}
+
+/// \return \c true if \p A and \p B are identical operands of two different
+/// injected payloads
+static bool areInjectedPayloadOperandsIdentical(const llvm::MachineOperand &A,
+                                                const llvm::MachineOperand &B,
+                                                unsigned int NumRegs) {
+  if (A.isMBB())
+    return B.isMBB() && A.getTargetFlags() == B.getTargetFlags() &&
+           A.getMBB()->getNumber() == B.getMBB()->getNumber();
+  if (A.isRegMask())
+    return B.isRegMask() &&
+           std::memcmp(A.getRegMask(), B.getRegMask(),
+                       sizeof(uint32_t) *
+                           llvm::MachineOperand::getRegMaskSize(NumRegs)) == 0;
+  return A.isIdenticalTo(B);
+}
+
+/// \return \c true if the injected payloads \p A and \p B have the same
+/// machine code, and hence perform the same operation when jumped to from
+/// any of their instrumentation points
+static bool
+areInjectedPayloadsIdentical(const llvm::MachineFunction &A,
+                             const llvm::MachineFunction &B) {
+  if (A.size() != B.size() ||
+      A.getFrameInfo().getStackSize() != B.getFrameInfo().getStackSize() ||
+      A.getFrameInfo().getNumObjects() != B.getFrameInfo().getNumObjects())
+    return false;
+  unsigned int NumRegs = A.getSubtarget().getRegisterInfo()->getNumRegs();
+  for (const auto &[MBBA, MBBB] : llvm::zip(A, B)) {
+    if (MBBA.getNumber() != MBBB.getNumber() ||
+        MBBA.isReturnBlock() != MBBB.isReturnBlock() ||
+        MBBA.succ_size() != MBBB.succ_size() ||
+        std::distance(MBBA.instr_begin(), MBBA.instr_end()) !=
+            std::distance(MBBB.instr_begin(), MBBB.instr_end()))
+      return false;
+    for (const auto &[SuccA, SuccB] :
+         llvm::zip(MBBA.successors(), MBBB.successors())) {
+      if (SuccA->getNumber() != SuccB->getNumber())
+        return false;
+    }
+    for (const auto &[MIA, MIB] : llvm::zip(MBBA.instrs(), MBBB.instrs())) {
+      if (MIA.getOpcode() != MIB.getOpcode() ||
+          MIA.getNumOperands() != MIB.getNumOperands() ||
+          MIA.getFlags() != MIB.getFlags())
+        return false;
+      for (const auto &[MOA, MOB] : llvm::zip(MIA.operands(), MIB.operands())) {
+        if (!areInjectedPayloadOperandsIdentical(MOA, MOB, NumRegs))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// Finds a 64-bit SGPR to hold the return address of the injected payloads
+/// shared between the instrumentation points of \p ToBeInstrumentedMF
+/// \details The register must not be accessed by \p ToBeInstrumentedMF or
+/// any of the \p InjectedPayloadMFs patched into it; Hence, it never holds a
+/// value the instrumented function cares about, and is not clobbered while
+/// a shared injected payload runs. Callee-saved registers of non-kernel
+/// functions and registers outside the occupancy \p Budget are not used
+/// \return the register if found, or zero otherwise
+static llvm::MCRegister findReturnAddressRegister(
+    const llvm::MachineFunction &ToBeInstrumentedMF,
+    llvm::ArrayRef<const llvm::MachineFunction *> InjectedPayloadMFs,
+    const OccupancyBudget &Budget) {
+  const auto &MRI = ToBeInstrumentedMF.getRegInfo();
+  const auto &TRI = *ToBeInstrumentedMF.getSubtarget().getRegisterInfo();
+  bool IsKernel =
+      ToBeInstrumentedMF.getFunction().getCallingConv() ==
+      llvm::CallingConv::AMDGPU_KERNEL;
+  llvm::LivePhysRegs RegsOutsideBudget(TRI);
+  Budget.addRegistersOutsideBudget(RegsOutsideBudget);
+  for (llvm::MCRegister Reg : llvm::AMDGPU::SGPR_64RegClass) {
+    if (!MRI.isAllocatable(Reg) || MRI.isPhysRegUsed(Reg) ||
+        !RegsOutsideBudget.available(MRI, Reg) ||
+        (!IsKernel && TRI.isCalleeSavedPhysReg(Reg, ToBeInstrumentedMF)))
+      continue;
+    if (llvm::none_of(InjectedPayloadMFs,
+                      [&](const llvm::MachineFunction *InjectedPayloadMF) {
+                        return InjectedPayloadMF->getRegInfo().isPhysRegUsed(
+                            Reg);
+                      }))
+      return Reg;
+  }
+  return {};
+}
+
+/// Clones \p Shared 's injected payload once to the end of its function, and
+/// makes each of its instrumentation points jump to it
+/// \details Each instrumentation point computes the address of the block
+/// containing its instrumentation point in \p ReturnAddressReg before jumping
+/// to the shared payload; Similar to the long branch expansion of
+/// \c llvm::SIInstrInfo::insertIndirectBranch, the address is the result of a
+/// <tt>S_GETPC_B64</tt> plus the difference between the label of the jump to
+/// block and a label placed right after the <tt>S_GETPC_B64</tt>, which is
+/// resolved when the instrumented code is assembled. The return blocks of the
+/// shared payload then jump back using a <tt>S_SETPC_B64</tt>. The addition
+/// clobbers SCC, which is why instrumentation points where SCC is live must
+/// not share a payload
+static void
+outlineSharedInjectedPayload(const SharedInjectedPayload &Shared,
+                             llvm::MCRegister ReturnAddressReg,
+                             const llvm::ValueToValueMapTy &VMap) {
+  auto &ToBeInstrumentedMF = *Shared.InsertionPoints.front()->getMF();
+  auto &MCCtx = ToBeInstrumentedMF.getContext();
+  const auto &TII = *ToBeInstrumentedMF.getSubtarget().getInstrInfo();
+  const auto &TRI = *ToBeInstrumentedMF.getSubtarget().getRegisterInfo();
+  llvm::MCRegister ReturnAddressLo =
+      TRI.getSubReg(ReturnAddressReg, llvm::AMDGPU::sub0);
+  llvm::MCRegister ReturnAddressHi =
+      TRI.getSubReg(ReturnAddressReg, llvm::AMDGPU::sub1);
+
+  llvm::DenseMap<const llvm::MachineBasicBlock *, llvm::MachineBasicBlock *>
+      MBBMap;
+  cloneInjectedPayloadBlocks(*Shared.InjectedPayloadMF, ToBeInstrumentedMF,
+                             MBBMap, VMap);
+  auto *SharedEntryBlock = MBBMap[&Shared.InjectedPayloadMF->front()];
+  llvm::SmallVector<llvm::MachineBasicBlock *, 1> SharedReturnBlocks;
+  for (const auto &MBB : *Shared.InjectedPayloadMF) {
+    auto *DstMBB = MBBMap[&MBB];
+    // The return address is live throughout the shared payload, including
+    // its entry and return blocks
+    DstMBB->addLiveIn(ReturnAddressReg);
+    if (!MBB.isReturnBlock())
+      continue;
+    SharedReturnBlocks.push_back(DstMBB);
+    llvm::BuildMI(*DstMBB, DstMBB->end(), llvm::DebugLoc(),
+                  TII.get(llvm::AMDGPU::S_SETPC_B64))
+        .addReg(ReturnAddressReg);
+  }
+
+  for (llvm::MachineInstr *InsertionPointMI : Shared.InsertionPoints) {
+    auto [JumpFromBlock, JumpToBlock] =
+        splitAtInsertionPoint(*InsertionPointMI);
+    // The jump to block is only reached from the shared payload's return
+    // blocks using its address, so its label must always be emitted
+    JumpToBlock->setLabelMustBeEmitted();
+
+    llvm::MachineInstr *GetPC =
+        llvm::BuildMI(*JumpFromBlock, JumpFromBlock->end(), llvm::DebugLoc(),
+                      TII.get(llvm::AMDGPU::S_GETPC_B64), ReturnAddressReg);
+    llvm::MCSymbol *PostGetPCLabel =
+        MCCtx.createTempSymbol("luthier_post_getpc", true);
+    GetPC->setPostInstrSymbol(ToBeInstrumentedMF, PostGetPCLabel);
+
+    llvm::MCSymbol *OffsetLo =
+        MCCtx.createTempSymbol("luthier_return_offset_lo", true);
+    llvm::MCSymbol *OffsetHi =
+        MCCtx.createTempSymbol("luthier_return_offset_hi", true);
+    llvm::BuildMI(*JumpFromBlock, JumpFromBlock->end(), llvm::DebugLoc(),
+                  TII.get(llvm::AMDGPU::S_ADD_U32), ReturnAddressLo)
+        .addReg(ReturnAddressLo)
+        .addSym(OffsetLo, llvm::SIInstrInfo::MO_FAR_BRANCH_OFFSET);
+    llvm::BuildMI(*JumpFromBlock, JumpFromBlock->end(), llvm::DebugLoc(),
+                  TII.get(llvm::AMDGPU::S_ADDC_U32), ReturnAddressHi)
+        .addReg(ReturnAddressHi)
+        .addSym(OffsetHi, llvm::SIInstrInfo::MO_FAR_BRANCH_OFFSET);
+    const auto *Offset = llvm::MCBinaryExpr::createSub(
+        llvm::MCSymbolRefExpr::create(JumpToBlock->getSymbol(), MCCtx),
+        llvm::MCSymbolRefExpr::create(PostGetPCLabel, MCCtx), MCCtx);
+    OffsetLo->setVariableValue(llvm::MCBinaryExpr::createAnd(
+        Offset, llvm::MCConstantExpr::create(0xFFFFFFFFULL, MCCtx), MCCtx));
+    OffsetHi->setVariableValue(llvm::MCBinaryExpr::createAShr(
+        Offset, llvm::MCConstantExpr::create(32, MCCtx), MCCtx));
+
+    TII.insertUnconditionalBranch(*JumpFromBlock, SharedEntryBlock,
+                                  llvm::DebugLoc());
+    JumpFromBlock->addSuccessor(SharedEntryBlock);
+    for (auto *ReturnBlock : SharedReturnBlocks)
+      ReturnBlock->addSuccessor(JumpToBlock);
+  }
+}
+
+/// \return an estimate of the number of bytes saved by patching
+/// \p Shared as a single copy instead of outlining its payload once per
+/// instrumentation point
+static int64_t
+estimateBytesSavedBySharing(const SharedInjectedPayload &Shared) {
+  auto PayloadSize = static_cast<int64_t>(
+      Shared.InjectedPayloadMF->estimateFunctionSizeInBytes());
+  auto NumInsertionPoints =
+      static_cast<int64_t>(Shared.InsertionPoints.size());
+  // Each duplicate copy is replaced by a S_GETPC_B64 and an add and an add
+  // with carry of 32-bit literal offsets at its instrumentation point; Each
+  // return block of the shared copy gets a S_SETPC_B64 in place of its
+  // S_BRANCH
+  return (NumInsertionPoints - 1) * PayloadSize - NumInsertionPoints * 20;
+}
+
+llvm::SmallVector<SharedInjectedPayload>
+PatchLiftedRepresentationPass::findSharedInjectedPayloads(
+    llvm::Module &TargetAppM, llvm::ModuleAnalysisManager &TargetMAM,
+    const llvm::DenseMap<const llvm::MachineFunction *, PatchType>
+        &PatchMethods,
+    llvm::DenseMap<const llvm::MachineFunction *, llvm::MCRegister>
+        &ReturnAddressRegs) {
+  llvm::SmallVector<SharedInjectedPayload> Out;
+  if (!DeduplicateInjectedPayloads)
+    return Out;
+  auto &IModuleAnalysis =
+      *TargetMAM.getCachedResult<IModulePMAnalysis>(TargetAppM);
+  auto &IMAM = IModuleAnalysis.getMAM();
+  const auto &IPIP =
+      *IMAM.getCachedResult<InjectedPayloadAndInstPointAnalysis>(IModule);
+  const auto &RegLiveness =
+      TargetMAM.getResult<AMDGPURegLivenessAnalysis>(TargetAppM);
+  const auto &Budget = TargetMAM.getResult<OccupancyBudgetAnalysis>(TargetAppM);
+
+  // Candidate sets of each outlined function, bucketed by the hash of their
+  // injected payloads
+  llvm::DenseMap<const llvm::MachineFunction *,
+                 llvm::DenseMap<llvm::hash_code,
+                                llvm::SmallVector<SharedInjectedPayload, 1>>>
+      Candidates;
+  // Injected payloads patched into each outlined function
+  llvm::DenseMap<const llvm::MachineFunction *,
+                 llvm::SmallVector<const llvm::MachineFunction *>>
+      InjectedPayloadsOfMF;
+
+  for (const auto &[InsertionPointMI, InjectedPayloadFunc] :
+       IPIP.mi_payload()) {
+    const auto &ToBeInstrumentedMF = *InsertionPointMI->getMF();
+    if (PatchMethods.at(&ToBeInstrumentedMF) != OUTLINE)
+      continue;
+    const auto *InjectedPayloadMF =
+        IMMI.getMachineFunction(*InjectedPayloadFunc);
+    InjectedPayloadsOfMF[&ToBeInstrumentedMF].push_back(InjectedPayloadMF);
+    // Jumping to a shared payload clobbers SCC
+    auto *LiveIns = RegLiveness.getMFLevelInstrLiveIns(*InsertionPointMI);
+    if (!LiveIns || LiveIns->contains(llvm::AMDGPU::SCC))
+      continue;
+    auto &Bucket = Candidates[&ToBeInstrumentedMF][hashInjectedPayload(
+        *InjectedPayloadMF)];
+    auto *Shared = llvm::find_if(Bucket, [&](const SharedInjectedPayload &S) {
+      return areInjectedPayloadsIdentical(*S.InjectedPayloadMF,
+                                          *InjectedPayloadMF);
+    });
+    if (Shared == Bucket.end())
+      Bucket.push_back({InjectedPayloadMF, {InsertionPointMI}});
+    else
+      Shared->InsertionPoints.push_back(InsertionPointMI);
+  }
+
+  for (auto &[ToBeInstrumentedMF, Buckets] : Candidates) {
+    llvm::SmallVector<SharedInjectedPayload> SharedInMF;
+    for (auto &[Hash, Bucket] : Buckets) {
+      for (auto &Shared : Bucket) {
+        if (Shared.InsertionPoints.size() > 1)
+          SharedInMF.emplace_back(std::move(Shared));
+      }
+    }
+    if (SharedInMF.empty())
+      continue;
+    llvm::MCRegister ReturnAddressReg = findReturnAddressRegister(
+        *ToBeInstrumentedMF, InjectedPayloadsOfMF[ToBeInstrumentedMF], Budget);
+    if (!ReturnAddressReg) {
+      LLVM_DEBUG(llvm::dbgs()
+                     << "Failed to find a return address register for "
+                        "deduplicating the injected payloads of MF "
+                     << ToBeInstrumentedMF->getName() << ".\n";);
+      continue;
+    }
+    ReturnAddressRegs.insert({ToBeInstrumentedMF, ReturnAddressReg});
+    int64_t BytesSaved = 0;
+    size_t NumDeduplicated = 0;
+    for (const auto &Shared : SharedInMF) {
+      BytesSaved += estimateBytesSavedBySharing(Shared);
+      NumDeduplicated += Shared.InsertionPoints.size() - 1;
+    }
+    NumDeduplicatedInjectedPayloads += NumDeduplicated;
+    NumSharedInjectedPayloads += SharedInMF.size();
+    if (BytesSaved >= 0)
+      NumBytesSavedBySharing += BytesSaved;
+    else
+      NumBytesAddedBySharing += -BytesSaved;
+    LLVM_DEBUG(
+        llvm::dbgs()
+            << "Deduplicated " << NumDeduplicated
+            << " injected payloads of MF " << ToBeInstrumentedMF->getName()
+            << " into " << SharedInMF.size() << " shared copies using "
+            << llvm::printReg(
+                   ReturnAddressReg,
+                   ToBeInstrumentedMF->getSubtarget().getRegisterInfo())
+            << " as the return address; Estimated code size reduction: "
+            << BytesSaved << " bytes.\n";);
+    for (auto &Shared : SharedInMF)
+      Out.emplace_back(std::move(Shared));
+  }
+  return Out;
+}
+
 llvm::PreservedAnalyses
 PatchLiftedRepresentationPass::run(llvm::Module &TargetAppM,
                                    llvm::ModuleAnalysisManager &TargetMAM) {
@@ -616,8 +987,26 @@ PatchLiftedRepresentationPass::run(llvm::Module &TargetAppM,
     }
   }
 
+  // Patch the injected payloads shared between multiple instrumentation
+  // points first, and skip them when patching the rest
+  llvm::DenseMap<const llvm::MachineFunction *, llvm::MCRegister>
+      ReturnAddressRegs;
+  auto SharedInjectedPayloads = findSharedInjectedPayloads(
+      TargetAppM, TargetMAM, PatchMethods, ReturnAddressRegs);
+  llvm::SmallPtrSet<const llvm::MachineInstr *, 16> SharedInsertionPoints;
+  for (const auto &Shared : SharedInjectedPayloads) {
+    auto &ToBeInstrumentedMF = *Shared.InsertionPoints.front()->getMF();
+    patchFrameInfo(*Shared.InjectedPayloadMF, ToBeInstrumentedMF);
+    outlineSharedInjectedPayload(
+        Shared, ReturnAddressRegs.at(&ToBeInstrumentedMF), VMap);
+    SharedInsertionPoints.insert(Shared.InsertionPoints.begin(),
+                                 Shared.InsertionPoints.end());
+  }
+
   for (const auto &[InsertionPointMI, InjectedPayloadFunc] :
        IPIP.mi_payload()) {
+    if (SharedInsertionPoints.contains(InsertionPointMI))
+      continue;
     // A mapping between a machine basic block in the instrumentation MMI
     // and its destination in the patched instrumented code
     llvm::DenseMap<const llvm::MachineBasicBlock *, llvm::MachineBasicBlock *>
@@ -26,12 +26,20 @@
 #include "tooling_common/WrapperAnalysisPasses.hpp"
 #include <GCNSubtarget.h>
 #include <SIMachineFunctionInfo.h>
+#include <llvm/Support/CommandLine.h>
 
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "luthier-pre-post-amble-emitter"
 
 namespace luthier {
 
+static llvm::cl::opt<bool> OutlineKernelPreamble(
+    "luthier-outline-kernel-preamble",
+    llvm::cl::desc("Place the kernel preamble at the end of the kernel, "
+                   "alongside the outlined injected payloads, instead of "
+                   "before its original entry instruction."),
+    llvm::cl::init(true));
+
 static llvm::MCRegister
 getArgReg(const llvm::MachineFunction &MF,
           llvm::AMDGPUFunctionArgInfo::PreloadedValue ArgReg) {
@@ -74,7 +82,10 @@ getSGPRArgumentPositions(const llvm::MachineFunction &MF) {
           PRIVATE_SEGMENT_WAVE_BYTE_OFFSET,
       llvm::AMDGPUFunctionArgInfo::PreloadedValue::WORKITEM_ID_X,
       llvm::AMDGPUFunctionArgInfo::PreloadedValue::WORKITEM_ID_Y,
-      llvm::AMDGPUFunctionArgInfo::PreloadedValue::WORKITEM_ID_Z};
+      llvm::AMDGPUFunctionArgInfo::PreloadedValue::WORKITEM_ID_Z,
+      llvm::AMDGPUFunctionArgInfo::PreloadedValue::WORKGROUP_ID_X,
+      llvm::AMDGPUFunctionArgInfo::PreloadedValue::WORKGROUP_ID_Y,
+      llvm::AMDGPUFunctionArgInfo::PreloadedValue::WORKGROUP_ID_Z};
 
   for (const auto &PreloadVal : SGPRArgs) {
     auto Reg = getArgReg(MF, PreloadVal);
@@ -308,7 +319,7 @@ emitCodeToStoreSGPRKernelArg(llvm::MachineInstr &InsertionPoint,
                        "save slot lanes."));
     llvm::BuildMI(InsertionPointMBB, InsertionPoint, llvm::DebugLoc(),
                   TII.get(llvm::AMDGPU::V_WRITELANE_B32), SVSVGPR)
-        .addReg(KillAfterUse ? llvm::RegState::Kill : 0)
+        .addReg(SrcSGPR, KillAfterUse ? llvm::RegState::Kill : 0)
         .addImm(SpillSlotStart)
         .addReg(SVSVGPR);
   } else {
@@ -377,8 +388,13 @@ static void emitCodeToMoveSVA(llvm::ModuleAnalysisManager &TargetMAM,
   // Now we need to emit code that juggles the SVS between different
   // storage schemes
   const auto &TII = *MF->getSubtarget().getInstrInfo();
-  for (auto &MBB : *MF) {
-    const auto MBBIntervals = SVLocations.getStorageIntervals(MBB);
+  // Blocks created below are not part of the storage intervals; Only visit
+  // the blocks that existed beforehand
+  llvm::SmallVector<llvm::MachineBasicBlock *> MBBs;
+  for (auto &MBB : *MF)
+    MBBs.push_back(&MBB);
+  for (llvm::MachineBasicBlock *MBB : MBBs) {
+    const auto MBBIntervals = SVLocations.getStorageIntervals(*MBB);
     for (unsigned int I = 0; I < MBBIntervals.size() - 1; I++) {
       auto &CurMBBInterval = MBBIntervals[I];
       auto &NextMBBInterval = MBBIntervals[I + 1];
@@ -390,70 +406,95 @@ static void emitCodeToMoveSVA(llvm::ModuleAnalysisManager &TargetMAM,
       }
     }
     // Analyze the branch at the end of this block (if exists)
-    llvm::MachineBasicBlock *TBB;
-    llvm::MachineBasicBlock *FBB;
-    llvm::MachineBasicBlock *NewTBB{nullptr};
-    llvm::MachineBasicBlock *NewFBB{nullptr};
+    llvm::MachineBasicBlock *TBB{nullptr};
+    llvm::MachineBasicBlock *FBB{nullptr};
     llvm::SmallVector<llvm::MachineOperand, 4> Cond;
-    bool Fail = TII.analyzeBranch(MBB, TBB, FBB, Cond, false);
+    bool Fail = TII.analyzeBranch(*MBB, TBB, FBB, Cond, false);
     if (Fail)
       continue;
-    llvm::SmallVector<
-        std::pair<llvm::MachineBasicBlock *, llvm::MachineBasicBlock *>, 4>
-        OldToNewSuccessorsList;
-    for (llvm::MachineBasicBlock *SuccessorMBB : MBB.successors()) {
+    // The block falls through to its layout successor if it has no branch,
+    // or if it only has a conditional branch
+    llvm::MachineBasicBlock *FallthroughMBB =
+        (TBB == nullptr || (!Cond.empty() && FBB == nullptr)) &&
+                MBB->getNextNode() && MBB->isSuccessor(MBB->getNextNode())
+            ? MBB->getNextNode()
+            : nullptr;
+    // If a successor and the end of this MBB don't have the same storage, we
+    // need to emit switch code in between them; The switch code is placed
+    // in a new block at the end of the function, away from the application
+    // code, and the edge is redirected through it
+    llvm::SmallDenseMap<llvm::MachineBasicBlock *, llvm::MachineBasicBlock *,
+                        4>
+        SwitchBlocks;
+    auto GetEdgeTarget = [&](llvm::MachineBasicBlock *SuccessorMBB)
+        -> llvm::MachineBasicBlock * {
+      if (SuccessorMBB == nullptr)
+        return nullptr;
+      if (auto It = SwitchBlocks.find(SuccessorMBB); It != SwitchBlocks.end())
+        return It->second;
       auto &SuccessorIntervalBegin =
           SVLocations.getStorageIntervals(*SuccessorMBB).front();
-      // If the successor and the end of this MBB don't have the same
-      // storage, we need to emit switch code in between them
-      if (SuccessorIntervalBegin.getSVS() != MBBIntervals.back().getSVS()) {
-        if (TBB == SuccessorMBB) {
-          // Create a new basic block and insert it at the end
-          NewTBB = MF->CreateMachineBasicBlock();
-          MF->insert(MF->end(), NewTBB);
-          // Insert an unconditional branch to the old FBB
-          TII.insertUnconditionalBranch(*NewTBB, TBB, llvm::DebugLoc());
-          NewTBB->addSuccessor(TBB);
-          // Emit the SVS switch code before the branch
-          MBBIntervals.back().getSVS().emitCodeToSwitchSVS(
-              NewTBB->front(), SuccessorIntervalBegin.getSVS());
-          OldToNewSuccessorsList.emplace_back(TBB, NewTBB);
-        } else if (FBB == SuccessorMBB) {
-          // Create a new basic block and insert it at the end
-          NewFBB = MF->CreateMachineBasicBlock();
-          MF->insert(MF->end(), NewFBB);
-          // Insert an unconditional branch to the old FBB
-          TII.insertUnconditionalBranch(*NewFBB, FBB, llvm::DebugLoc());
-          NewFBB->addSuccessor(FBB);
-          // Emit the SVS switch code before the branch
-          MBBIntervals.back().getSVS().emitCodeToSwitchSVS(
-              NewFBB->front(), SuccessorIntervalBegin.getSVS());
-          OldToNewSuccessorsList.emplace_back(TBB, NewTBB);
-        } else {
-          // This is a fallthrough block; We insert the SVS code inside
-          // an MBB between the two blocks
-          llvm::MachineBasicBlock *NewFallthrough =
-              MF->CreateMachineBasicBlock();
-          MF->insert(MBB.getNextNode()->getIterator(), NewFallthrough);
-          NewFallthrough->addSuccessor(SuccessorMBB);
-          OldToNewSuccessorsList.emplace_back(SuccessorMBB, NewFallthrough);
-        }
-      }
-    }
-    // Insert the new branch if needed
-    if ((NewFBB != nullptr && FBB != nullptr) ||
-        (NewTBB != nullptr && TBB != nullptr)) {
-      auto DebugLoc = MBB.getFirstInstrTerminator()->getDebugLoc();
-      TII.removeBranch(MBB);
-      TII.insertBranch(MBB, NewTBB, NewFBB, Cond, DebugLoc);
-      for (const auto &[OldSuccessor, NewSuccessor] : OldToNewSuccessorsList) {
-        MBB.removeSuccessor(OldSuccessor);
-        MBB.addSuccessor(NewSuccessor);
-      }
+      if (SuccessorIntervalBegin.getSVS() == MBBIntervals.back().getSVS())
+        return SwitchBlocks[SuccessorMBB] = SuccessorMBB;
+      auto *SwitchMBB = MF->CreateMachineBasicBlock();
+      MF->insert(MF->end(), SwitchMBB);
+      TII.insertUnconditionalBranch(*SwitchMBB, SuccessorMBB,
+                                    llvm::DebugLoc());
+      SwitchMBB->addSuccessor(SuccessorMBB);
+      // Emit the SVS switch code before the branch
+      MBBIntervals.back().getSVS().emitCodeToSwitchSVS(
+          SwitchMBB->front(), SuccessorIntervalBegin.getSVS());
+      MBB->replaceSuccessor(SuccessorMBB, SwitchMBB);
+      return SwitchBlocks[SuccessorMBB] = SwitchMBB;
+    };
+    llvm::MachineBasicBlock *NewTBB = GetEdgeTarget(TBB);
+    llvm::MachineBasicBlock *NewFBB = GetEdgeTarget(FBB);
+    llvm::MachineBasicBlock *NewFallthroughMBB = GetEdgeTarget(FallthroughMBB);
+    if (NewTBB == TBB && NewFBB == FBB && NewFallthroughMBB == FallthroughMBB)
+      continue;
+    // Insert the new branch; A fall through redirected to a switch block
+    // becomes an explicit branch
+    if (NewFallthroughMBB != FallthroughMBB) {
+      if (NewTBB == nullptr)
+        NewTBB = NewFallthroughMBB;
+      else
+        NewFBB = NewFallthroughMBB;
     }
+    auto DebugLoc = MBB->findBranchDebugLoc();
+    TII.removeBranch(*MBB);
+    TII.insertBranch(*MBB, NewTBB, NewFBB, Cond, DebugLoc);
   }
 }
 
+/// Moves the kernel preamble, emitted before \p EntryInstr, out of the entry
+/// block of the kernel and into a block at the end of the kernel
+/// \details The entry block is left with a single branch to the preamble,
+/// which branches back to the rest of the original entry block once done.
+/// This way, the application code of the kernel starts right after the
+/// branch, and is not pushed down by the preamble
+static void outlineKernelPreamble(llvm::MachineInstr &EntryInstr) {
+  auto &EntryMBB = *EntryInstr.getParent();
+  auto &MF = *EntryMBB.getParent();
+  if (EntryMBB.begin() == EntryInstr.getIterator())
+    return;
+  const auto &TII = *MF.getSubtarget().getInstrInfo();
+  // Move the app instructions of the entry block into a block right after it
+  auto *AppEntryMBB = MF.CreateMachineBasicBlock();
+  MF.insert(std::next(EntryMBB.getIterator()), AppEntryMBB);
+  AppEntryMBB->splice(AppEntryMBB->end(), &EntryMBB, EntryInstr.getIterator(),
+                      EntryMBB.end());
+  AppEntryMBB->transferSuccessors(&EntryMBB);
+  // Move the preamble into a block at the end of the function
+  auto *PreambleMBB = MF.CreateMachineBasicBlock();
+  MF.insert(MF.end(), PreambleMBB);
+  PreambleMBB->splice(PreambleMBB->end(), &EntryMBB, EntryMBB.begin(),
+                      EntryMBB.end());
+  TII.insertUnconditionalBranch(*PreambleMBB, AppEntryMBB, llvm::DebugLoc());
+  PreambleMBB->addSuccessor(AppEntryMBB);
+  TII.insertUnconditionalBranch(EntryMBB, PreambleMBB, llvm::DebugLoc());
+  EntryMBB.addSuccessor(PreambleMBB);
+}
+
 llvm::AnalysisKey FunctionPreambleDescriptorAnalysis::Key;
 
 FunctionPreambleDescriptorAnalysis::Result
@@ -569,7 +610,10 @@ PrePostAmbleEmitter::run(llvm::Module &TargetModule,
                     llvm::AMDGPUFunctionArgInfo::KERNARG_SEGMENT_PTR},
           {DISPATCH_ID, llvm::AMDGPUFunctionArgInfo::DISPATCH_ID},
           {DISPATCH_PTR, llvm::AMDGPUFunctionArgInfo::DISPATCH_PTR},
-          {QUEUE_PTR, llvm::AMDGPUFunctionArgInfo::QUEUE_PTR}}) {
+          {QUEUE_PTR, llvm::AMDGPUFunctionArgInfo::QUEUE_PTR},
+          {WORKGROUP_ID_X, llvm::AMDGPUFunctionArgInfo::WORKGROUP_ID_X},
+          {WORKGROUP_ID_Y, llvm::AMDGPUFunctionArgInfo::WORKGROUP_ID_Y},
+          {WORKGROUP_ID_Z, llvm::AMDGPUFunctionArgInfo::WORKGROUP_ID_Z}}) {
       if (SVAInfo.RequestedKernelArguments.contains(KernArg)) {
         auto StoreSlotBegin =
             stateValueArray::getKernelArgumentLaneIdStoreSlotBeginForWave64(
@@ -584,6 +628,19 @@ PrePostAmbleEmitter::run(llvm::Module &TargetModule,
           TargetModule.getContext().emitError(toString(std::move(Err)));
           return llvm::PreservedAnalyses::all();
         }
+        // System SGPRs cannot be enabled after the kernel has been
+        // compiled; A workgroup ID not enabled by the kernel is stored
+        // as zero
+        if (!getArgReg(*MF, PreloadValue) && KernArg >= WORKGROUP_ID_X &&
+            KernArg <= WORKGROUP_ID_Z) {
+          llvm::BuildMI(*EntryInstr->getParent(), EntryInstr,
+                        llvm::DebugLoc(),
+                        TII->get(llvm::AMDGPU::V_WRITELANE_B32), SVSStorageReg)
+              .addImm(0)
+              .addImm(*StoreSlotBegin)
+              .addReg(SVSStorageReg);
+          continue;
+        }
         if (auto Err = emitCodeToStoreSGPRKernelArg(
                 *EntryInstr, getArgReg(*MF, PreloadValue), SVSStorageReg,
                 *StoreSlotBegin, *StoreSlotSize,
@@ -632,6 +689,9 @@ PrePostAmbleEmitter::run(llvm::Module &TargetModule,
     for (auto &[FuncSymbol, MF] : LR.functions()) {
       emitCodeToMoveSVA(TargetMAM, TargetModule, MF, SVLocations);
     }
+
+    if (OutlineKernelPreamble)
+      outlineKernelPreamble(*EntryInstr);
   }
   return llvm::PreservedAnalyses::all();
 }
@@ -27,8 +27,16 @@
 #include "tooling_common/StateValueArrayStorage.hpp"
 #include "tooling_common/WrapperAnalysisPasses.hpp"
 #include <GCNSubtarget.h>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <llvm/CodeGen/MachineDominators.h>
+#include <llvm/CodeGen/MachineLoopInfo.h>
 #include <llvm/CodeGen/TargetRegisterInfo.h>
 #include <llvm/CodeGen/TargetSubtargetInfo.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <luthier/llvm/streams.h>
 
 #include <utility>
 
@@ -37,6 +45,28 @@
 
 namespace luthier {
 
+/// Algorithms used for scheduling the storage of the state value array in
+/// functions without a fixed storage location
+enum class SVAStorageSchedulerKind { Greedy, Global };
+
+static llvm::cl::opt<SVAStorageSchedulerKind> SVAStorageScheduler(
+    "luthier-sva-storage-scheduler",
+    llvm::cl::desc("Algorithm used to schedule the storage of the state value "
+                   "array when no fixed storage location is available"),
+    llvm::cl::values(
+        clEnumValN(SVAStorageSchedulerKind::Greedy, "greedy",
+                   "Relocate the storage whenever its registers become live"),
+        clEnumValN(SVAStorageSchedulerKind::Global, "global",
+                   "Minimize the estimated number of executed storage "
+                   "switches, loads, and stores over the whole function")),
+    llvm::cl::init(SVAStorageSchedulerKind::Global));
+
+static llvm::cl::opt<bool> PrintSVAStorageCost(
+    "luthier-print-sva-storage-cost",
+    llvm::cl::desc("Print the estimated number of instructions injected to "
+                   "manage the state value array storage of each function."),
+    llvm::cl::init(false));
+
 /// Scavenges \p NumRegs registers with class \p RC available in \p MRI
 /// Availability means a register is allocatable and not in \p MRI and
 /// is not in \p AccessedPhysicalRegsNotInLiveIns and not in \p LiveInRegs
@@ -384,6 +414,295 @@ static std::shared_ptr<StateValueArrayStorage> findStateValueArrayStorageAtMI(
         StateValueArrayVGPRLocation);
 }
 
+/// Multiplier applied to the estimated execution frequency of a basic block
+/// for each loop it is nested in
+static constexpr double LoopFrequencyMultiplier = 8.0;
+
+/// Loop depth after which the estimated frequency of a block stops growing
+static constexpr unsigned int MaxEstimatedLoopDepth = 6;
+
+/// Maximum number of candidate storage locations considered by the global
+/// SVA storage scheduler; Sets of candidates are kept in 32-bit masks, and
+/// candidate indices in 8-bit integers
+static constexpr unsigned int MaxNumSVSCandidates = 8;
+
+static_assert(MaxNumSVSCandidates <= 32,
+              "Candidate masks cannot hold more than 32 candidates.");
+
+/// Estimates how many times each basic block of \p MF executes per invocation
+/// of \p MF, using its loop depth
+/// \param [in] MF the machine function being analyzed
+/// \param [out] BlockFrequencies the estimated frequency of each basic block
+static void estimateBlockFrequencies(
+    const llvm::MachineFunction &MF,
+    llvm::DenseMap<const llvm::MachineBasicBlock *, double>
+        &BlockFrequencies) {
+  llvm::DomTreeBase<llvm::MachineBasicBlock> DT;
+  DT.recalculate(const_cast<llvm::MachineFunction &>(MF));
+  llvm::LoopInfoBase<llvm::MachineBasicBlock, llvm::MachineLoop> LI;
+  LI.analyze(DT);
+  for (const auto &MBB : MF) {
+    BlockFrequencies[&MBB] =
+        std::pow(LoopFrequencyMultiplier,
+                 std::min(LI.getLoopDepth(&MBB), MaxEstimatedLoopDepth));
+  }
+}
+
+/// \return a rough estimate of the number of instructions emitted around each
+/// hook to load the state value array from \p SVS and store it back
+/// afterwards, based on the sequences emitted by \c StateValueArrayStorage
+static unsigned int getSVALoadAndStoreCost(const StateValueArrayStorage &SVS) {
+  switch (SVS.getScheme()) {
+  case StateValueArrayStorage::SVS_SINGLE_VGPR:
+  case StateValueArrayStorage::SVS_ONE_AGPR_post_gfx908:
+    return 0;
+  case StateValueArrayStorage::SVS_TWO_AGPRs_pre_gfx908:
+    return 16;
+  case StateValueArrayStorage::SVS_SINGLE_AGPR_WITH_THREE_SGPRS_pre_gfx908:
+  case StateValueArrayStorage::SVS_SPILLED_WITH_THREE_SGPRS_absolute_fs:
+    return 30;
+  case StateValueArrayStorage::SVS_SPILLED_WITH_ONE_SGPR_architected_fs:
+    return 18;
+  }
+  llvm_unreachable("Invalid SVA storage Enum value.");
+}
+
+/// \return \c true if \c StateValueArrayStorage::emitCodeToSwitchSVS can
+/// move the state value array from a storage of scheme \p Src to a storage
+/// of scheme \p Dst
+static bool canSwitchSVS(StateValueArrayStorage::StorageKind Src,
+                         StateValueArrayStorage::StorageKind Dst) {
+  using SVAStorage = StateValueArrayStorage;
+  if (Src == Dst || Dst == SVAStorage::SVS_SINGLE_VGPR)
+    return true;
+  switch (Src) {
+  case SVAStorage::SVS_SINGLE_VGPR:
+    return true;
+  case SVAStorage::SVS_ONE_AGPR_post_gfx908:
+    return Dst == SVAStorage::SVS_SPILLED_WITH_THREE_SGPRS_absolute_fs ||
+           Dst == SVAStorage::SVS_SPILLED_WITH_ONE_SGPR_architected_fs;
+  case SVAStorage::SVS_TWO_AGPRs_pre_gfx908:
+  case SVAStorage::SVS_SINGLE_AGPR_WITH_THREE_SGPRS_pre_gfx908:
+    return Dst == SVAStorage::SVS_TWO_AGPRs_pre_gfx908 ||
+           Dst == SVAStorage::SVS_SINGLE_AGPR_WITH_THREE_SGPRS_pre_gfx908 ||
+           Dst == SVAStorage::SVS_SPILLED_WITH_THREE_SGPRS_absolute_fs;
+  case SVAStorage::SVS_SPILLED_WITH_THREE_SGPRS_absolute_fs:
+    return Dst != SVAStorage::SVS_SPILLED_WITH_ONE_SGPR_architected_fs;
+  case SVAStorage::SVS_SPILLED_WITH_ONE_SGPR_architected_fs:
+    return Dst == SVAStorage::SVS_ONE_AGPR_post_gfx908;
+  }
+  llvm_unreachable("Invalid SVA storage Enum value.");
+}
+
+/// \return a rough estimate of the number of instructions emitted by
+/// \c StateValueArrayStorage::emitCodeToSwitchSVS to move the state value
+/// array from \p Src to \p Dst, or infinity if it cannot be moved directly
+static double getSVSSwitchCost(const StateValueArrayStorage &Src,
+                               const StateValueArrayStorage &Dst) {
+  if (&Src == &Dst || Src == Dst)
+    return 0;
+  if (!canSwitchSVS(Src.getScheme(), Dst.getScheme()))
+    return std::numeric_limits<double>::infinity();
+  bool IsSrcInReg = Src.getStateValueStorageReg() != 0;
+  bool IsDstInReg = Dst.getStateValueStorageReg() != 0;
+  // SGPRs of the destination either get copied from the source, or have to
+  // be read from the lanes of the SVA
+  unsigned int SGPRCost = Src.getNumSGPRsUsed() == 0
+                              ? 3 * Dst.getNumSGPRsUsed()
+                              : Dst.getNumSGPRsUsed();
+  // Moves on both halves of the exec mask, plus saving and restoring SCC
+  if (IsSrcInReg && IsDstInReg)
+    return 6 + SGPRCost;
+  if (!IsSrcInReg && !IsDstInReg)
+    return SGPRCost;
+  // Scratch accesses on both halves of the exec mask, flat scratch swaps,
+  // and a wait on the memory operation
+  return 16 + SGPRCost;
+}
+
+/// Picks \p NumRegs registers of class \p RC that are occupied by the app
+/// the least according to \p RegOccupancy
+/// \param [in] MRI the \c llvm::MachineRegisterInfo of the function
+/// \param [in] RC the register class to pick registers from
+/// \param [in] RegOccupancy estimated number of executed instructions in
+/// which each register is either live or accessed, indexed by register
+/// \param [in] AccessedPhysicalRegsNotInLiveIns physical registers accessed
+/// by injected payloads which are not in the live-ins of their
+/// instrumentation point; These are never picked
+/// \param [in] NumRegs maximum number of registers to pick
+/// \param [out] Regs the picked registers, least occupied first
+static void pickLeastOccupiedRegisters(
+    const llvm::MachineRegisterInfo &MRI, const llvm::TargetRegisterClass &RC,
+    llvm::ArrayRef<double> RegOccupancy,
+    const llvm::LivePhysRegs &AccessedPhysicalRegsNotInLiveIns,
+    unsigned int NumRegs, llvm::SmallVectorImpl<llvm::MCRegister> &Regs) {
+  llvm::SmallVector<llvm::MCRegister> AllocatableRegs;
+  for (llvm::MCRegister Reg : reverse(RC)) {
+    if (MRI.isAllocatable(Reg) &&
+        (AccessedPhysicalRegsNotInLiveIns.empty() ||
+         AccessedPhysicalRegsNotInLiveIns.available(MRI, Reg)))
+      AllocatableRegs.push_back(Reg);
+  }
+  // Stable sorting prefers higher numbered registers among equally
+  // occupied ones, same as the other scavenging routines
+  llvm::stable_sort(AllocatableRegs, [&](llvm::MCRegister A,
+                                         llvm::MCRegister B) {
+    return RegOccupancy[A] < RegOccupancy[B];
+  });
+  for (llvm::MCRegister Reg : llvm::take_front(
+           AllocatableRegs, std::min<size_t>(NumRegs, AllocatableRegs.size())))
+    Regs.push_back(Reg);
+}
+
+/// \return \c true if none of the registers of \p SVS are in \p LiveIns or
+/// accessed by \p MI, meaning \p SVS can hold the state value array while
+/// \p MI executes; If \p MI is \c nullptr, only \p LiveIns is checked
+static bool isSVSUsableAt(const StateValueArrayStorage &SVS,
+                          const llvm::MachineInstr *MI,
+                          const llvm::LivePhysRegs &LiveIns,
+                          const llvm::MachineRegisterInfo &MRI,
+                          const llvm::TargetRegisterInfo &TRI) {
+  llvm::SmallVector<llvm::MCRegister, 4> SVSRegs;
+  SVS.getAllStorageRegisters(SVSRegs);
+  return llvm::all_of(SVSRegs, [&](llvm::MCRegister Reg) {
+    return LiveIns.available(MRI, Reg) &&
+           (MI == nullptr || (!MI->readsRegister(Reg, &TRI) &&
+                              !MI->modifiesRegister(Reg, &TRI)));
+  });
+}
+
+/// \brief Where each candidate state value array storage can be used inside
+/// a basic block, used by the global SVA storage scheduler
+struct SVSBlockConstraints {
+  /// Estimated number of times the block executes per function invocation
+  double Frequency{1.0};
+  /// Whether the block has any successors
+  bool HasSuccessors{false};
+  /// Index of the first instruction from which the SVA must be kept in its
+  /// home location until the end of the block
+  size_t FirstHomeInstr{0};
+  /// Mask of candidates that can hold the SVA when entering the block
+  uint32_t UsableOnEntry{0};
+  /// Mask of candidates that can hold the SVA at each instruction
+  llvm::SmallVector<uint32_t> UsableCandidates{};
+  /// Whether each instruction of the block is a hook insertion point
+  llvm::SmallVector<bool> IsHookInsertionPoint{};
+};
+
+/// Finds the sequence of storage locations for the SVA inside a single
+/// basic block with the lowest cost, by dynamic programming over its
+/// instructions
+/// \param BC the constraints of the block
+/// \param StartCandidates mask of candidates allowed to hold the SVA on
+/// entry to the block
+/// \param Home the candidate that must hold the SVA when leaving the block,
+/// if the block has successors
+/// \param HookCosts the cost of each candidate at a hook insertion point
+/// \param SwitchCosts the cost of switching between each pair of candidates
+/// \param [out] Schedule the candidate holding the SVA on entry to the block,
+/// followed by the candidate holding it at each instruction
+/// \return the cost of the schedule, or infinity if no schedule exists
+static double scheduleSVSInBlock(
+    const SVSBlockConstraints &BC, uint32_t StartCandidates,
+    unsigned int Home, llvm::ArrayRef<double> HookCosts,
+    llvm::ArrayRef<llvm::SmallVector<double, MaxNumSVSCandidates>>
+        SwitchCosts,
+    llvm::SmallVectorImpl<uint8_t> &Schedule) {
+  constexpr double Infinity = std::numeric_limits<double>::infinity();
+  unsigned int NumCandidates = HookCosts.size();
+  size_t NumInstrs = BC.UsableCandidates.size();
+  // Cost of the cheapest schedule up to the current instruction, ending
+  // at each candidate
+  llvm::SmallVector<double, MaxNumSVSCandidates> Costs(NumCandidates,
+                                                       Infinity);
+  llvm::SmallVector<double, MaxNumSVSCandidates> NextCosts(NumCandidates);
+  // The candidate preceding each candidate in the cheapest schedule at each
+  // instruction
+  llvm::SmallVector<std::array<uint8_t, MaxNumSVSCandidates>> Preds(NumInstrs);
+  for (unsigned int C = 0; C < NumCandidates; C++) {
+    if (StartCandidates & BC.UsableOnEntry & (1U << C))
+      Costs[C] = 0;
+  }
+  for (size_t I = 0; I < NumInstrs; I++) {
+    uint32_t Allowed = BC.UsableCandidates[I];
+    if (BC.HasSuccessors && I >= BC.FirstHomeInstr)
+      Allowed &= 1U << Home;
+    for (unsigned int To = 0; To < NumCandidates; To++) {
+      NextCosts[To] = Infinity;
+      if (!(Allowed & (1U << To)))
+        continue;
+      for (unsigned int From = 0; From < NumCandidates; From++) {
+        double Cost = Costs[From] + SwitchCosts[From][To];
+        if (Cost < NextCosts[To]) {
+          NextCosts[To] = Cost;
+          Preds[I][To] = From;
+        }
+      }
+      if (BC.IsHookInsertionPoint[I])
+        NextCosts[To] += HookCosts[To];
+    }
+    std::swap(Costs, NextCosts);
+  }
+  unsigned int Last = NumCandidates;
+  double BestCost = Infinity;
+  for (unsigned int C = 0; C < NumCandidates; C++) {
+    if ((!BC.HasSuccessors || C == Home) && Costs[C] < BestCost) {
+      BestCost = Costs[C];
+      Last = C;
+    }
+  }
+  if (Last == NumCandidates)
+    return Infinity;
+  Schedule.assign(NumInstrs + 1, 0);
+  Schedule[NumInstrs] = Last;
+  for (size_t I = NumInstrs; I > 0; I--)
+    Schedule[I - 1] = Preds[I - 1][Schedule[I]];
+  return BestCost;
+}
+
+/// Estimates the number of instructions injected into \p MF to switch
+/// between the storage locations of the SVA and to load and store it around
+/// hooks, according to the schedule in \p SVLocations
+/// \return the number of injected instructions, and the number of executed
+/// injected instructions per invocation of \p MF weighted by estimated block
+/// frequencies
+static std::pair<uint64_t, double>
+estimateSVAStorageCost(const llvm::MachineFunction &MF,
+                       const SVStorageAndLoadLocations &SVLocations) {
+  llvm::DenseMap<const llvm::MachineBasicBlock *, double> BlockFrequencies;
+  estimateBlockFrequencies(MF, BlockFrequencies);
+  uint64_t StaticCost{0};
+  double WeightedCost{0};
+  auto AddCost = [&](double Cost, double Frequency) {
+    assert(std::isfinite(Cost) && "Unsupported SVS switch in the schedule.");
+    StaticCost += static_cast<uint64_t>(Cost);
+    WeightedCost += Cost * Frequency;
+  };
+  for (const auto &MBB : MF) {
+    double Frequency = BlockFrequencies.at(&MBB);
+    auto Segments = SVLocations.getStorageIntervals(MBB);
+    if (Segments.empty())
+      continue;
+    for (size_t I = 1; I < Segments.size(); I++)
+      AddCost(getSVSSwitchCost(Segments[I - 1].getSVS(), Segments[I].getSVS()),
+              Frequency);
+    for (const auto *Succ : MBB.successors()) {
+      auto SuccSegments = SVLocations.getStorageIntervals(*Succ);
+      if (!SuccSegments.empty())
+        AddCost(getSVSSwitchCost(Segments.back().getSVS(),
+                                 SuccSegments.front().getSVS()),
+                Frequency);
+    }
+    for (const auto &MI : MBB) {
+      if (auto *LoadPlan =
+              SVLocations.getStateValueArrayLoadPlanForInstPoint(MI))
+        AddCost(getSVALoadAndStoreCost(LoadPlan->StateValueStorageLocation),
+                Frequency);
+    }
+  }
+  return {StaticCost, WeightedCost};
+}
+
 llvm::ArrayRef<StateValueStorageSegment>
 SVStorageAndLoadLocations::getStorageIntervals(
     const llvm::MachineBasicBlock &MBB) const {
@@ -404,12 +723,336 @@ SVStorageAndLoadLocations::getStateValueArrayLoadPlanForInstPoint(
     return &It->second;
 }
 
+llvm::Error SVStorageAndLoadLocations::scheduleStorageGreedily(
+    llvm::MachineFunction &MF, const llvm::SlotIndexes &SlotIndexes,
+    const AMDGPURegisterLiveness &RegLiveness,
+    const InjectedPayloadAndInstPoint &IPIP,
+    llvm::ArrayRef<StateValueArrayStorage::StorageKind> SupportedStorage,
+    int MaxNumAGPRsUsedByAllStorage, int MaxNumSGPRsUsedByAllStorage,
+    const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns) {
+  auto &MRI = MF.getRegInfo();
+  // Pick the highest numbered VGPR not accessed by the Hooks
+  // to hold the value state
+  // TODO: is there a more informed way to do initialize this?
+  // TODO: if an argument is passed specifying to keep the register
+  // usage of the kernel the same as before, these needs to be initialized
+  // to the last available SGPR/VGPR/AGPR
+  auto EntryMILiveIns =
+      RegLiveness.getMFLevelInstrLiveIns(*MF.begin()->begin());
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      EntryMILiveIns != nullptr,
+      "Failed to obtain the live physical regs for MI {0}.",
+      *MF.begin()->begin()));
+  // Keep a copy of the entry live-ins, as they are used throughout the
+  // function while the liveness analysis only keeps its query results
+  // around for a limited time
+  llvm::LivePhysRegs FirstMILiveIns(*MF.getSubtarget().getRegisterInfo());
+  for (llvm::MCPhysReg Reg : *EntryMILiveIns)
+    FirstMILiveIns.addReg(Reg);
+
+  // The current location of the state value register
+  std::shared_ptr<StateValueArrayStorage> SVS =
+      findStateValueArrayStorageAtMI(
+          MRI, FirstMILiveIns, AccessedPhysicalRegistersNotInLiveIns,
+          SupportedStorage, MaxNumAGPRsUsedByAllStorage,
+          MaxNumSGPRsUsedByAllStorage);
+
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      SVS != nullptr,
+      "Failed to get a state value array storage for MI {0}.",
+      *MF.begin()->begin()));
+
+  LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+      llvm::isa<VGPRStateValueArrayStorage>(SVS.get()) ||
+          llvm::isa<SingleAGPRStateValueArrayStorage>(SVS.get()),
+      "The entry SVS must be stored in a VGPR or an AGPR."));
+
+  // A set of hook insertion points that fall into the current interval
+  llvm::SmallDenseSet<const llvm::MachineInstr *, 4>
+      HookInsertionPointsInCurrentSegment{};
+  for (const auto &MBB : MF) {
+    // Marks the beginning of the current interval we are in this loop
+    llvm::SlotIndex CurrentIntervalBegin =
+        SlotIndexes.getMBBStartIdx(&MBB);
+
+    auto &CurrentMBBSegments =
+        StateValueStorageIntervals.insert({&MBB, {}}).first->getSecond();
+    for (const auto &MI : MBB) {
+      if (IPIP.contains(MI))
+        HookInsertionPointsInCurrentSegment.insert(&MI);
+      auto *InstrLiveRegs = RegLiveness.getMFLevelInstrLiveIns(MI);
+      LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+          InstrLiveRegs != nullptr,
+          "Failed to get the live physical register set for MI {0}.", MI));
+      // - If we have spilled the state value reg and this instruction
+      // will require a hook to be inserted, then we try to relocate the
+      // SVS. In this instance, since the hook will have to load the value
+      // state register anyway, we try and see if after loading it, we can
+      // store it in a V/AGPR.
+      // - If the SVS registers are going to be used, we must relocate
+      // the SVS.
+      // - Otherwise, we keep the SVS in its place.
+      bool TryRelocatingValueStateReg =
+          SVS->getStateValueStorageReg() == 0 && IPIP.contains(MI);
+      llvm::SmallVector<llvm::MCRegister, 4> SVSRegs;
+      SVS->getAllStorageRegisters(SVSRegs);
+      bool MustRelocateStateValue =
+          llvm::any_of(SVSRegs, [&](llvm::MCRegister Reg) {
+            return !InstrLiveRegs->available(MF.getRegInfo(), Reg);
+          });
+      // If we have to relocate something, then create a new interval
+      // for it;
+      // Note that reg scavenging might conclude that the values remain
+      // where they are, and that's okay
+      // Also create a new interval if we reach the end of a MBB
+      if (&MI == &MBB.back() || TryRelocatingValueStateReg ||
+          MustRelocateStateValue) {
+        auto NextIndex = &MI == &MBB.back()
+                             ? SlotIndexes.getMBBEndIdx(&MBB)
+                             : SlotIndexes.getInstructionIndex(MI);
+        CurrentMBBSegments.emplace_back(CurrentIntervalBegin, NextIndex,
+                                        SVS);
+        for (const auto &HookMI : HookInsertionPointsInCurrentSegment) {
+          auto *HookLiveRegs = RegLiveness.getMFLevelInstrLiveIns(*HookMI);
+          auto [HookSVGPR, ClobbersAppReg] =
+              selectVGPRLoadLocationForInjectedPayload(
+                  *HookMI, *SVS, *HookLiveRegs,
+                  AccessedPhysicalRegistersNotInLiveIns, false);
+          InstPointSVSLoadPlans.insert(
+              {HookMI, {HookSVGPR, ClobbersAppReg, *SVS}});
+        }
+        HookInsertionPointsInCurrentSegment.clear();
+        CurrentIntervalBegin = NextIndex;
+      }
+      if (TryRelocatingValueStateReg || MustRelocateStateValue) {
+        SVS = findStateValueArrayStorageAtMI(
+            MRI, FirstMILiveIns, AccessedPhysicalRegistersNotInLiveIns,
+            SupportedStorage, MaxNumAGPRsUsedByAllStorage,
+            MaxNumSGPRsUsedByAllStorage);
+        LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+            SVS != nullptr, "Failed to relocate the SVA storage."));
+      }
+    }
+  }
+  return llvm::Error::success();
+}
+
+llvm::Expected<bool> SVStorageAndLoadLocations::scheduleStorageGlobally(
+    llvm::MachineFunction &MF, const llvm::SlotIndexes &SlotIndexes,
+    const AMDGPURegisterLiveness &RegLiveness,
+    const InjectedPayloadAndInstPoint &IPIP,
+    llvm::ArrayRef<StateValueArrayStorage::StorageKind> SupportedStorage,
+    const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns) {
+  if (MF.empty())
+    return false;
+  auto &MRI = MF.getRegInfo();
+  auto &TRI = *MF.getSubtarget().getRegisterInfo();
+  llvm::DenseMap<const llvm::MachineBasicBlock *, double> BlockFrequencies;
+  estimateBlockFrequencies(MF, BlockFrequencies);
+
+  // Estimate how many times each register is occupied by the app during a
+  // single invocation of MF, to pick the registers most likely to be free
+  // as candidates for storing the SVA
+  llvm::SmallVector<double> RegOccupancy(TRI.getNumRegs(), 0.0);
+  for (const auto &MBB : MF) {
+    double Freq = BlockFrequencies.at(&MBB);
+    for (const auto &MI : MBB) {
+      auto *LiveIns = RegLiveness.getMFLevelInstrLiveIns(MI);
+      LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+          LiveIns != nullptr,
+          "Failed to get the live physical register set for MI {0}.", MI));
+      for (llvm::MCPhysReg Reg : *LiveIns)
+        RegOccupancy[Reg] += Freq;
+      for (const auto &Op : MI.operands()) {
+        if (!Op.isReg() || !Op.getReg().isPhysical())
+          continue;
+        for (llvm::MCRegAliasIterator Alias(Op.getReg(), &TRI, true);
+             Alias.isValid(); ++Alias)
+          RegOccupancy[*Alias] += Freq;
+      }
+    }
+  }
+  llvm::SmallVector<llvm::MCRegister, 2> VGPRs;
+  llvm::SmallVector<llvm::MCRegister, 2> AGPRs;
+  llvm::SmallVector<llvm::MCRegister, 3> SGPRs;
+  pickLeastOccupiedRegisters(MRI, llvm::AMDGPU::VGPR_32RegClass, RegOccupancy,
+                             AccessedPhysicalRegistersNotInLiveIns, 2, VGPRs);
+  pickLeastOccupiedRegisters(MRI, llvm::AMDGPU::AGPR_32RegClass, RegOccupancy,
+                             AccessedPhysicalRegistersNotInLiveIns, 2, AGPRs);
+  pickLeastOccupiedRegisters(MRI, llvm::AMDGPU::SGPR_32RegClass, RegOccupancy,
+                             AccessedPhysicalRegistersNotInLiveIns, 3, SGPRs);
+
+  // Form the candidate storage locations out of the picked registers
+  llvm::SmallVector<std::shared_ptr<StateValueArrayStorage>,
+                    MaxNumSVSCandidates>
+      Candidates;
+  for (const auto &Scheme : SupportedStorage) {
+    if (Scheme == StateValueArrayStorage::SVS_SINGLE_VGPR) {
+      for (llvm::MCRegister VGPR : VGPRs)
+        Candidates.push_back(
+            std::make_shared<VGPRStateValueArrayStorage>(VGPR));
+    } else if (Scheme == StateValueArrayStorage::SVS_ONE_AGPR_post_gfx908) {
+      for (llvm::MCRegister AGPR : AGPRs)
+        Candidates.push_back(
+            std::make_shared<SingleAGPRStateValueArrayStorage>(AGPR));
+    } else if (StateValueArrayStorage::getNumAGPRsUsed(Scheme) <=
+                   AGPRs.size() &&
+               StateValueArrayStorage::getNumSGPRsUsed(Scheme) <=
+                   SGPRs.size()) {
+      auto SVS =
+          StateValueArrayStorage::createSVAStorage({}, AGPRs, SGPRs, Scheme);
+      LUTHIER_RETURN_ON_ERROR(SVS.takeError());
+      Candidates.push_back(std::move(*SVS));
+    }
+  }
+  if (Candidates.empty())
+    return false;
+  // Candidates are formed in order of preference; Drop the least preferred
+  // ones if there are more than the scheduler can track
+  if (Candidates.size() > MaxNumSVSCandidates)
+    Candidates.resize(MaxNumSVSCandidates);
+  unsigned int NumCandidates = Candidates.size();
+
+  // Estimated costs of using each candidate at a hook, and of switching
+  // between each pair of candidates
+  llvm::SmallVector<double, MaxNumSVSCandidates> HookCosts;
+  llvm::SmallVector<llvm::SmallVector<double, MaxNumSVSCandidates>,
+                    MaxNumSVSCandidates>
+      SwitchCosts(NumCandidates);
+  for (unsigned int I = 0; I < NumCandidates; I++) {
+    HookCosts.push_back(getSVALoadAndStoreCost(*Candidates[I]));
+    for (unsigned int J = 0; J < NumCandidates; J++)
+      SwitchCosts[I].push_back(
+          getSVSSwitchCost(*Candidates[I], *Candidates[J]));
+  }
+
+  // Kernels and device functions receive the SVA in a V/AGPR on entry
+  uint32_t EntryCandidates{0};
+  for (unsigned int I = 0; I < NumCandidates; I++) {
+    if (llvm::isa<VGPRStateValueArrayStorage>(Candidates[I].get()) ||
+        llvm::isa<SingleAGPRStateValueArrayStorage>(Candidates[I].get()))
+      EntryCandidates |= 1U << I;
+  }
+
+  // Find where each candidate can hold the SVA inside each block
+  llvm::DenseMap<const llvm::MachineBasicBlock *, SVSBlockConstraints>
+      BlockConstraints;
+  for (const auto &MBB : MF) {
+    auto &BC = BlockConstraints[&MBB];
+    BC.Frequency = BlockFrequencies.at(&MBB);
+    BC.HasSuccessors = !MBB.succ_empty();
+    BC.FirstHomeInstr = MBB.size();
+    if (MBB.empty()) {
+      // Nothing inside the block can conflict with any of the candidates
+      BC.UsableOnEntry = (1U << NumCandidates) - 1;
+    } else if (BC.HasSuccessors) {
+      // The SVA must be back in its home location before the block's
+      // terminators, or before its last instruction if it falls through
+      auto FirstTerm = MBB.getFirstTerminator();
+      BC.FirstHomeInstr = FirstTerm != MBB.end()
+                              ? std::distance(MBB.begin(), FirstTerm)
+                              : MBB.size() - 1;
+    }
+    for (const auto &MI : MBB) {
+      auto *LiveIns = RegLiveness.getMFLevelInstrLiveIns(MI);
+      LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+          LiveIns != nullptr,
+          "Failed to get the live physical register set for MI {0}.", MI));
+      uint32_t Usable{0};
+      for (unsigned int I = 0; I < NumCandidates; I++) {
+        if (&MI == &MBB.front() &&
+            isSVSUsableAt(*Candidates[I], nullptr, *LiveIns, MRI, TRI))
+          BC.UsableOnEntry |= 1U << I;
+        if (isSVSUsableAt(*Candidates[I], &MI, *LiveIns, MRI, TRI))
+          Usable |= 1U << I;
+      }
+      BC.UsableCandidates.push_back(Usable);
+      BC.IsHookInsertionPoint.push_back(IPIP.contains(MI));
+    }
+  }
+
+  // Pick the home location which results in the lowest cost over the
+  // whole function, by scheduling each block in isolation
+  const auto &EntryMBB = MF.front();
+  double BestCost = std::numeric_limits<double>::infinity();
+  unsigned int BestHome = NumCandidates;
+  llvm::SmallVector<uint8_t> BlockSchedule;
+  // All blocks except a loop-free entry block must be entered with the SVA
+  // in its home location
+  auto GetStartCandidates = [&](const llvm::MachineBasicBlock &MBB,
+                                unsigned int Home) -> uint32_t {
+    if (&MBB != &EntryMBB)
+      return 1U << Home;
+    return MBB.pred_empty() ? EntryCandidates
+                            : EntryCandidates & (1U << Home);
+  };
+  for (unsigned int Home = 0; Home < NumCandidates; Home++) {
+    double Cost = 0;
+    for (const auto &MBB : MF) {
+      auto &BC = BlockConstraints[&MBB];
+      uint32_t StartCandidates = GetStartCandidates(MBB, Home);
+      Cost += BC.Frequency * scheduleSVSInBlock(BC, StartCandidates, Home,
+                                                HookCosts, SwitchCosts,
+                                                BlockSchedule);
+      if (Cost >= BestCost)
+        break;
+    }
+    if (Cost < BestCost) {
+      BestCost = Cost;
+      BestHome = Home;
+    }
+  }
+  if (BestHome == NumCandidates)
+    return false;
+  LLVM_DEBUG(llvm::dbgs() << "Selected SVA storage candidate " << BestHome
+                          << " as the home location of " << MF.getName()
+                          << " with estimated cost " << BestCost << ".\n";);
+
+  // Re-schedule each block with the best home location, and record the
+  // resulting storage intervals and load plans
+  for (const auto &MBB : MF) {
+    auto &BC = BlockConstraints[&MBB];
+    uint32_t StartCandidates = GetStartCandidates(MBB, BestHome);
+    (void)scheduleSVSInBlock(BC, StartCandidates, BestHome, HookCosts,
+                             SwitchCosts, BlockSchedule);
+    auto &Segments =
+        StateValueStorageIntervals.insert({&MBB, {}}).first->getSecond();
+    llvm::SlotIndex SegmentBegin = SlotIndexes.getMBBStartIdx(&MBB);
+    uint8_t CurrentSVS = BlockSchedule[0];
+    for (const auto &[I, MI] : llvm::enumerate(MBB)) {
+      uint8_t MISVS = BlockSchedule[I + 1];
+      if (MISVS != CurrentSVS) {
+        llvm::SlotIndex MIIndex = SlotIndexes.getInstructionIndex(MI);
+        Segments.emplace_back(SegmentBegin, MIIndex, Candidates[CurrentSVS]);
+        SegmentBegin = MIIndex;
+        CurrentSVS = MISVS;
+      }
+      if (BC.IsHookInsertionPoint[I]) {
+        auto *HookLiveRegs = RegLiveness.getMFLevelInstrLiveIns(MI);
+        LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
+            HookLiveRegs != nullptr,
+            "Failed to get the live physical register set for MI {0}.", MI));
+        auto [HookSVGPR, ClobbersAppReg] =
+            selectVGPRLoadLocationForInjectedPayload(
+                MI, *Candidates[MISVS], *HookLiveRegs,
+                AccessedPhysicalRegistersNotInLiveIns, false);
+        InstPointSVSLoadPlans.insert(
+            {&MI, {HookSVGPR, ClobbersAppReg, *Candidates[MISVS]}});
+      }
+    }
+    Segments.emplace_back(SegmentBegin, SlotIndexes.getMBBEndIdx(&MBB),
+                          Candidates[CurrentSVS]);
+  }
+  return true;
+}
+
 llvm::Error SVStorageAndLoadLocations::calculate(
     const llvm::MachineModuleInfo &TargetMMI, const llvm::Module &TargetM,
     const MMISlotIndexesAnalysis::Result &SlotIndexes,
     const AMDGPURegisterLiveness &RegLiveness,
     const InjectedPayloadAndInstPoint &IPIP, FunctionPreambleDescriptor &FPD,
-    const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns) {
+    const llvm::LivePhysRegs &AccessedPhysicalRegistersNotInLiveIns,
+    const OccupancyBudget &Budget) {
   llvm::SmallVector<llvm::MachineFunction *, 4> MFs;
   for (const auto &F : TargetM) {
     if (auto *MF = TargetMMI.getMachineFunction(F)) {
@@ -423,6 +1066,13 @@ llvm::Error SVStorageAndLoadLocations::calculate(
   // Get all the possible state value array storage for the sub-target being
   // used and check if we have at least only one method for storage
   const auto &ST = MFs[0]->getSubtarget<llvm::GCNSubtarget>();
+  // The state value array cannot be stored in or loaded into registers
+  // accessed by the injected payloads, or registers outside the occupancy
+  // budget
+  llvm::LivePhysRegs RegsNotUsableBySVA(*ST.getRegisterInfo());
+  for (llvm::MCPhysReg Reg : AccessedPhysicalRegistersNotInLiveIns)
+    RegsNotUsableBySVA.addReg(Reg);
+  Budget.addRegistersOutsideBudget(RegsNotUsableBySVA);
   llvm::SmallVector<StateValueArrayStorage::StorageKind, 6> SupportedStorage;
   getSupportedSVAStorageList(ST, SupportedStorage);
   LUTHIER_RETURN_ON_ERROR(
@@ -448,7 +1098,7 @@ llvm::Error SVStorageAndLoadLocations::calculate(
   // Try to find a fixed location to store the state value array
   auto StateValueFixedLocation = findFixedStateValueArrayStorage(
       MFs, SupportedStorage, MaxNumAGPRsUsedByAllStorage,
-      MaxNumSGPRsUsedByAllStorage, AccessedPhysicalRegistersNotInLiveIns);
+      MaxNumSGPRsUsedByAllStorage, RegsNotUsableBySVA);
 
   if (StateValueFixedLocation != nullptr) {
     // If a fixed location was found, then all MBB intervals inside all MFs
@@ -481,7 +1131,7 @@ llvm::Error SVStorageAndLoadLocations::calculate(
       auto [VGPRLocation, ClobbersAppReg] =
           selectVGPRLoadLocationForInjectedPayload(
               *InsertionPointMI, *StateValueFixedLocation, *HookLiveRegs,
-              AccessedPhysicalRegistersNotInLiveIns, true);
+              RegsNotUsableBySVA, true);
 
       InstPointSVSLoadPlans.insert(
           {InsertionPointMI, InstPointSVALoadPlan{VGPRLocation, ClobbersAppReg,
@@ -495,104 +1145,32 @@ llvm::Error SVStorageAndLoadLocations::calculate(
           llvm::CallingConv::AMDGPU_KERNEL) {
         FPD.DeviceFunctions[MF].RequiresPreAndPostAmble = true;
       }
-      auto &MRI = MF->getRegInfo();
-      // Pick the highest numbered VGPR not accessed by the Hooks
-      // to hold the value state
-      // TODO: is there a more informed way to do initialize this?
-      // TODO: if an argument is passed specifying to keep the register
-      // usage of the kernel the same as before, these needs to be initialized
-      // to the last available SGPR/VGPR/AGPR
-      auto FirstMILiveIns =
-          RegLiveness.getMFLevelInstrLiveIns(*MF->begin()->begin());
-      LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
-          FirstMILiveIns != nullptr,
-          "Failed to obtain the live physical regs for MI {0}.",
-          *MF->begin()->begin()));
-
-      // The current location of the state value register
-      std::shared_ptr<StateValueArrayStorage> SVS =
-          findStateValueArrayStorageAtMI(
-              MRI, *FirstMILiveIns, AccessedPhysicalRegistersNotInLiveIns,
-              SupportedStorage, MaxNumAGPRsUsedByAllStorage,
-              MaxNumSGPRsUsedByAllStorage);
-
-      LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
-          SVS != nullptr,
-          "Failed to get a state value array storage for MI {0}.",
-          *MF->begin()->begin()));
-
-      LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
-          llvm::isa<VGPRStateValueArrayStorage>(SVS.get()) ||
-              llvm::isa<SingleAGPRStateValueArrayStorage>(SVS.get()),
-          "The entry SVS must be stored in a VGPR or an AGPR."));
-
-      // A set of hook insertion points that fall into the current interval
-      llvm::SmallDenseSet<const llvm::MachineInstr *, 4>
-          HookInsertionPointsInCurrentSegment{};
-      for (const auto &MBB : *MF) {
-        // Marks the beginning of the current interval we are in this loop
-        llvm::SlotIndex CurrentIntervalBegin =
-            SlotIndexes.at(*MF).getMBBStartIdx(&MBB);
-
-        auto &CurrentMBBSegments =
-            StateValueStorageIntervals.insert({&MBB, {}}).first->getSecond();
-        for (const auto &MI : MBB) {
-          if (IPIP.contains(MI))
-            HookInsertionPointsInCurrentSegment.insert(&MI);
-          auto *InstrLiveRegs = RegLiveness.getMFLevelInstrLiveIns(MI);
-          LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
-              InstrLiveRegs != nullptr,
-              "Failed to get the live physical register set for MI {0}.", MI));
-          // - If we have spilled the state value reg and this instruction
-          // will require a hook to be inserted, then we try to relocate the
-          // SVS. In this instance, since the hook will have to load the value
-          // state register anyway, we try and see if after loading it, we can
-          // store it in a V/AGPR.
-          // - If the SVS registers are going to be used, we must relocate
-          // the SVS.
-          // - Otherwise, we keep the SVS in its place.
-          bool TryRelocatingValueStateReg =
-              SVS->getStateValueStorageReg() == 0 && IPIP.contains(MI);
-          llvm::SmallVector<llvm::MCRegister, 4> SVSRegs;
-          SVS->getAllStorageRegisters(SVSRegs);
-          bool MustRelocateStateValue =
-              llvm::any_of(SVSRegs, [&](llvm::MCRegister Reg) {
-                return !InstrLiveRegs->available(MF->getRegInfo(), Reg);
-              });
-          // If we have to relocate something, then create a new interval
-          // for it;
-          // Note that reg scavenging might conclude that the values remain
-          // where they are, and that's okay
-          // Also create a new interval if we reach the end of a MBB
-          if (&MI == &MBB.back() || TryRelocatingValueStateReg ||
-              MustRelocateStateValue) {
-            auto NextIndex = &MI == &MBB.back()
-                                 ? SlotIndexes.at(*MF).getMBBEndIdx(&MBB)
-                                 : SlotIndexes.at(*MF).getInstructionIndex(MI);
-            CurrentMBBSegments.emplace_back(CurrentIntervalBegin, NextIndex,
-                                            SVS);
-            for (const auto &HookMI : HookInsertionPointsInCurrentSegment) {
-              auto *HookLiveRegs = RegLiveness.getMFLevelInstrLiveIns(*HookMI);
-              auto [HookSVGPR, ClobbersAppReg] =
-                  selectVGPRLoadLocationForInjectedPayload(
-                      *HookMI, *SVS, *HookLiveRegs,
-                      AccessedPhysicalRegistersNotInLiveIns, false);
-              InstPointSVSLoadPlans.insert(
-                  {HookMI, {HookSVGPR, ClobbersAppReg, *SVS}});
-            }
-            HookInsertionPointsInCurrentSegment.clear();
-            CurrentIntervalBegin = NextIndex;
-          }
-          if (TryRelocatingValueStateReg || MustRelocateStateValue) {
-            SVS = findStateValueArrayStorageAtMI(
-                MRI, *FirstMILiveIns, AccessedPhysicalRegistersNotInLiveIns,
-                SupportedStorage, MaxNumAGPRsUsedByAllStorage,
-                MaxNumSGPRsUsedByAllStorage);
-            LUTHIER_RETURN_ON_ERROR(LUTHIER_ERROR_CHECK(
-                SVS != nullptr, "Failed to relocate the SVA storage."));
-          }
-        }
+      bool IsScheduled{false};
+      if (SVAStorageScheduler == SVAStorageSchedulerKind::Global) {
+        LUTHIER_RETURN_ON_ERROR(
+            scheduleStorageGlobally(*MF, SlotIndexes.at(*MF), RegLiveness,
+                                    IPIP, SupportedStorage,
+                                    RegsNotUsableBySVA)
+                .moveInto(IsScheduled));
+        LLVM_DEBUG(if (!IsScheduled) llvm::dbgs()
+                       << "Failed to find a global SVA storage schedule for "
+                       << MF->getName() << "; Falling back to greedy.\n";);
       }
+      if (!IsScheduled)
+        LUTHIER_RETURN_ON_ERROR(scheduleStorageGreedily(
+            *MF, SlotIndexes.at(*MF), RegLiveness, IPIP, SupportedStorage,
+            MaxNumAGPRsUsedByAllStorage, MaxNumSGPRsUsedByAllStorage,
+            RegsNotUsableBySVA));
+    }
+  }
+  if (PrintSVAStorageCost) {
+    for (const auto &MF : MFs) {
+      auto [StaticCost, WeightedCost] =
+          estimateSVAStorageCost(*MF, *this);
+      luthier::errs() << llvm::formatv(
+          "SVA storage of {0}: {1} injected instructions, {2:f1} estimated "
+          "dynamic instructions per invocation\n",
+          MF->getName(), StaticCost, WeightedCost);
     }
   }
   return llvm::Error::success();
@@ -616,7 +1194,8 @@ LRStateValueStorageAndLoadLocationsAnalysis::run(
       *IMAM.getCachedResult<InjectedPayloadAndInstPointAnalysis>(IModule),
       TargetMAM.getResult<FunctionPreambleDescriptorAnalysis>(TargetModule),
       IMAM.getResult<PhysRegsNotInLiveInsAnalysis>(IModule)
-          .getPhysRegsNotInLiveIns());
+          .getPhysRegsNotInLiveIns(),
+      TargetMAM.getResult<OccupancyBudgetAnalysis>(TargetModule));
   if (Err)
     TargetModule.getContext().emitError(toString(std::move(Err)));
 
@@ -81,7 +81,10 @@ const static llvm::SmallDenseMap<KernelArgumentType, std::pair<short, short>,
         {HEAP_V1, {49, 1}},
         {DYNAMIC_LDS_SIZE, {50, 1}},
         {PRIVATE_BASE, {51, 2}},
-        {SHARED_BASE, {53, 2}}};
+        {SHARED_BASE, {53, 2}},
+        {WORKGROUP_ID_X, {55, 1}},
+        {WORKGROUP_ID_Y, {56, 1}},
+        {WORKGROUP_ID_Z, {57, 1}}};
 
 // TODO: Add wave32 state value array
 
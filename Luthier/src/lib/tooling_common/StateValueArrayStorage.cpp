@@ -1058,23 +1058,30 @@ emitCodeToSwitchSVS(llvm::MachineBasicBlock::iterator &MI,
 void VGPRStateValueArrayStorage::emitCodeToSwitchSVS(
     llvm::MachineBasicBlock::iterator MI, const StateValueArrayStorage &TargetSVS) const {
   if (auto *TargetVgprStorage =
-          llvm::dyn_cast<VGPRStateValueArrayStorage>(this)) {
+          llvm::dyn_cast<VGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetVgprStorage);
+    return;
   } else if (auto *TargetAgprStorage =
-                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(this)) {
+                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprStorage);
+    return;
   } else if (auto *TargetTwoAgprStorage =
-                 llvm::dyn_cast<TwoAGPRValueStorage>(this)) {
+                 llvm::dyn_cast<TwoAGPRValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetTwoAgprStorage);
+    return;
   } else if (auto *TargetAgprWith3SgprStorage =
-                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(this)) {
+                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprWith3SgprStorage);
+    return;
   } else if (auto *Target3SgprStorage =
-                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(
+                     &TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *Target3SgprStorage);
+    return;
   } else if (auto *TargetSgprStorage =
-                 llvm::dyn_cast<SpilledWithOneSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithOneSGPRsValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetSgprStorage);
+    return;
   }
   llvm_unreachable("Invalid SVS passed.");
 }
@@ -1090,17 +1097,22 @@ bool VGPRStateValueArrayStorage::operator==(
 void SingleAGPRStateValueArrayStorage::emitCodeToSwitchSVS(
     llvm::MachineBasicBlock::iterator MI, const StateValueArrayStorage &TargetSVS) const {
   if (auto *TargetVgprStorage =
-          llvm::dyn_cast<VGPRStateValueArrayStorage>(this)) {
+          llvm::dyn_cast<VGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetVgprStorage);
+    return;
   } else if (auto *TargetAgprStorage =
-                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(this)) {
+                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprStorage);
+    return;
   } else if (auto *Target3SgprStorage =
-                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(
+                     &TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *Target3SgprStorage);
+    return;
   } else if (auto *TargetSgprStorage =
-                 llvm::dyn_cast<SpilledWithOneSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithOneSGPRsValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetSgprStorage);
+    return;
   }
   llvm_unreachable("Invalid SVS passed.");
 }
@@ -1158,17 +1170,22 @@ void TwoAGPRValueStorage::emitCodeToStoreSVA(llvm::MachineInstr &MI,
 void TwoAGPRValueStorage::emitCodeToSwitchSVS(
     llvm::MachineBasicBlock::iterator MI, const StateValueArrayStorage &TargetSVS) const {
   if (auto *TargetVgprStorage =
-          llvm::dyn_cast<VGPRStateValueArrayStorage>(this)) {
+          llvm::dyn_cast<VGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetVgprStorage);
+    return;
   } else if (auto *TargetTwoAgprStorage =
-                 llvm::dyn_cast<TwoAGPRValueStorage>(this)) {
+                 llvm::dyn_cast<TwoAGPRValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetTwoAgprStorage);
+    return;
   } else if (auto *TargetAgprWith3SgprStorage =
-                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(this)) {
+                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprWith3SgprStorage);
+    return;
   } else if (auto *Target3SgprStorage =
-                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(
+                     &TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *Target3SgprStorage);
+    return;
   }
   llvm_unreachable("Invalid SVS passed.");
 }
@@ -1253,17 +1270,22 @@ void AGPRWithThreeSGPRSValueStorage::emitCodeToStoreSVA(
 void AGPRWithThreeSGPRSValueStorage::emitCodeToSwitchSVS(
     llvm::MachineBasicBlock::iterator MI, const StateValueArrayStorage &TargetSVS) const {
   if (auto *TargetVgprStorage =
-          llvm::dyn_cast<VGPRStateValueArrayStorage>(this)) {
+          llvm::dyn_cast<VGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetVgprStorage);
+    return;
   } else if (auto *TargetTwoAgprStorage =
-                 llvm::dyn_cast<TwoAGPRValueStorage>(this)) {
+                 llvm::dyn_cast<TwoAGPRValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetTwoAgprStorage);
+    return;
   } else if (auto *TargetAgprWith3SgprStorage =
-                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(this)) {
+                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprWith3SgprStorage);
+    return;
   } else if (auto *Target3SgprStorage =
-                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(
+                     &TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *Target3SgprStorage);
+    return;
   }
   llvm_unreachable("Invalid SVS passed.");
 }
@@ -1350,20 +1372,26 @@ void SpilledWithThreeSGPRsValueStorage::emitCodeToStoreSVA(
 void SpilledWithThreeSGPRsValueStorage::emitCodeToSwitchSVS(
     llvm::MachineBasicBlock::iterator MI, const StateValueArrayStorage &TargetSVS) const {
   if (auto *TargetVgprStorage =
-          llvm::dyn_cast<VGPRStateValueArrayStorage>(this)) {
+          llvm::dyn_cast<VGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetVgprStorage);
+    return;
   } else if (auto *TargetAgprStorage =
-                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(this)) {
+                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprStorage);
+    return;
   } else if (auto *TargetTwoAgprStorage =
-                 llvm::dyn_cast<TwoAGPRValueStorage>(this)) {
+                 llvm::dyn_cast<TwoAGPRValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetTwoAgprStorage);
+    return;
   } else if (auto *TargetAgprWith3SgprStorage =
-                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(this)) {
+                 llvm::dyn_cast<AGPRWithThreeSGPRSValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprWith3SgprStorage);
+    return;
   } else if (auto *Target3SgprStorage =
-                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithThreeSGPRsValueStorage>(
+                     &TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *Target3SgprStorage);
+    return;
   }
   llvm_unreachable("Invalid SVS passed.");
 }
@@ -1438,14 +1466,17 @@ void SpilledWithOneSGPRsValueStorage::emitCodeToStoreSVA(
 void SpilledWithOneSGPRsValueStorage::emitCodeToSwitchSVS(
     llvm::MachineBasicBlock::iterator MI, const StateValueArrayStorage &TargetSVS) const {
   if (auto *TargetVgprStorage =
-          llvm::dyn_cast<VGPRStateValueArrayStorage>(this)) {
+          llvm::dyn_cast<VGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetVgprStorage);
+    return;
   } else if (auto *TargetAgprStorage =
-                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(this)) {
+                 llvm::dyn_cast<SingleAGPRStateValueArrayStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetAgprStorage);
+    return;
   } else if (auto *TargetSgprStorage =
-                 llvm::dyn_cast<SpilledWithOneSGPRsValueStorage>(this)) {
+                 llvm::dyn_cast<SpilledWithOneSGPRsValueStorage>(&TargetSVS)) {
     luthier::emitCodeToSwitchSVS(MI, *this, *TargetSgprStorage);
+    return;
   }
   llvm_unreachable("Invalid SVS passed.");
 }
@@ -1466,8 +1497,7 @@ void getSupportedSVAStorageList(
   SupportedStorageKinds.push_back(StateValueArrayStorage::SVS_SINGLE_VGPR);
   /// Other storage types are listed here based on preference
   for (auto SK :
-       {StateValueArrayStorage::SVS_SINGLE_VGPR,
-        StateValueArrayStorage::SVS_ONE_AGPR_post_gfx908,
+       {StateValueArrayStorage::SVS_ONE_AGPR_post_gfx908,
         StateValueArrayStorage::SVS_TWO_AGPRs_pre_gfx908,
         StateValueArrayStorage::SVS_SINGLE_AGPR_WITH_THREE_SGPRS_pre_gfx908,
         StateValueArrayStorage::SVS_SPILLED_WITH_THREE_SGPRS_absolute_fs,
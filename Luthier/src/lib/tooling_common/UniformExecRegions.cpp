@@ -0,0 +1,99 @@
+//===-- UniformExecRegions.cpp --------------------------------------------===//
+// Copyright 2022-2025 @ Northeastern University Computer Architecture Lab
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//===----------------------------------------------------------------------===//
+///
+/// \file This file implements the \c findUniformExecRegions function.
+//===----------------------------------------------------------------------===//
+#include <SIInstrInfo.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/CodeGen/MachineFunction.h>
+#include <llvm/Support/Debug.h>
+#include <luthier/tooling/UniformExecRegions.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "luthier-uniform-exec-regions"
+
+namespace luthier {
+
+/// \return \c true if the instructions after \p MI can run under a different
+/// exec mask or a different number of times than \p MI itself
+/// \note Writes to the exec mask are detected the same way the \c VectorCFG
+/// detects them when splitting its blocks
+static bool endsUniformExecRegion(const llvm::MachineInstr &MI,
+                                  const llvm::TargetRegisterInfo &TRI) {
+  return MI.modifiesRegister(llvm::AMDGPU::EXEC, &TRI) || MI.isCall() ||
+         MI.isConditionalBranch() || MI.isIndirectBranch() || MI.isReturn();
+}
+
+/// \return the block the uniform exec region at the end of \p MBB continues
+/// into, or \c nullptr if the region cannot continue past \p MBB
+static llvm::MachineBasicBlock *
+getRegionContinuation(const llvm::MachineBasicBlock &MBB) {
+  if (MBB.succ_size() != 1)
+    return nullptr;
+  llvm::MachineBasicBlock *Succ = *MBB.succ_begin();
+  if (Succ == &MBB || Succ->pred_size() != 1 ||
+      Succ == &Succ->getParent()->front())
+    return nullptr;
+  return Succ;
+}
+
+void findUniformExecRegions(
+    llvm::MachineFunction &MF,
+    llvm::SmallVectorImpl<UniformExecRegion> &Regions) {
+  const auto &TRI = *MF.getSubtarget().getRegisterInfo();
+  llvm::SmallPtrSet<const llvm::MachineBasicBlock *, 16> Visited;
+
+  // Walks the chain of blocks starting from MBB, cutting it into regions
+  auto WalkChain = [&](llvm::MachineBasicBlock &MBB) {
+    UniformExecRegion Current;
+    auto FlushCurrent = [&]() {
+      if (!Current.Instructions.empty())
+        Regions.emplace_back(std::move(Current));
+      Current = UniformExecRegion{};
+    };
+    for (llvm::MachineBasicBlock *BB = &MBB; BB && Visited.insert(BB).second;
+         BB = getRegionContinuation(*BB)) {
+      for (auto &MI : *BB) {
+        Current.Instructions.push_back(&MI);
+        if (endsUniformExecRegion(MI, TRI))
+          FlushCurrent();
+      }
+    }
+    FlushCurrent();
+  };
+
+  // Start walking from blocks that are not the continuation of their
+  // predecessor's region
+  for (auto &MBB : MF) {
+    bool IsContinuation =
+        MBB.pred_size() == 1 &&
+        getRegionContinuation(**MBB.pred_begin()) == &MBB;
+    if (!IsContinuation)
+      WalkChain(MBB);
+  }
+  // Blocks not visited so far form cycles of continuations (i.e. infinite
+  // loops with no entry from the rest of the function); Walk them anyway
+  // so that every instruction ends up in a region
+  for (auto &MBB : MF) {
+    if (!Visited.contains(&MBB))
+      WalkChain(MBB);
+  }
+  LLVM_DEBUG(llvm::dbgs() << "Found " << Regions.size()
+                          << " uniform exec regions in " << MF.getName()
+                          << ".\n";);
+}
+
+} // namespace luthier